@@ -53,6 +53,12 @@ endif
 ifeq ($(NPROFILE),yes)
   CDEFS += -DNPROFILE
 endif
+ifeq ($(TRACE),yes)
+  CDEFS += -DTRACE
+endif
+ifeq ($(SYS_LOCK_PROFILE),yes)
+  CDEFS += -DSYS_LOCK_PROFILE
+endif
 CDEFS +=  -DARCH_$(UPPER_ARCH) -DMCU_$(UPPER_MCU) \
           -DBOARD_$(UPPER_BOARD) -DVERSION=$(VERSION)
 CFLAGS += $(CDEFS)
@@ -203,6 +209,8 @@ help:
 	@echo "--------------------------------------------------------------------------------"
 	@echo "  NDEBUG                      yes - build without debug information"
 	@echo "  NPROFILE                    yes - build without profiling information"
+	@echo "  TRACE                       yes - build with kernel event tracing"
+	@echo "  SYS_LOCK_PROFILE            yes - build with system lock profiling"
 	@IFS=$$'\n' ; for h in $(HELP_VARIABLES) ; do \
 	  echo $$h ; \
 	done
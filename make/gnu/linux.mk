@@ -24,6 +24,22 @@ LDFLAGS += -Wl,-lpthread -lrt
 
 ENDIANESS = little
 
+# Number of cpus. SMP requires the pthread thread port.
+NCPUS ?= 1
+
+ifneq ($(NCPUS),1)
+  THRD_PORT = pthread
+  CFLAGS += -DTHRD_NCPUS=$(NCPUS)
+endif
+
+# Thread port. ucontext runs all threads on one pthread, pthread runs
+# each thread on its own pthread.
+THRD_PORT ?= ucontext
+
+ifeq ($(THRD_PORT),pthread)
+  CFLAGS += -DTHRD_PORT_PTHREAD
+endif
+
 ifneq ($(NPROFILE),yes)
   CFLAGS += -pg -fprofile-arcs -ftest-coverage
   LDFLAGS += -pg -fprofile-arcs -ftest-coverage -lgcov
@@ -36,4 +52,7 @@ else
   CFLAGS += -O2
 endif
 
+HELP_VARIABLES += "  THRD_PORT                   ucontext or pthread thread port" $$(echo -e '\n')
+HELP_VARIABLES += "  NCPUS                       number of cpus (SMP)" $$(echo -e '\n')
+
 include $(SIMBA_ROOT)/make/gnu.mk
@@ -0,0 +1,221 @@
+#!/usr/bin/env python
+#
+# @file make/tracedecoder.py
+# @version 1.0
+#
+# @section License
+# Copyright (C) 2014-2015, Erik Moqvist
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# This file is part of the Simba project.
+#
+
+"""Convert the output of the /kernel/trace/dump command to Chrome
+trace JSON, viewable in chrome://tracing or the Perfetto UI.
+
+Each cpu gets a track showing the running thread, with instant events
+for the kernel objects. Each thread gets a track showing when it was
+running and blocked.
+
+usage: tracedecoder.py [-o OUTFILE] INFILE
+"""
+
+from __future__ import print_function
+
+import sys
+import json
+import argparse
+
+# Interrupt sources, see TRACE_ISR_* in kernel/trace.h.
+ISRS = ['uart', 'spi', 'exti', 'adc', 'dac', 'can', 'usb']
+
+CPUS_PID = 0
+THRDS_PID = 1
+
+
+def parse(lines):
+    """Parse the dump. Returns a dictionary of thread names and a list
+    of records as (cpu, time, event, object, value) tuples, oldest
+    first per cpu.
+
+    """
+
+    names = {}
+    records = []
+
+    for line in lines:
+        words = line.strip().split()
+
+        if len(words) == 0:
+            continue
+
+        if words[0] == 'thrd':
+            if len(words) == 3:
+                names[int(words[1], 16)] = words[2]
+            elif len(words) == 2:
+                names[int(words[1], 16)] = words[1]
+        elif len(words) == 5 and words[0].isdigit():
+            try:
+                records.append((int(words[0]),
+                                int(words[1]),
+                                words[2],
+                                int(words[3], 16),
+                                int(words[4])))
+            except ValueError:
+                pass
+
+    return names, records
+
+
+def unwrap(records):
+    """The record time is a 32 bits microsecond counter. Make it
+    monotonic per cpu.
+
+    """
+
+    offsets = {}
+    previous = {}
+    unwrapped = []
+
+    for cpu, time, event, obj, value in records:
+        offset = offsets.get(cpu, 0)
+
+        if cpu in previous and time < previous[cpu] - (1 << 31):
+            offset += (1 << 32)
+            offsets[cpu] = offset
+
+        previous[cpu] = time
+        unwrapped.append((cpu, time + offset, event, obj, value))
+
+    return unwrapped
+
+
+def convert(names, records):
+    """Convert given records to a list of Chrome trace events.
+
+    """
+
+    events = []
+    thrd_ids = {}
+    running = {}
+    blocked = {}
+
+    def thrd_name(obj):
+        return names.get(obj, '0x{:x}'.format(obj))
+
+    def thrd_id(obj):
+        if obj not in thrd_ids:
+            thrd_ids[obj] = len(thrd_ids)
+            events.append({'name': 'thread_name',
+                           'ph': 'M',
+                           'pid': THRDS_PID,
+                           'tid': thrd_ids[obj],
+                           'args': {'name': thrd_name(obj)}})
+
+        return thrd_ids[obj]
+
+    def add_slice(pid, tid, name, begin, end):
+        events.append({'name': name,
+                       'ph': 'X',
+                       'pid': pid,
+                       'tid': tid,
+                       'ts': begin,
+                       'dur': end - begin})
+
+    events.append({'name': 'process_name',
+                   'ph': 'M',
+                   'pid': CPUS_PID,
+                   'args': {'name': 'cpus'}})
+    events.append({'name': 'process_name',
+                   'ph': 'M',
+                   'pid': THRDS_PID,
+                   'args': {'name': 'threads'}})
+
+    for cpu in sorted(set([record[0] for record in records])):
+        events.append({'name': 'thread_name',
+                       'ph': 'M',
+                       'pid': CPUS_PID,
+                       'tid': cpu,
+                       'args': {'name': 'cpu {}'.format(cpu)}})
+
+    for cpu, time, event, obj, value in records:
+        if event == 'switch':
+            # End the slice of the previously running thread.
+            if cpu in running:
+                previous, begin = running[cpu]
+                add_slice(CPUS_PID, cpu, thrd_name(previous), begin, time)
+                add_slice(THRDS_PID, thrd_id(previous), 'running', begin, time)
+
+            if obj in blocked:
+                add_slice(THRDS_PID, thrd_id(obj), 'blocked', blocked[obj], time)
+                del blocked[obj]
+
+            running[cpu] = (obj, time)
+            continue
+
+        if event == 'suspend':
+            blocked[obj] = time
+            name = 'suspend {}'.format(thrd_name(obj))
+        elif event == 'resume':
+            name = 'resume {}'.format(thrd_name(obj))
+        elif event == 'isr':
+            if value < len(ISRS):
+                name = 'isr {}'.format(ISRS[value])
+            else:
+                name = 'isr {}'.format(value)
+        elif event == 'timer_tick':
+            name = 'tick'
+        else:
+            name = '{} 0x{:x}'.format(event, obj)
+
+        events.append({'name': name,
+                       'ph': 'i',
+                       's': 't',
+                       'pid': CPUS_PID,
+                       'tid': cpu,
+                       'ts': time,
+                       'args': {'object': '0x{:x}'.format(obj),
+                                'value': value}})
+
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Convert a kernel trace dump to Chrome trace JSON.')
+    parser.add_argument('-o', '--outfile',
+                        help='Output file, standard output by default.')
+    parser.add_argument('infile',
+                        help='Output of the /kernel/trace/dump command.')
+    args = parser.parse_args()
+
+    with open(args.infile) as fin:
+        names, records = parse(fin)
+
+    # Merge the cpus.
+    records = sorted(unwrap(records), key=lambda record: record[1])
+
+    trace = {
+        'traceEvents': convert(names, records),
+        'displayTimeUnit': 'ms'
+    }
+
+    if args.outfile:
+        with open(args.outfile, 'w') as fout:
+            json.dump(trace, fout, indent=1)
+    else:
+        json.dump(trace, sys.stdout, indent=1)
+        print()
+
+
+if __name__ == '__main__':
+    main()
@@ -40,7 +40,12 @@ int can_init(struct can_driver_t *self_p,
               (ssize_t (*)(chan_t *, const void *, size_t))write_cb,
               NULL);
 
-    queue_init(&self_p->chin, rxbuf_p, size);
+    if (mailbox_init(&self_p->chin,
+                     rxbuf_p,
+                     sizeof(struct can_frame_t),
+                     size / sizeof(struct can_frame_t)) != 0) {
+        return (-EINVAL);
+    }
 
     return (can_port_init(self_p, dev_p, speed));
 }
@@ -59,7 +64,7 @@ ssize_t can_read(struct can_driver_t *self_p,
                  struct can_frame_t *frame_p,
                  size_t size)
 {
-    return (queue_read(&self_p->chin, frame_p, size));
+    return (chan_read(&self_p->chin, frame_p, size));
 }
 
 ssize_t can_write(struct can_driver_t *self_p,
@@ -82,7 +82,9 @@ int can_stop(struct can_driver_t *self_p);
  *
  * @param[in] self_p Initialized driver object.
  * @param[out] frame_p Array of read frames.
- * @param[in] size Size of frames buffer in words.
+ * @param[in] size Size of frames buffer in bytes. Only whole frames
+ *                 are read, so it must be a multiple of the frame
+ *                 size.
  *
  * @return zero(0) or negative error code.
  */
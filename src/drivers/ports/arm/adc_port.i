@@ -55,6 +55,8 @@ ISR(adc)
     struct adc_device_t *dev_p = &adc_device[0];
     struct adc_driver_t *self_p = dev_p->jobs.head_p;
 
+    TRACE_EVENT(TRACE_EVENT_ISR, dev_p, TRACE_ISR_ADC);
+
     /* Mark the job as finished. */
     self_p->state = STATE_FINISHED;
 
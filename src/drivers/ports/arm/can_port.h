@@ -62,7 +62,7 @@ struct can_driver_t {
     const struct can_frame_t *txframe_p;
     size_t txsize;
     struct chan_t chout;
-    struct queue_t chin;
+    struct mailbox_t chin;
     struct sem_t sem;
 };
 
@@ -48,9 +48,7 @@ static void read_frame_from_hw(struct can_driver_t *drv_p,
     mailbox_p->MCR = CAN_MCR_MTCR;
 
     /* Write the received frame to the application input channel. */
-    if (queue_write_isr(&drv_p->chin,
-                        &frame,
-                        sizeof(frame)) != sizeof(frame)) {
+    if (mailbox_send_isr(&drv_p->chin, &frame) != 0) {
         COUNTER_INC(can_rx_channel_overflow, 1);
     }
 }
@@ -80,6 +78,8 @@ static void isr(struct can_device_t *dev_p)
     struct can_driver_t *drv_p;
     uint32_t status;
 
+    TRACE_EVENT(TRACE_EVENT_ISR, dev_p, TRACE_ISR_CAN);
+
     if (dev_p->drv_p == NULL) {
         return;
     }
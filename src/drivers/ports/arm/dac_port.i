@@ -48,6 +48,8 @@ ISR(dacc)
     struct dac_device_t *dev_p = &dac_device[0];
     struct dac_driver_t *self_p = dev_p->jobs.head_p;
 
+    TRACE_EVENT(TRACE_EVENT_ISR, dev_p, TRACE_ISR_DAC);
+
     /* Add more samples to the PDC, if any. */
     if (self_p->next.length > 0) {
         write_next(self_p);
@@ -30,6 +30,8 @@ static void isr(volatile struct sam_pio_t *pio_p,
     int i;
     uint32_t isr = pio_p->ISR;
 
+    TRACE_EVENT(TRACE_EVENT_ISR, pio_p, TRACE_ISR_EXTI);
+
     for (i = 0; i < max; i++, dev_p++) {
         if (isr & (1 << i)) {
             if (dev_p->drv_p == NULL) {
@@ -27,6 +27,8 @@ ISR(spi0)
     struct spi_driver_t *drv_p = dev_p->drv_p;
     uint32_t sr;
 
+    TRACE_EVENT(TRACE_EVENT_ISR, dev_p, TRACE_ISR_SPI);
+
     if (drv_p == NULL) {
         return;
     }
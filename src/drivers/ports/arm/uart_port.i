@@ -132,12 +132,87 @@ static ssize_t uart_port_write_cb(void *arg_p,
     return (size);
 }
 
+#define UART_PORT_WRITEV
+
+/**
+ * Write given parts in as few DMA transfers as possible. The PDC
+ * chains two buffers per transfer using its next pointer.
+ */
+static ssize_t uart_port_writev_cb(void *arg_p,
+                                   struct iov_t *iov_p,
+                                   size_t length)
+{
+    struct uart_driver_t *self_p;
+    struct uart_device_t *dev_p;
+    ssize_t size;
+    size_t i;
+
+    self_p = container_of(arg_p, struct uart_driver_t, chout);
+    dev_p = self_p->dev_p;
+    size = 0;
+    i = 0;
+
+    sem_get(&self_p->sem, NULL);
+
+    sys_lock();
+
+    while (1) {
+        /* Skip empty parts, as a zero transfer counter would end the
+           transfer. */
+        while ((i < length) && (iov_p[i].size == 0)) {
+            i++;
+        }
+
+        if (i == length) {
+            break;
+        }
+
+        dev_p->regs_p->PDC.TPR = (uint32_t)iov_p[i].buf_p;
+        dev_p->regs_p->PDC.TCR = iov_p[i].size;
+        size += iov_p[i].size;
+        i++;
+
+        while ((i < length) && (iov_p[i].size == 0)) {
+            i++;
+        }
+
+        /* Chain the next part, transmitted when the first is done. */
+        if (i < length) {
+            dev_p->regs_p->PDC.TNPR = (uint32_t)iov_p[i].buf_p;
+            dev_p->regs_p->PDC.TNCR = iov_p[i].size;
+            size += iov_p[i].size;
+            i++;
+        }
+
+        /* Enable the PDC. The end of transfer signal is set when both
+           counters have reached zero. */
+        dev_p->regs_p->PDC.PTCR = (PERIPH_PTCR_TXTEN);
+
+        dev_p->regs_p->IER = (US_IER_ENDTX);
+
+        self_p->thrd_p = thrd_self();
+
+        thrd_suspend_isr(NULL);
+    }
+
+    /* Disable the PDC. */
+    dev_p->regs_p->PDC.PTCR = (PERIPH_PTCR_TXTDIS);
+
+    sys_unlock();
+
+    sem_put(&self_p->sem, 1);
+
+    return (size);
+}
+
 static void isr(int index)
 {
     struct uart_device_t *dev_p = &uart_device[index];
     struct uart_driver_t *drv_p = dev_p->drv_p;
     uint32_t csr, error;
 
+    TRACE_EVENT(TRACE_EVENT_ISR, dev_p, TRACE_ISR_UART);
+
     if (drv_p == NULL) {
         return;
     }
@@ -53,6 +53,8 @@ ISR(uotghs)
     uint32_t isr;
     int i;
 
+    TRACE_EVENT(TRACE_EVENT_ISR, dev_p, TRACE_ISR_USB);
+
     if (drv_p == NULL) {
         return;
     }
@@ -39,6 +39,8 @@ ISR(ADC_vect)
     struct adc_device_t *dev_p = &adc_device[0];
     struct adc_driver_t *self_p = dev_p->jobs.head_p;
 
+    TRACE_EVENT(TRACE_EVENT_ISR, dev_p, TRACE_ISR_ADC);
+
     /* The AD Converter is running in free mode. */
     self_p->interrupt_count++;
 
@@ -29,6 +29,8 @@
     {                                                                   \
         struct exti_driver_t *self_p = exti_device[number].self_p;        \
                                                                         \
+        TRACE_EVENT(TRACE_EVENT_ISR, &exti_device[number], TRACE_ISR_EXTI); \
+                                                                        \
         if (self_p != NULL) {                                            \
             self_p->on_interrupt(self_p->arg_p);                          \
         }                                                               \
@@ -27,6 +27,8 @@ ISR(SPI_STC_vect)
 {
     struct spi_driver_t *drv_p = spi_device[0].drv_p;
 
+    TRACE_EVENT(TRACE_EVENT_ISR, &spi_device[0], TRACE_ISR_SPI);
+
     if (drv_p == NULL) {
         return;
     }
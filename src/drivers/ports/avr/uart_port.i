@@ -90,6 +90,8 @@ static void tx_isr(int index)
 {
     struct uart_driver_t *drv_p = uart_device[index].drv_p;
 
+    TRACE_EVENT(TRACE_EVENT_ISR, &uart_device[index], TRACE_ISR_UART);
+
     if (drv_p == NULL) {
         return;
     }
@@ -110,6 +112,8 @@ static void rx_isr(int index)
     char c;
     uint8_t error;
 
+    TRACE_EVENT(TRACE_EVENT_ISR, &uart_device[index], TRACE_ISR_UART);
+
     if (drv_p == NULL) {
         return;
     }
@@ -41,3 +41,29 @@ static ssize_t uart_port_write_cb(void *arg,
 
     return (size);
 }
+
+#define UART_PORT_WRITEV
+
+static ssize_t uart_port_writev_cb(void *arg_p,
+                                   struct iov_t *iov_p,
+                                   size_t length)
+{
+    const char *c_p;
+    ssize_t size;
+    size_t i, left;
+
+    size = 0;
+
+    for (i = 0; i < length; i++) {
+        c_p = iov_p[i].buf_p;
+        left = iov_p[i].size;
+        size += left;
+
+        while (left > 0) {
+            putchar(*c_p++);
+            left--;
+        }
+    }
+
+    return (size);
+}
@@ -43,6 +43,12 @@ int uart_init(struct uart_driver_t *self_p,
               (ssize_t (*)(chan_t *, const void *, size_t))uart_port_write_cb,
               NULL);
 
+#if defined(UART_PORT_WRITEV)
+    chan_set_iov_cb(&self_p->chout,
+                    NULL,
+                    (ssize_t (*)(chan_t *, struct iov_t *, size_t))uart_port_writev_cb);
+#endif
+
     return (queue_init(&self_p->chin, rxbuf_p, size));
 }
 
@@ -35,6 +35,9 @@ int chan_init(struct chan_t *self_p,
     self_p->read = read;
     self_p->write = write;
     self_p->size = size;
+    self_p->readv = NULL;
+    self_p->writev = NULL;
+    sys_object_lock_init(&self_p->lock);
     self_p->writer_p = NULL;
     self_p->reader_p = NULL;
     self_p->list_p = NULL;
@@ -42,6 +45,16 @@ int chan_init(struct chan_t *self_p,
     return (0);
 }
 
+int chan_set_iov_cb(struct chan_t *self_p,
+                    thrd_readv_fn_t readv,
+                    thrd_writev_fn_t writev)
+{
+    self_p->readv = readv;
+    self_p->writev = writev;
+
+    return (0);
+}
+
 int chan_list_init(struct chan_list_t *list_p,
                    void *workspace_p,
                    size_t size)
@@ -68,7 +81,9 @@ int chan_list_destroy(struct chan_list_t *list_p)
 
     for (i = 0; i < list_p->len; i++) {
         chan_p = list_p->chans_pp[i];
+        sys_object_lock(&chan_p->lock);
         chan_p->list_p = NULL;
+        sys_object_unlock(&chan_p->lock);
     }
 
     sys_unlock();
@@ -90,6 +105,64 @@ ssize_t chan_write(chan_t *self_p,
     return (((struct chan_t *)self_p)->write(self_p, buf_p, size));
 }
 
+ssize_t chan_readv(chan_t *self_p,
+                   struct iov_t *iov_p,
+                   size_t length)
+{
+    struct chan_t *chan_p;
+    ssize_t res, size;
+    size_t i;
+
+    chan_p = self_p;
+
+    if (chan_p->readv != NULL) {
+        return (chan_p->readv(self_p, iov_p, length));
+    }
+
+    size = 0;
+
+    for (i = 0; i < length; i++) {
+        res = chan_p->read(self_p, iov_p[i].buf_p, iov_p[i].size);
+
+        if (res < 0) {
+            return (res);
+        }
+
+        size += res;
+    }
+
+    return (size);
+}
+
+ssize_t chan_writev(chan_t *self_p,
+                    struct iov_t *iov_p,
+                    size_t length)
+{
+    struct chan_t *chan_p;
+    ssize_t res, size;
+    size_t i;
+
+    chan_p = self_p;
+
+    if (chan_p->writev != NULL) {
+        return (chan_p->writev(self_p, iov_p, length));
+    }
+
+    size = 0;
+
+    for (i = 0; i < length; i++) {
+        res = chan_p->write(self_p, iov_p[i].buf_p, iov_p[i].size);
+
+        if (res < 0) {
+            return (res);
+        }
+
+        size += res;
+    }
+
+    return (size);
+}
+
 size_t chan_size(chan_t *self_p)
 {
     return (((struct chan_t *)self_p)->size(self_p));
@@ -123,38 +196,82 @@ chan_t *chan_list_poll(struct chan_list_t *list_p,
     sys_lock();
 
     while (1) {
+        /* Add the thread as a reader on all channels before checking
+           for data. A writer that does not see the reader has
+           already made its data available. */
+        chan_list_poll_begin_isr(list_p);
+
         /* Check if data is available on any channel. */
         for (i = 0; i < list_p->len; i++) {
             chan_p = list_p->chans_pp[i];
 
             if (chan_p->size(chan_p) > 0) {
-                goto out;
+                break;
             }
         }
 
-        /* Add the thread as a reader on all channels.*/
-        list_p->flags = CHAN_LIST_POLLING;
-
-        for (i = 0; i < list_p->len; i++) {
-            chan_p = list_p->chans_pp[i];
-            chan_p->reader_p = thrd_self();
-            chan_p->list_p = list_p;
+        if (i < list_p->len) {
+            break;
         }
 
         /* Not data was available, wait for data to be written to one
            of the channels. */
         if (thrd_suspend_isr(timeout_p) == -ETIMEDOUT) {
             chan_p = NULL;
-            goto out;
+            break;
         }
     }
 
- out:
+    chan_list_poll_end_isr(list_p);
     sys_unlock();
 
     return (chan_p);
 }
 
+int chan_list_poll_begin_isr(struct chan_list_t *list_p)
+{
+    struct chan_t *chan_p;
+    size_t i;
+
+    list_p->flags = CHAN_LIST_POLLING;
+
+    for (i = 0; i < list_p->len; i++) {
+        chan_p = list_p->chans_pp[i];
+        sys_object_lock(&chan_p->lock);
+        chan_p->reader_p = thrd_self();
+        chan_p->list_p = list_p;
+        sys_object_unlock(&chan_p->lock);
+    }
+
+    /* For channels that look for a reader without their lock. */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    return (0);
+}
+
+int chan_list_poll_end_isr(struct chan_list_t *list_p)
+{
+    struct chan_t *chan_p;
+    size_t i;
+
+    /* Remove the thread as reader from the channels that were not
+       written to. */
+    list_p->flags = 0;
+
+    for (i = 0; i < list_p->len; i++) {
+        chan_p = list_p->chans_pp[i];
+        sys_object_lock(&chan_p->lock);
+
+        if (chan_p->reader_p == thrd_self()) {
+            chan_p->reader_p = NULL;
+        }
+
+        sys_object_unlock(&chan_p->lock);
+    }
+
+    return (0);
+}
+
 int chan_is_polled_isr(struct chan_t *self_p)
 {
     if (self_p->list_p != NULL) {
@@ -40,33 +40,90 @@ ssize_t event_read(struct event_t *self_p,
 
     mask_p = (uint32_t *)buf_p;
 
-    sys_lock();
+    /* Only the event lock is needed if the event is already set. */
+    sys_object_lock(&self_p->base.lock);
 
     mask = (self_p->mask & *mask_p);
 
-    /* Event already set? Otherwise wait for it. */
     if (mask != 0) {
         *mask_p = mask;
-    } else {
+        self_p->mask &= (~mask);
+        sys_object_unlock(&self_p->base.lock);
+
+        return (size);
+    }
+
+    sys_object_unlock(&self_p->base.lock);
+
+    sys_lock();
+    sys_object_lock(&self_p->base.lock);
+
+    mask = (self_p->mask & *mask_p);
+
+    /* Wait for the event unless it was set meanwhile. */
+    if (mask == 0) {
         self_p->base.reader_p = thrd_self();
-        thrd_suspend_isr(NULL);
-        *mask_p = (self_p->mask & *mask_p);
+        sys_object_unlock(&self_p->base.lock);
+        thrd_suspend_on_isr(NULL, THRD_WAIT_EVENT);
+        sys_object_lock(&self_p->base.lock);
+        mask = (self_p->mask & *mask_p);
     }
 
+    *mask_p = mask;
+
     /* Remove read events from the event channel. */
-    self_p->mask &= (~(*mask_p));
+    self_p->mask &= (~mask);
 
+    sys_object_unlock(&self_p->base.lock);
     sys_unlock();
 
     return (size);
 }
 
+/**
+ * Write given events. Called with the system lock and the event lock
+ * taken.
+ */
+static void write_isr_locked(struct event_t *self_p, uint32_t mask)
+{
+    if (chan_is_polled_isr(&self_p->base)) {
+        thrd_resume_isr(self_p->base.reader_p, 0);
+        self_p->base.reader_p = NULL;
+    }
+
+    self_p->mask |= mask;
+
+    /* Resume waiting thread. */
+    if (self_p->base.reader_p != NULL)  {
+        thrd_resume_isr(self_p->base.reader_p, 0);
+        self_p->base.reader_p = NULL;
+    }
+}
+
 ssize_t event_write(struct event_t *self_p,
                     const void *buf_p,
                     size_t size)
 {
+    /* Only the event lock is needed if no reader has to be
+       resumed. The reader is read without the lock as a hint, and
+       checked again with it. */
+    if (self_p->base.reader_p == NULL) {
+        sys_object_lock(&self_p->base.lock);
+
+        if (self_p->base.reader_p == NULL) {
+            self_p->mask |= *(uint32_t *)buf_p;
+            sys_object_unlock(&self_p->base.lock);
+
+            return (size);
+        }
+
+        sys_object_unlock(&self_p->base.lock);
+    }
+
     sys_lock();
-    size = event_write_isr(self_p, buf_p, size);
+    sys_object_lock(&self_p->base.lock);
+    write_isr_locked(self_p, *(uint32_t *)buf_p);
+    sys_object_unlock(&self_p->base.lock);
     sys_unlock();
 
     return (size);
@@ -76,18 +133,9 @@ ssize_t event_write_isr(struct event_t *self_p,
                         const void *buf_p,
                         size_t size)
 {
-    if (chan_is_polled_isr(&self_p->base)) {
-        thrd_resume_isr(self_p->base.reader_p, 0);
-        self_p->base.reader_p = NULL;
-    }
-
-    self_p->mask |= *(uint32_t *)buf_p;
-
-    /* Resume waiting thread. */
-    if (self_p->base.reader_p != NULL)  {
-        thrd_resume_isr(self_p->base.reader_p, 0);
-        self_p->base.reader_p = NULL;
-    }
+    sys_object_lock(&self_p->base.lock);
+    write_isr_locked(self_p, *(uint32_t *)buf_p);
+    sys_object_unlock(&self_p->base.lock);
 
     return (size);
 }
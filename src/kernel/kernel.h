@@ -37,10 +37,16 @@
 #include "kernel/parameter.h"
 #include "kernel/shell.h"
 #include "kernel/sem.h"
+#include "kernel/mutex.h"
+#include "kernel/pool.h"
 #include "kernel/std.h"
 #include "kernel/log.h"
 #include "kernel/queue.h"
+#include "kernel/mailbox.h"
 #include "kernel/event.h"
 #include "kernel/bits.h"
+#include "kernel/workq.h"
+#include "kernel/task.h"
+#include "kernel/trace.h"
 
 #endif
@@ -26,14 +26,20 @@ KERNEL_SRC ?= chan.c \
               event.c \
               fs.c \
               log.c \
+              mailbox.c \
+              mutex.c \
+              pool.c \
               queue.c \
               sem.c \
               setting.c \
               shell.c \
               std.c \
               sys.c \
+              task.c \
               thrd.c \
               time.c \
-              timer.c
+              timer.c \
+              trace.c \
+              workq.c
 
 SRC += $(KERNEL_SRC:%=$(SIMBA_ROOT)/src/kernel/%)
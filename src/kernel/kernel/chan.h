@@ -22,6 +22,7 @@
 #define __KERNEL_CHAN_H__
 
 #include "simba.h"
+#include "sys_port.h"
 
 /**
  * Abstract channel type.
@@ -47,6 +48,28 @@ typedef ssize_t (*thrd_write_fn_t)(chan_t *self_p,
  */
 typedef size_t (*thrd_size_fn_t)(chan_t *self_p);
 
+/**
+ * One part of a multi part message.
+ */
+struct iov_t {
+    void *buf_p;
+    size_t size;
+};
+
+/**
+ * Channel scatter read function callback type.
+ */
+typedef ssize_t (*thrd_readv_fn_t)(chan_t *self_p,
+                                   struct iov_t *iov_p,
+                                   size_t length);
+
+/**
+ * Channel gather write function callback type.
+ */
+typedef ssize_t (*thrd_writev_fn_t)(chan_t *self_p,
+                                    struct iov_t *iov_p,
+                                    size_t length);
+
 struct chan_list_t {
     struct chan_t **chans_pp;
     size_t max;
@@ -61,6 +84,12 @@ struct chan_t {
     thrd_read_fn_t read;
     thrd_write_fn_t write;
     thrd_size_fn_t size;
+    /* Optional, NULL if not implemented by the channel. */
+    thrd_readv_fn_t readv;
+    thrd_writev_fn_t writev;
+    /* Protects the channel state, including the reader and writer
+       below. Taken after the system lock (see `sys_lock()`). */
+    struct sys_object_lock_t lock;
     /* Reader thread waiting for data or writer thread waiting for a
        reader. */
     struct thrd_t *writer_p;
@@ -93,6 +122,21 @@ int chan_init(struct chan_t *self_p,
               thrd_write_fn_t write,
               thrd_size_fn_t size);
 
+/**
+ * Set the optional scatter read and gather write callbacks of given
+ * channel. Channels without them read and write one part at a time
+ * in `chan_readv()` and `chan_writev()`.
+ *
+ * @param[in] self_p Initialized channel.
+ * @param[in] readv Scatter read function callback, or NULL.
+ * @param[in] writev Gather write function callback, or NULL.
+ *
+ * @return zero(0) or negative error code.
+ */
+int chan_set_iov_cb(struct chan_t *self_p,
+                    thrd_readv_fn_t readv,
+                    thrd_writev_fn_t writev);
+
 /**
  * Read data from given channel. The behaviour of this function
  * depends on the channel implementation. Often, the calling thread
@@ -123,6 +167,36 @@ ssize_t chan_write(chan_t *self_p,
                    const void *buf_p,
                    size_t size);
 
+/**
+ * Read data from given channel into given parts, in order, as one
+ * operation if supported by the channel implementation. Otherwise
+ * the parts are read one at a time with `chan_read()`.
+ *
+ * @param[in] self_p Channel to read from.
+ * @param[in] iov_p Parts to read into.
+ * @param[in] length Number of parts.
+ *
+ * @return Number of read bytes or negative error code.
+ */
+ssize_t chan_readv(chan_t *self_p,
+                   struct iov_t *iov_p,
+                   size_t length);
+
+/**
+ * Write given parts to given channel, in order, as one operation if
+ * supported by the channel implementation. Otherwise the parts are
+ * written one at a time with `chan_write()`.
+ *
+ * @param[in] self_p Channel to write to.
+ * @param[in] iov_p Parts to write.
+ * @param[in] length Number of parts.
+ *
+ * @return Number of written bytes or negative error code.
+ */
+ssize_t chan_writev(chan_t *self_p,
+                    struct iov_t *iov_p,
+                    size_t length);
+
 /**
  * Get the number of bytes available to read from given channel.
  *
@@ -134,7 +208,8 @@ size_t chan_size(chan_t *self_p);
 
 /**
  * Check if a channel is polled. May only be called from isr or with
- * the system lock taken (see `sys_lock()`).
+ * the system lock taken (see `sys_lock()`), and with the channel lock
+ * taken.
  *
  * @param[in] self_p Channel to check.
  *
@@ -200,4 +275,34 @@ int chan_list_remove(struct chan_list_t *list_p, chan_t *chan_p);
 chan_t *chan_list_poll(struct chan_list_t *list_p,
                        struct time_t *timeout_p);
 
+/**
+ * Add the calling thread as the polling reader of all channels in
+ * given list. The thread is resumed (see `thrd_resume_isr()`) on the
+ * first write to any of the channels, or immediately if it is
+ * resumed before it suspends. Used to wait for channels and other
+ * sources of wakeups at the same time. Call
+ * `chan_list_poll_end_isr()` when done waiting.
+ *
+ * This function may only be called with the system lock taken (see
+ * `sys_lock()`).
+ *
+ * @param[in] list_p List of channels to poll.
+ *
+ * @return zero(0) or negative error code.
+ */
+int chan_list_poll_begin_isr(struct chan_list_t *list_p);
+
+/**
+ * Remove the calling thread as the polling reader of all channels in
+ * given list.
+ *
+ * This function may only be called with the system lock taken (see
+ * `sys_lock()`).
+ *
+ * @param[in] list_p List of channels that were polled.
+ *
+ * @return zero(0) or negative error code.
+ */
+int chan_list_poll_end_isr(struct chan_list_t *list_p);
+
 #endif
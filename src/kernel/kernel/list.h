@@ -110,10 +110,10 @@ struct list_sl_iterator_t {
             if ((previous_element_p) != NULL) {                         \
                 (previous_element_p)->next_p = (element_p)->next_p;     \
             } else {                                                    \
-                (list_p)->head_p = NULL;                                \
+                (list_p)->head_p = (element_p)->next_p;                 \
             }                                                           \
-            if ((element_p)->next_p == NULL) {                          \
-                (list_p)->tail_p = NULL;                                \
+            if ((list_p)->tail_p == (element_p)) {                      \
+                (list_p)->tail_p = (previous_element_p);                \
             }                                                           \
             break;                                                      \
         }                                                               \
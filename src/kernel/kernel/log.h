@@ -48,15 +48,28 @@
 /** Set all levels up to and including mask. */
 #define LOG_UPTO(level) ((1 << (LOG_ ## level + 1)) - 1)
 
+/* Total size of the log rings in bytes. */
 #if !defined(LOG_BUFFER_SIZE)
 #    define LOG_BUFFER_SIZE 256
 #endif
 
+/* Number of log rings. Threads are assigned a ring by priority, the
+   highest priority threads to ring 0. A thread writing many entries
+   only evicts entries of threads in the same ring. */
+#if !defined(LOG_RINGS)
+#    define LOG_RINGS 2
+#endif
+
+/* Size of each log ring in bytes. */
+#if !defined(LOG_RING_SIZE)
+#    define LOG_RING_SIZE (LOG_BUFFER_SIZE / LOG_RINGS)
+#endif
+
 /** No logging. */
 #define LOG_MODE_OFF      0
 /** Circular logging. This is the default behaviour. */
 #define LOG_MODE_CIRCULAR 1
-/** Turn off logging when the buffer is full. */
+/** Drop new entries when the ring is full. */
 #define LOG_MODE_CAPTURE  2
 
 #define LOG_NAME TOKENPASTE(log_, UNIQUE(MODULE_NAME))
@@ -97,10 +110,6 @@ struct log_entry_header_t {
     int id;
 };
 
-struct log_entry_footer_t {
-    size_t size;
-};
-
 /**
  * Initialize the logging module.
  *
@@ -109,8 +118,8 @@ struct log_entry_footer_t {
 int log_module_init(void);
 
 /**
- * Reset the log module. Clears the log and sets the log mode to
- * circular.
+ * Reset the log module. Clears the log rings and their drop counters,
+ * and sets the log mode to circular.
  *
  * @return zero(0) or negative error code.
  */
@@ -134,7 +143,8 @@ int log_set_mode(int mode);
 int log_get_mode(void);
 
 /**
- * Add log entry to log.
+ * Add log entry to the log ring of the current thread. Entries in
+ * different rings are written in parallel.
  *
  * @param[in] level Log level.
  * @param[in] id Log point identity.
@@ -147,12 +157,25 @@ int log_get_mode(void);
 int log_write(char level, int id, void *buf_p, size_t size);
 
 /**
- * Format all entries in the log and write them to given channel.
+ * Format all entries in the log and write them to given channel,
+ * oldest first. The entries in the rings are merged by entry number.
  *
  * @param[in] chout_p Output channel.
  *
- * @return zero(0) or negative error code.
+ * @return Number of formatted entries or negative error code.
  */
 int log_format(chan_t *chout_p);
 
+/**
+ * Get the number of entries dropped by given log ring. An entry is
+ * dropped if it is evicted by a newer entry in circular mode, if the
+ * ring is full in capture mode, if the log is off or if it does not
+ * fit in the ring.
+ *
+ * @param[in] ring Log ring [0..LOG_RINGS - 1].
+ *
+ * @return Number of dropped entries or negative error code.
+ */
+long log_get_dropped(int ring);
+
 #endif
@@ -0,0 +1,203 @@
+/**
+ * @file kernel/mailbox.h
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#ifndef __KERNEL_MAILBOX_H__
+#define __KERNEL_MAILBOX_H__
+
+#include "simba.h"
+
+/**
+ * Declare a buffer for a mailbox of given number of messages of given
+ * size, suitably aligned for any message.
+ *
+ * @param[in] name Buffer name.
+ * @param[in] message_size Message size in bytes.
+ * @param[in] length Number of messages.
+ */
+#define MAILBOX_BUFFER(name, message_size, length)                      \
+    uint64_t name[DIV_CEIL((message_size) * (length), sizeof(uint64_t))]
+
+struct mailbox_elem_t;
+
+/* A mailbox of fixed size messages. */
+struct mailbox_t {
+    struct chan_t base;
+    char *buf_p;
+    size_t message_size;
+    size_t length;
+    size_t read;
+    size_t count;
+    /* Threads waiting for messages. */
+    struct mailbox_elem_t *readers_p;
+    /* Threads waiting for free space. */
+    struct mailbox_elem_t *writers_p;
+};
+
+/**
+ * Initialize the mailbox module.
+ *
+ * @return zero(0) or negative error code
+ */
+int mailbox_module_init(void);
+
+/**
+ * Initialize given mailbox with room for given number of messages of
+ * given size. Declare the buffer with `MAILBOX_BUFFER()` to get the
+ * alignment right.
+ *
+ * A mailbox is also a channel. Reading from and writing to the
+ * channel transfers whole messages, and the size must be a multiple
+ * of the message size. The size of the channel is the number of
+ * messages in the mailbox.
+ *
+ * @param[in] self_p Mailbox to initialize.
+ * @param[in] buf_p Buffer of at least `message_size * length` bytes.
+ * @param[in] message_size Size of each message.
+ * @param[in] length Maximum number of messages in the mailbox.
+ *
+ * @return zero(0) or negative error code.
+ */
+int mailbox_init(struct mailbox_t *self_p,
+                 void *buf_p,
+                 size_t message_size,
+                 size_t length);
+
+/**
+ * Initialize given mailbox for passing pointers, for example to
+ * blocks allocated from a pool (see `pool_alloc()`). Only the
+ * pointers are copied, and the receiver becomes the owner of the
+ * memory they point to. Use `mailbox_send_ptr()` and
+ * `mailbox_recv_ptr()` on the mailbox.
+ *
+ * @param[in] self_p Mailbox to initialize.
+ * @param[in] buf_pp Buffer of given number of pointers.
+ * @param[in] length Maximum number of pointers in the mailbox.
+ *
+ * @return zero(0) or negative error code.
+ */
+int mailbox_init_ptr(struct mailbox_t *self_p,
+                     void **buf_pp,
+                     size_t length);
+
+/**
+ * Copy given message into given mailbox. The calling thread is
+ * suspended until there is room for the message, or the timeout
+ * expires. Waiting writers are served first in, first out.
+ *
+ * @param[in] self_p Mailbox to send to.
+ * @param[in] msg_p Message of the mailbox message size.
+ * @param[in] timeout_p Timeout, or NULL to wait forever. A zero
+ *                      timeout never waits.
+ *
+ * @return zero(0) or negative error code. -ETIMEDOUT if the mailbox
+ *         was full until the timeout expired.
+ */
+int mailbox_send(struct mailbox_t *self_p,
+                 const void *msg_p,
+                 struct time_t *timeout_p);
+
+/**
+ * See `mailbox_send()` for a description. Never waits.
+ *
+ * This function may only be called with the system lock taken (see
+ * `sys_lock()`), for example from an interrupt handler.
+ *
+ * @return zero(0) or negative error code. -ENOSPC if the mailbox is
+ *         full.
+ */
+int mailbox_send_isr(struct mailbox_t *self_p,
+                     const void *msg_p);
+
+/**
+ * Receive the oldest message from given mailbox. The calling thread
+ * is suspended until a message is available, or the timeout expires.
+ * Waiting readers are served first in, first out.
+ *
+ * @param[in] self_p Mailbox to receive from.
+ * @param[out] msg_p Buffer of the mailbox message size.
+ * @param[in] timeout_p Timeout, or NULL to wait forever. A zero
+ *                      timeout never waits.
+ *
+ * @return zero(0) or negative error code. -ETIMEDOUT if the mailbox
+ *         was empty until the timeout expired.
+ */
+int mailbox_recv(struct mailbox_t *self_p,
+                 void *msg_p,
+                 struct time_t *timeout_p);
+
+/**
+ * Receive up to given number of messages from given mailbox in one
+ * call. The calling thread is suspended until at least one message
+ * is available, or the timeout expires, and then gets all available
+ * messages up to given number.
+ *
+ * @param[in] self_p Mailbox to receive from.
+ * @param[out] msgs_p Buffer of `length` messages.
+ * @param[in] length Maximum number of messages to receive.
+ * @param[in] timeout_p Timeout, or NULL to wait forever. A zero
+ *                      timeout never waits.
+ *
+ * @return Number of received messages or negative error
+ *         code. -ETIMEDOUT if the mailbox was empty until the timeout
+ *         expired.
+ */
+ssize_t mailbox_recv_n(struct mailbox_t *self_p,
+                       void *msgs_p,
+                       size_t length,
+                       struct time_t *timeout_p);
+
+/**
+ * Send given pointer on given mailbox, initialized with
+ * `mailbox_init_ptr()`. See `mailbox_send()` for details.
+ *
+ * @param[in] self_p Mailbox to send to.
+ * @param[in] ptr_p Pointer to send.
+ * @param[in] timeout_p Timeout, or NULL to wait forever.
+ *
+ * @return zero(0) or negative error code.
+ */
+int mailbox_send_ptr(struct mailbox_t *self_p,
+                     void *ptr_p,
+                     struct time_t *timeout_p);
+
+/**
+ * Receive a pointer from given mailbox, initialized with
+ * `mailbox_init_ptr()`. See `mailbox_recv()` for details.
+ *
+ * @param[in] self_p Mailbox to receive from.
+ * @param[out] ptr_pp Received pointer.
+ * @param[in] timeout_p Timeout, or NULL to wait forever.
+ *
+ * @return zero(0) or negative error code.
+ */
+int mailbox_recv_ptr(struct mailbox_t *self_p,
+                     void **ptr_pp,
+                     struct time_t *timeout_p);
+
+/**
+ * Get the number of messages in given mailbox.
+ *
+ * @param[in] self_p Mailbox.
+ *
+ * @return Number of messages in the mailbox.
+ */
+size_t mailbox_count(struct mailbox_t *self_p);
+
+#endif
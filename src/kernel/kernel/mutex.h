@@ -0,0 +1,88 @@
+/**
+ * @file kernel/mutex.h
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#ifndef __KERNEL_MUTEX_H__
+#define __KERNEL_MUTEX_H__
+
+#include "simba.h"
+
+/**
+ * Compile-time declaration of a mutex.
+ *
+ * @param[in] name Mutex to initialize.
+ */
+#define MUTEX_INIT_DECL(name)                                           \
+    struct mutex_t name = { .owner_p = NULL, .head_p = NULL, .next_p = NULL }
+
+struct mutex_elem_t;
+
+struct mutex_t {
+    struct thrd_t *owner_p;
+    struct mutex_elem_t *head_p;
+    struct mutex_t *next_p;
+};
+
+/**
+ * Initialize the mutex module.
+ *
+ * @return zero(0) or negative error code
+ */
+int mutex_module_init(void);
+
+/**
+ * Initialize given mutex object.
+ *
+ * @param[in] self_p Mutex to initialize.
+ *
+ * @return zero(0) or negative error code.
+ */
+int mutex_init(struct mutex_t *self_p);
+
+/**
+ * Lock given mutex. If the mutex is owned by another thread the
+ * calling thread is suspended until the mutex is unlocked or the
+ * timeout expires. While waiting, the owner inherits the priority of
+ * the calling thread if it is higher than the owner's. Inheritance
+ * is transitive through nested mutexes.
+ *
+ * @param[in] self_p Mutex to lock.
+ * @param[in] timeout_p Timeout, or NULL to wait forever.
+ *
+ * @return zero(0) or negative error code. -EDEADLK if the calling
+ *         thread already owns the mutex, and -ETIMEDOUT on timeout.
+ */
+int mutex_lock(struct mutex_t *self_p,
+               struct time_t *timeout_p);
+
+/**
+ * Unlock given mutex. The ownership is passed to the waiting thread
+ * with the highest priority, if any. The calling thread drops any
+ * priority it inherited through this mutex.
+ *
+ * A thread must unlock all mutexes it owns before it terminates.
+ *
+ * @param[in] self_p Mutex to unlock.
+ *
+ * @return zero(0) or negative error code. -EPERM if the calling
+ *         thread does not own the mutex.
+ */
+int mutex_unlock(struct mutex_t *self_p);
+
+#endif
@@ -0,0 +1,156 @@
+/**
+ * @file kernel/pool.h
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#ifndef __KERNEL_POOL_H__
+#define __KERNEL_POOL_H__
+
+#include "simba.h"
+
+/* Maximum number of free blocks in each per-cpu cache. Zero
+   disables the caches. Only used when there is more than one cpu. */
+#if !defined(POOL_CACHE_SIZE)
+#    define POOL_CACHE_SIZE 8
+#endif
+
+/**
+ * Declare a buffer for a pool of given number of blocks of given
+ * size, suitably aligned for any block.
+ *
+ * @param[in] name Buffer name.
+ * @param[in] block_size Block size in bytes.
+ * @param[in] blocks Number of blocks.
+ */
+#define POOL_BUFFER(name, block_size, blocks)                           \
+    uint64_t name[DIV_CEIL((block_size), sizeof(uint64_t)) * (blocks)]
+
+struct pool_block_t;
+
+/* A per-cpu cache of free blocks. */
+struct pool_cache_t {
+    struct pool_block_t *free_p;
+    int length;
+};
+
+/* A pool of fixed size blocks. */
+struct pool_t {
+    struct pool_block_t *free_p;
+    char *begin_p;
+    char *end_p;
+    size_t block_size;
+    size_t used;
+    long long *high_water_p;
+    long long *failures_p;
+    struct {
+        long long high_water;
+        long long failures;
+    } counters;
+#if THRD_NCPUS > 1
+    int cache_size;
+    struct pool_cache_t caches[THRD_NCPUS];
+#endif
+};
+
+/**
+ * Initialize the pool module.
+ *
+ * @return zero(0) or negative error code
+ */
+int pool_module_init(void);
+
+/**
+ * Initialize given pool with as many blocks of given size as fit in
+ * given buffer. Declare the buffer with `POOL_BUFFER()` to get the
+ * alignment right.
+ *
+ * @param[in] self_p Pool to initialize.
+ * @param[in] buf_p Buffer the blocks are allocated from.
+ * @param[in] size Size of the buffer.
+ * @param[in] block_size Size of each block. Rounded up to a multiple
+ *                       of eight bytes.
+ *
+ * @return zero(0) or negative error code.
+ */
+int pool_init(struct pool_t *self_p,
+              void *buf_p,
+              size_t size,
+              size_t block_size);
+
+/**
+ * Use given counters, typically defined with `COUNTER_DEFINE()`, for
+ * the high water mark and the allocation failures of given pool,
+ * making them visible in the debug file system. The high water mark
+ * is the largest number of blocks in use at the same time. Blocks in
+ * the per-cpu caches count as in use.
+ *
+ * @param[in] self_p Pool.
+ * @param[in] high_water_p High water mark counter, or NULL to keep
+ *                         the current.
+ * @param[in] failures_p Allocation failure counter, or NULL to keep
+ *                       the current.
+ *
+ * @return zero(0) or negative error code.
+ */
+int pool_set_counters(struct pool_t *self_p,
+                      long long *high_water_p,
+                      long long *failures_p);
+
+/**
+ * Allocate a block from given pool in O(1) time.
+ *
+ * On SMP builds freed blocks are kept in a small per-cpu cache so
+ * that most calls do not take the system lock. A block may be freed
+ * on another cpu than it was allocated on.
+ *
+ * @param[in] self_p Pool to allocate from.
+ *
+ * @return Allocated block, or NULL if the pool is empty.
+ */
+void *pool_alloc(struct pool_t *self_p);
+
+/**
+ * Return given block to given pool in O(1) time.
+ *
+ * @param[in] self_p Pool the block was allocated from.
+ * @param[in] block_p Block to free.
+ *
+ * @return zero(0) or negative error code. -EINVAL if given block
+ *         does not belong to given pool.
+ */
+int pool_free(struct pool_t *self_p, void *block_p);
+
+/**
+ * See `pool_alloc()` for a description. Never uses the per-cpu
+ * caches.
+ *
+ * This function may only be called with the system lock taken (see
+ * `sys_lock()`), for example from an interrupt handler.
+ */
+void *pool_alloc_isr(struct pool_t *self_p);
+
+/**
+ * See `pool_free()` for a description. Never uses the per-cpu
+ * caches.
+ *
+ * This function may only be called with the system lock taken (see
+ * `sys_lock()`), for example from an interrupt handler.
+ */
+int pool_free_isr(struct pool_t *self_p, void *block_p);
+
+#endif
@@ -30,6 +30,9 @@
             .read = (ssize_t (*)(void *, void *, size_t))queue_read,    \
             .write = (ssize_t (*)(void *, const void *, size_t))queue_write, \
             .size = (size_t (*)(void *))queue_size,                     \
+            .readv = (ssize_t (*)(void *, struct iov_t *, size_t))queue_readv, \
+            .writev = (ssize_t (*)(void *, struct iov_t *, size_t))queue_writev, \
+            .lock = SYS_OBJECT_LOCK_INIT,                               \
             .writer_p = NULL,                                           \
             .reader_p = NULL,                                           \
             .list_p = NULL                                              \
@@ -52,6 +55,12 @@ struct queue_buffer_t{
     char *end_p;
 };
 
+/* A contiguous part of a queue buffer. */
+struct queue_span_t {
+    char *buf_p;
+    size_t size;
+};
+
 /* Queue. */
 struct queue_t {
     struct chan_t base;
@@ -61,6 +70,29 @@ struct queue_t {
     size_t left;
 };
 
+/* Ring indices of the single producer, single consumer queue. They
+   must be loaded and stored with a single instruction. */
+#if defined(ARCH_AVR)
+typedef uint8_t queue_spsc_index_t;
+#else
+typedef size_t queue_spsc_index_t;
+#endif
+
+/* Single producer, single consumer queue. */
+struct queue_spsc_t {
+    struct chan_t base;
+    char *buf_p;
+    queue_spsc_index_t mask;
+    /* Free running indices, written by the consumer and the producer
+       respectively. */
+    queue_spsc_index_t read;
+    queue_spsc_index_t write;
+    /* Number of bytes the blocked reader waits for, and number of
+       free bytes the blocked writer waits for. */
+    size_t reader_wanted;
+    size_t writer_wanted;
+};
+
 /**
  * Initialize given queue.
  *
@@ -101,6 +133,34 @@ ssize_t queue_write(struct queue_t *self_p,
                     const void *buf_p,
                     size_t size);
 
+/**
+ * Read into given parts from given queue with the system lock taken
+ * once. Blocks until all parts have been filled.
+ *
+ * @param[in] self_p Queue to read from.
+ * @param[in] iov_p Parts to read into.
+ * @param[in] length Number of parts.
+ *
+ * @return Number of read bytes or negative error code.
+ */
+ssize_t queue_readv(struct queue_t *self_p,
+                    struct iov_t *iov_p,
+                    size_t length);
+
+/**
+ * Write given parts to given queue with the system lock taken
+ * once. Blocks until all parts have been written.
+ *
+ * @param[in] self_p Queue to write to.
+ * @param[in] iov_p Parts to write.
+ * @param[in] length Number of parts.
+ *
+ * @return Number of written bytes or negative error code.
+ */
+ssize_t queue_writev(struct queue_t *self_p,
+                     struct iov_t *iov_p,
+                     size_t length);
+
 /**
  * Write bytes to given queue from isr or with the system lock
  * taken (see `sys_lock()`). May write less than size bytes.
@@ -125,4 +185,168 @@ ssize_t queue_write_isr(struct queue_t *self_p,
  */
 ssize_t queue_size(struct queue_t *self_p);
 
+/**
+ * Reserve up to size bytes of unused space in given queue, to be
+ * written in place by the caller. The space is described by two
+ * spans, where the second span is non-empty only if the space wraps
+ * around the end of the queue buffer. The written data is made
+ * available to the reader by `queue_write_commit()`. Never blocks,
+ * and must not be mixed with `queue_write()` on the same queue.
+ *
+ * @param[in] self_p Queue to reserve space in. Must have a buffer.
+ * @param[out] spans Reserved space.
+ * @param[in] size Number of bytes to reserve.
+ *
+ * @return Number of reserved bytes or negative error code.
+ */
+ssize_t queue_write_reserve(struct queue_t *self_p,
+                            struct queue_span_t spans[2],
+                            size_t size);
+
+/**
+ * Same as `queue_write_reserve()`, but from isr or with the system
+ * lock taken (see `sys_lock()`).
+ *
+ * @param[in] self_p Queue to reserve space in. Must have a buffer.
+ * @param[out] spans Reserved space.
+ * @param[in] size Number of bytes to reserve.
+ *
+ * @return Number of reserved bytes or negative error code.
+ */
+ssize_t queue_write_reserve_isr(struct queue_t *self_p,
+                                struct queue_span_t spans[2],
+                                size_t size);
+
+/**
+ * Make the first size bytes of the space reserved by
+ * `queue_write_reserve()` available to the reader.
+ *
+ * @param[in] self_p Queue to commit to.
+ * @param[in] size Number of written bytes.
+ *
+ * @return Number of committed bytes or negative error code.
+ */
+ssize_t queue_write_commit(struct queue_t *self_p, size_t size);
+
+/**
+ * Same as `queue_write_commit()`, but from isr or with the system
+ * lock taken (see `sys_lock()`).
+ *
+ * @param[in] self_p Queue to commit to.
+ * @param[in] size Number of written bytes.
+ *
+ * @return Number of committed bytes or negative error code.
+ */
+ssize_t queue_write_commit_isr(struct queue_t *self_p, size_t size);
+
+/**
+ * Get the data in given queue without copying it. Blocks until at
+ * least one byte is available. The data is described by two spans,
+ * where the second span is non-empty only if the data wraps around
+ * the end of the queue buffer. The data stays in the queue until
+ * removed by `queue_read_consume()`.
+ *
+ * @param[in] self_p Queue to peek into. Must have a buffer.
+ * @param[out] spans Available data.
+ *
+ * @return Number of available bytes or negative error code.
+ */
+ssize_t queue_read_peek(struct queue_t *self_p,
+                        struct queue_span_t spans[2]);
+
+/**
+ * Remove size bytes of the data returned by `queue_read_peek()` from
+ * given queue.
+ *
+ * @param[in] self_p Queue to consume from.
+ * @param[in] size Number of bytes to remove.
+ *
+ * @return Number of removed bytes or negative error code.
+ */
+ssize_t queue_read_consume(struct queue_t *self_p, size_t size);
+
+/**
+ * Read from given queue until given delimiter has been read or the
+ * buffer is full. The delimiter is included in the read data.
+ *
+ * @param[in] self_p Queue to read from. Must have a buffer.
+ * @param[in] buf_p Buffer to read to.
+ * @param[in] size Size of the buffer.
+ * @param[in] delim Delimiter.
+ *
+ * @return Number of read bytes or negative error code.
+ */
+ssize_t queue_read_until(struct queue_t *self_p,
+                         void *buf_p,
+                         size_t size,
+                         char delim);
+
+/**
+ * Initialize given single producer, single consumer queue. There may
+ * be at most one reader and one writer, for example one interrupt
+ * service routine writing and one thread reading. Data is copied to
+ * and from the buffer without taking the system lock, which is only
+ * taken to wake or suspend a blocked reader or writer.
+ *
+ * @param[in] self_p Queue to initialize.
+ * @param[in] buf_p Buffer.
+ * @param[in] size Size of buffer. Must be a power of two. At most 128
+ *                 bytes on AVR.
+ *
+ * @return zero(0) or negative error code
+ */
+int queue_spsc_init(struct queue_spsc_t *self_p,
+                    void *buf_p,
+                    size_t size);
+
+/**
+ * Read from given queue. Blocks until size bytes has been read.
+ *
+ * @param[in] self_p Queue to read from.
+ * @param[in] buf_p Buffer to read to.
+ * @param[in] size Size to read.
+ *
+ * @return Number of read bytes or negative error code.
+ */
+ssize_t queue_spsc_read(struct queue_spsc_t *self_p,
+                        void *buf_p,
+                        size_t size);
+
+/**
+ * Write bytes to given queue. Blocks until size bytes has been
+ * written. Must not be called with the system lock taken.
+ *
+ * @param[in] self_p Queue to write to.
+ * @param[in] buf_p Buffer to write from.
+ * @param[in] size Number of bytes to write.
+ *
+ * @return Number of written bytes or negative error code.
+ */
+ssize_t queue_spsc_write(struct queue_spsc_t *self_p,
+                         const void *buf_p,
+                         size_t size);
+
+/**
+ * Write bytes to given queue from isr or with the system lock
+ * taken (see `sys_lock()`). May write less than size bytes.
+ *
+ * @param[in] self_p Queue to write to.
+ * @param[in] buf_p Buffer to write from.
+ * @param[in] size Number of bytes to write.
+ *
+ * @return Number of written bytes or negative error code.
+ */
+ssize_t queue_spsc_write_isr(struct queue_spsc_t *self_p,
+                             const void *buf_p,
+                             size_t size);
+
+/**
+ * Get the number of bytes currently stored in the queue.
+ *
+ * @param[in] self_p Queue.
+ *
+ * @return Number of bytes in queue.
+ */
+ssize_t queue_spsc_size(struct queue_spsc_t *self_p);
+
 #endif
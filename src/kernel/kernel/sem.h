@@ -23,6 +23,10 @@
 
 #include "simba.h"
 
+/* Order in which waiting threads get the semaphore. */
+#define SEM_ORDER_FIFO                                    0
+#define SEM_ORDER_PRIO                                    1
+
 /**
  * Compile-time declaration of a semaphore.
  *
@@ -30,13 +34,28 @@
  * @param[in] count Initial semaphore count.
  */
 #define SEM_INIT_DECL(name, _count)                             \
-    struct sem_t name = { .count = _count, .head_p = NULL }
+    struct sem_t name = {                                       \
+        .count = _count,                                        \
+        .order = SEM_ORDER_FIFO,                                \
+        .head_p = NULL,                                         \
+        .tail_p = NULL,                                         \
+        .lock = SYS_OBJECT_LOCK_INIT                            \
+    }
 
-struct sem_elem_t;
+/* A waiter in the queue of a semaphore. */
+struct sem_elem_t {
+    struct sem_elem_t *next_p;
+    struct sem_elem_t *prev_p;
+    struct thrd_t *thrd_p;
+};
 
 struct sem_t {
     int count;
+    int order;
     struct sem_elem_t *head_p;
+    struct sem_elem_t *tail_p;
+    /* Taken after the system lock (see `sys_lock()`). */
+    struct sys_object_lock_t lock;
 };
 
 /**
@@ -58,10 +77,27 @@ int sem_module_init(void);
 int sem_init(struct sem_t *self_p,
              int count);
 
+/**
+ * Set the order in which waiting threads get given semaphore. By
+ * default waiting threads are served first in, first out
+ * (`SEM_ORDER_FIFO`). With `SEM_ORDER_PRIO` the waiting thread with
+ * the highest priority is served first, and threads with equal
+ * priority first in, first out. The order can only be changed when
+ * no threads are waiting for the semaphore.
+ *
+ * @param[in] self_p Semaphore.
+ * @param[in] order `SEM_ORDER_FIFO` or `SEM_ORDER_PRIO`.
+ *
+ * @return zero(0) or negative error code.
+ */
+int sem_set_order(struct sem_t *self_p,
+                  int order);
+
 /**
  * Get given semaphore. If the semaphore count is zero the calling
  * thread will be suspended until count is incremented by a
- * `sem_put()` call.
+ * `sem_put()` call. The calling thread is queued after already
+ * waiting threads, see `sem_set_order()`.
  *
  * @param[in] self_p Semaphore to get.
  * @param[in] timeout_p Timeout.
@@ -71,6 +107,43 @@ int sem_init(struct sem_t *self_p,
 int sem_get(struct sem_t *self_p,
             struct time_t *timeout_p);
 
+/**
+ * Get given semaphore without waiting if its count is non-zero.
+ * Otherwise add given element to the queue of waiting threads on
+ * behalf of the calling thread, without suspending it. When the
+ * element gets the semaphore its thread pointer is set to NULL and
+ * the thread is resumed (see `thrd_resume_isr()`). Remove an element
+ * that is still queued with `sem_cancel_isr()`.
+ *
+ * This function may only be called with the system lock taken (see
+ * `sys_lock()`).
+ *
+ * @param[in] self_p Semaphore to get.
+ * @param[in] elem_p Element to queue. Must be kept until it gets the
+ *                   semaphore or is removed from the queue.
+ *
+ * @return zero(0) if the semaphore was taken, -EAGAIN if given
+ *         element was queued, or negative error code.
+ */
+int sem_wait_isr(struct sem_t *self_p,
+                 struct sem_elem_t *elem_p);
+
+/**
+ * Remove given element, queued by `sem_wait_isr()`, from the queue
+ * of waiting threads. The semaphore is put back if the element
+ * already got it.
+ *
+ * This function may only be called with the system lock taken (see
+ * `sys_lock()`).
+ *
+ * @param[in] self_p Semaphore.
+ * @param[in] elem_p Queued element.
+ *
+ * @return zero(0) or negative error code.
+ */
+int sem_cancel_isr(struct sem_t *self_p,
+                   struct sem_elem_t *elem_p);
+
 /**
  * Add given count to given semaphore. Any blocked thread waiting for
  * this semaphore, in `sem_get()`, is unblocked. This continues until
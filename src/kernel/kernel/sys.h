@@ -112,9 +112,38 @@ void sys_set_stdout(chan_t *chan);
  */
 chan_t *sys_get_stdout(void);
 
+/**
+ * Get the current system tick. Ports that do not tick periodically
+ * bring the tick up to date first.
+ *
+ * @return Current system tick.
+ */
+sys_tick_t sys_get_tick(void);
+
+/**
+ * Get the current system tick from isr or with the system lock
+ * taken.
+ *
+ * @return Current system tick.
+ */
+sys_tick_t sys_get_tick_isr(void);
+
 /**
  * Take the system lock. Normally turns off interrupts.
  *
+ * The system lock protects the scheduler, thread and timer state.
+ * Queues, events, semaphores and the log buffer have their own
+ * object lock, see `sys_object_lock()`. The lock order is:
+ *
+ * 1. The system lock.
+ * 2. One object lock.
+ *
+ * The system lock must never be taken with an object lock held, and
+ * at most one object lock may be held at a time. An operation that
+ * may suspend or resume a thread therefore takes the system lock
+ * first, and an operation that only touches the object takes the
+ * object lock only.
+ *
  * @return void.
  */
 void sys_lock(void);
@@ -141,6 +170,81 @@ void sys_lock_isr(void);
  */
 void sys_unlock_isr(void);
 
+#if defined(SYS_LOCK_PROFILE)
+
+/* Number of call sites recorded by the lock profiler. Later call
+   sites are counted together. */
+#if !defined(SYS_LOCK_PROFILE_SITES_MAX)
+#    define SYS_LOCK_PROFILE_SITES_MAX 32
+#endif
+
+/* Number of log2 buckets in the hold time histogram. The first
+   bucket is hold times below 64 ns, and the last one is 1 ms and
+   above. */
+#define SYS_LOCK_PROFILE_BUCKETS 16
+
+/* In the lock profiling build, built with `SYS_LOCK_PROFILE=yes`,
+   the hold time of the system lock is recorded per call site. The
+   statistics are listed by `/kernel/sys/lock_stats/list`. */
+#define sys_lock() sys_lock_profile(__FILE__, __LINE__)
+#define sys_lock_isr() sys_lock_isr_profile(__FILE__, __LINE__)
+
+/**
+ * Take the system lock and record given call site as its
+ * holder. Used by `sys_lock()` in the lock profiling build.
+ *
+ * @param[in] file_p Source file of the call site.
+ * @param[in] line Line of the call site.
+ *
+ * @return void.
+ */
+void sys_lock_profile(const char *file_p, int line);
+
+/**
+ * See `sys_lock_profile()`.
+ */
+void sys_lock_isr_profile(const char *file_p, int line);
+
+/**
+ * Reset the lock profiler statistics.
+ *
+ * @return zero(0) or negative error code.
+ */
+int sys_lock_stats_reset(void);
+
+#endif
+
+/**
+ * Initialize given kernel object lock. `SYS_OBJECT_LOCK_INIT` may be
+ * used instead for compile time initialization.
+ *
+ * @param[in] lock_p Lock to initialize.
+ *
+ * @return void.
+ */
+void sys_object_lock_init(struct sys_object_lock_t *lock_p);
+
+/**
+ * Take given kernel object lock. May be called from isr and with the
+ * system lock taken, but not with another object lock taken (see
+ * `sys_lock()`). The lock must not be held when the thread is
+ * suspended.
+ *
+ * @param[in] lock_p Lock to take.
+ *
+ * @return void.
+ */
+void sys_object_lock(struct sys_object_lock_t *lock_p);
+
+/**
+ * Release given kernel object lock.
+ *
+ * @param[in] lock_p Lock to release.
+ *
+ * @return void.
+ */
+void sys_object_unlock(struct sys_object_lock_t *lock_p);
+
 /**
  * Get a pointer to the application information buffer.
  *
@@ -0,0 +1,259 @@
+/**
+ * @file kernel/task.h
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#ifndef __KERNEL_TASK_H__
+#define __KERNEL_TASK_H__
+
+#include "simba.h"
+
+/* Task function return values. */
+#define TASK_WAITING                                      0
+#define TASK_EXITED                                       1
+
+/* What a task is waiting for. */
+#define TASK_WAIT_NONE                                    0
+#define TASK_WAIT_CHAN                                    1
+#define TASK_WAIT_EVENT                                   2
+#define TASK_WAIT_SEM                                     3
+#define TASK_WAIT_SLEEP                                   4
+
+/**
+ * Start of the task function body. Local variables are not kept when
+ * the task waits, so keep the task state in a structure reachable
+ * from the task, for example in `arg_p`.
+ *
+ * @param[in] self_p Task.
+ */
+#define TASK_BEGIN(self_p) switch ((self_p)->line) { case 0:
+
+/**
+ * End of the task function body. The task exits.
+ *
+ * @param[in] self_p Task.
+ */
+#define TASK_END(self_p) } (self_p)->line = 0; return (TASK_EXITED)
+
+/**
+ * Return to the executor and continue here when the task is
+ * run again. Only used by the other macros.
+ */
+#define TASK_WAIT_POINT(self_p)                                         \
+    (self_p)->line = __LINE__; return (TASK_WAITING); case __LINE__:
+
+/**
+ * Let the other ready tasks run before continuing.
+ *
+ * @param[in] self_p Task.
+ */
+#define TASK_YIELD(self_p)                                              \
+    do {                                                                \
+        (self_p)->wait = TASK_WAIT_NONE;                                \
+        TASK_WAIT_POINT(self_p);                                        \
+    } while (0)
+
+/**
+ * Wait until given channel has data to read. A following read of at
+ * most `chan_size()` bytes does not block.
+ *
+ * @param[in] self_p Task.
+ * @param[in] chan_p Channel to wait for, for example a queue.
+ */
+#define TASK_AWAIT_CHAN(self_p, chan_p)                                 \
+    while (chan_size(chan_p) == 0) {                                    \
+        task_await_chan(self_p, chan_p);                                \
+        TASK_WAIT_POINT(self_p);                                        \
+    }
+
+/**
+ * Wait until at least one event in given mask is set in given event
+ * channel. A following `event_read()` with the same mask does not
+ * block.
+ *
+ * @param[in] self_p Task.
+ * @param[in] event_p Event channel to wait for.
+ * @param[in] events Events to wait for.
+ */
+#define TASK_AWAIT_EVENT(self_p, event_p, events)                       \
+    while (((event_p)->mask & (events)) == 0) {                         \
+        task_await_event(self_p, event_p, events);                      \
+        TASK_WAIT_POINT(self_p);                                        \
+    }
+
+/**
+ * Get given semaphore, waiting until it is available. The task is
+ * queued on the semaphore like a thread (see `sem_get()`).
+ *
+ * @param[in] self_p Task.
+ * @param[in] sem_p Semaphore to get.
+ */
+#define TASK_AWAIT_SEM(self_p, sem_p)                                   \
+    do {                                                                \
+        if (task_await_sem(self_p, sem_p) != 0) {                       \
+            TASK_WAIT_POINT(self_p);                                    \
+        }                                                               \
+    } while (0)
+
+/**
+ * Wait given time.
+ *
+ * @param[in] self_p Task.
+ * @param[in] timeout_p Time to wait.
+ */
+#define TASK_SLEEP(self_p, timeout_p)                                   \
+    do {                                                                \
+        task_await_sleep(self_p, timeout_p);                            \
+        TASK_WAIT_POINT(self_p);                                        \
+    } while (0)
+
+struct task_t;
+
+/**
+ * A task function. Called by the executor each time the task is run,
+ * and continues where the task last waited.
+ *
+ * @return `TASK_WAITING` or `TASK_EXITED`, returned by the task
+ *         macros.
+ */
+typedef int (*task_fn_t)(struct task_t *self_p);
+
+/* A stackless task. */
+struct task_t {
+    struct task_t *next_p;
+    struct task_executor_t *executor_p;
+    task_fn_t fn;
+    void *arg_p;
+    int line;
+    int wait;
+    union {
+        chan_t *chan_p;
+        struct {
+            struct event_t *event_p;
+            uint32_t mask;
+        } event;
+        struct {
+            struct sem_t *sem_p;
+            struct sem_elem_t elem;
+        } sem;
+        uint32_t expiry;
+    } u;
+};
+
+/* Runs tasks in a thread. */
+struct task_executor_t {
+    struct task_t *head_p;
+    /* Spawned tasks not yet added to the list above. */
+    struct task_t *spawned_p;
+    struct thrd_t *thrd_p;
+    /* Channels the tasks are waiting for. */
+    struct chan_list_t chans;
+};
+
+/**
+ * Initialize the task module.
+ *
+ * @return zero(0) or negative error code
+ */
+int task_module_init(void);
+
+/**
+ * Initialize given executor. The workspace holds the channels the
+ * tasks wait for at the same time, one pointer per channel. The
+ * executor wakes up every system tick while more channels are waited
+ * for.
+ *
+ * @param[in] self_p Executor to initialize.
+ * @param[in] workspace_p Workspace.
+ * @param[in] size Size of the workspace.
+ *
+ * @return zero(0) or negative error code.
+ */
+int task_executor_init(struct task_executor_t *self_p,
+                       void *workspace_p,
+                       size_t size);
+
+/**
+ * Spawn a thread that runs the tasks of given executor. The tasks
+ * run one at a time on the thread stack, so the stack must be large
+ * enough for the deepest task.
+ *
+ * @param[in] self_p Executor to start.
+ * @param[in] prio Thread priority.
+ * @param[in] stack_p Thread stack.
+ * @param[in] stack_size Thread stack size.
+ *
+ * @return Executor thread or NULL on failure.
+ */
+struct thrd_t *task_executor_start(struct task_executor_t *self_p,
+                                   int prio,
+                                   void *stack_p,
+                                   size_t stack_size);
+
+/**
+ * Initialize given task.
+ *
+ * @param[in] self_p Task to initialize.
+ * @param[in] fn Task function.
+ * @param[in] arg_p Task argument, available as `self_p->arg_p` in
+ *                  the task function.
+ *
+ * @return zero(0) or negative error code.
+ */
+int task_init(struct task_t *self_p,
+              task_fn_t fn,
+              void *arg_p);
+
+/**
+ * Add given task to given executor. The task is run from the
+ * beginning. May be called from any thread, including tasks.
+ *
+ * @param[in] self_p Task to spawn.
+ * @param[in] executor_p Executor to run the task.
+ *
+ * @return zero(0) or negative error code.
+ */
+int task_spawn(struct task_t *self_p,
+               struct task_executor_t *executor_p);
+
+/**
+ * Used by `TASK_AWAIT_CHAN()`.
+ */
+int task_await_chan(struct task_t *self_p, chan_t *chan_p);
+
+/**
+ * Used by `TASK_AWAIT_EVENT()`.
+ */
+int task_await_event(struct task_t *self_p,
+                     struct event_t *event_p,
+                     uint32_t mask);
+
+/**
+ * Used by `TASK_AWAIT_SEM()`.
+ *
+ * @return zero(0) if the semaphore was taken, otherwise the task
+ *         waits for it.
+ */
+int task_await_sem(struct task_t *self_p, struct sem_t *sem_p);
+
+/**
+ * Used by `TASK_SLEEP()`.
+ */
+int task_await_sleep(struct task_t *self_p, struct time_t *timeout_p);
+
+#endif
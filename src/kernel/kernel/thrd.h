@@ -26,11 +26,96 @@
 
 #define THRD_STACK(name, size) THRD_PORT_STACK(name, size)
 
+/* Number of cpus the scheduler runs threads on. Only the Linux
+   pthread port supports more than one cpu. */
+#if !defined(THRD_NCPUS)
+#    define THRD_NCPUS 1
+#endif
+
+/* The thread may run on any cpu. */
+#define THRD_CPU_ANY -1
+
+/* Number of log2 buckets in the wakeup latency histogram of a
+   thread. The first bucket is latencies below 1 us, and the last one
+   is 2^(THRD_STATS_LATENCY_BUCKETS - 2) us and above. */
+#if !defined(THRD_STATS_LATENCY_BUCKETS)
+#    define THRD_STATS_LATENCY_BUCKETS 12
+#endif
+
+/* Kinds of objects a thread waits on, see `thrd_suspend_on_isr()`. */
+#define THRD_WAIT_QUEUE                                   0
+#define THRD_WAIT_SEM                                     1
+#define THRD_WAIT_EVENT                                   2
+#define THRD_WAIT_MUTEX                                   3
+#define THRD_WAIT_SLEEP                                   4
+#define THRD_WAIT_OTHER                                   5
+#define THRD_WAIT_MAX                                     6
+
 struct thrd_parent_t {
     struct thrd_t *next_p;
     struct thrd_t *thrd_p;
 };
 
+struct thrd_join_elem_t;
+struct mutex_t;
+
+/* Scheduling statistics of a thread, listed by
+   `/kernel/thrd/stats`. Define NTHRDSTATS to leave them out, and
+   save reading the time on every suspend, resume and switch. */
+struct thrd_stats_t {
+    /* Number of times the thread was switched out when blocking
+       (voluntary), and when still ready to run after a yield or a
+       preemption (involuntary). */
+    uint32_t switches_voluntary;
+    uint32_t switches_involuntary;
+    /* Kind of object the thread waits on, and if it has been resumed
+       but not yet run. */
+    uint8_t wait;
+    uint8_t woken;
+    /* Time of the last suspend or resume in nanoseconds. */
+    uint64_t timestamp_ns;
+    /* Total time suspended per kind of object. */
+    uint64_t blocked_ns[THRD_WAIT_MAX];
+    /* Time from being resumed to running. */
+    uint32_t latency_max_ns;
+    uint32_t latency[THRD_STATS_LATENCY_BUCKETS];
+};
+
+/* Earliest deadline first scheduling parameters and statistics of a
+   thread, see `thrd_edf_start()`. Times are in system ticks. */
+struct thrd_edf_t {
+    uint32_t period;
+    /* Relative deadline. */
+    uint32_t deadline;
+    /* Worst case execution time divided by the smaller of the period
+       and the deadline, in units of 1/65536. */
+    uint32_t utilization;
+    /* Release time and absolute deadline of the current job. */
+    uint32_t release;
+    uint32_t job_deadline;
+    uint32_t jobs;
+    uint32_t misses;
+    int cpu;
+};
+
+/* Release time and statistics of a periodic thread, see
+   `thrd_periodic_start()`. */
+struct thrd_periodic_t {
+    /* Period and release time of the current job in system ticks. */
+    uint32_t period;
+    uint32_t release;
+    /* Time the current job started, in nanoseconds. */
+    uint64_t wakeup_ns;
+    /* Largest deviation of the time between the start of two jobs
+       from the time between their releases. */
+    uint64_t jitter_max_ns;
+    uint64_t exec_min_ns;
+    uint64_t exec_max_ns;
+    uint64_t exec_total_ns;
+    uint32_t jobs;
+    uint32_t overruns;
+};
+
 struct thrd_t {
     struct thrd_t *prev_p;
     struct thrd_t *next_p;
@@ -42,12 +127,35 @@ struct thrd_t {
     const char *name_p;
     struct thrd_parent_t parent;
     struct list_singly_linked_t children;
+    struct thrd_join_elem_t *joiners_p;
+    struct {
+        int prio;
+        struct mutex_t *owned_p;
+        struct mutex_t *waiting_p;
+    } pi;
+    /* Earliest deadline first parameters, or NULL for fixed priority
+       scheduling. */
+    struct thrd_edf_t *edf_p;
+    /* Periodic execution statistics, or NULL. */
+    struct thrd_periodic_t *periodic_p;
+#if !defined(NTHRDSTATS)
+    struct thrd_stats_t stats;
+#endif
     struct {
         float usage;
-    } cpu;
-#if !defined(NPROFILESTACK)
-    size_t stack_size;
+#if THRD_NCPUS > 1
+        int index;
+        int affinity;
 #endif
+    } cpu;
+    struct {
+        /* Lowest address of the stack. */
+        char *begin_p;
+        size_t size;
+        /* Size class of a dynamically allocated stack, otherwise
+           -1. */
+        int size_class;
+    } stack;
 #if !defined(NASSERT)
     uint16_t stack_low_magic;
 #endif
@@ -78,6 +186,35 @@ struct thrd_t *thrd_spawn(void *(*entry)(void *),
                           void *stack_p,
                           size_t stack_size);
 
+/**
+ * Spawn a thread with given entry function and argument on a stack
+ * of at least given size. Stacks are taken from per size class pools
+ * and recycled when their thread terminates, so the cost of a spawn
+ * does not depend on the stack size.
+ *
+ * On Linux the stacks are mapped with a guard page below them, so a
+ * stack overflow causes a segmentation fault. On other ports the
+ * stacks are carved from a static heap of `THRD_DYNAMIC_HEAP_SIZE`
+ * bytes.
+ *
+ * The stack of a terminated thread is recycled by the next call to
+ * this function, so the returned thread id must not be used after
+ * that. Threads waiting in `thrd_wait()` when the thread terminates
+ * are woken as usual.
+ *
+ * @param[in] entry Thread entry function.
+ * @param[in] arg_p Entry function argument.
+ * @param[in] prio Thread scheduling priority. [ -127..127 ], where a
+ *                 lower number has higher priority.
+ * @param[in] stack_size Minimum stack size.
+ *
+ * @return Thread id, or NULL on error.
+ */
+struct thrd_t *thrd_spawn_dynamic(void *(*entry)(void *),
+                                  void *arg_p,
+                                  int prio,
+                                  size_t stack_size);
+
 /**
  * Suspend given thread and wait to be resumed or a timeout occurs.
  *
@@ -99,13 +236,133 @@ int thrd_suspend(struct time_t *timeout_p);
 int thrd_resume(struct thrd_t *thrd_p, int err);
 
 /**
- * Wait for a thread to terminate.
+ * Put the current thread last in the ready list of its priority and
+ * let the most important ready thread run.
  *
- * @param[in] thrd_p Thread to wait for.
+ * @return zero(0) or negative error code.
+ */
+int thrd_yield(void);
+
+/**
+ * Set the cpu given thread runs on. A ready thread is moved to the
+ * ready list of given cpu, a current thread on another cpu moves
+ * the next time it becomes ready, and the calling thread moves
+ * immediately.
+ *
+ * @param[in] thrd_p Thread.
+ * @param[in] cpu Cpu index [0..THRD_NCPUS - 1], or `THRD_CPU_ANY` to
+ *                let the scheduler choose.
+ *
+ * @return zero(0) or negative error code.
+ */
+int thrd_set_cpu(struct thrd_t *thrd_p, int cpu);
+
+/**
+ * Get the index of the cpu the calling thread runs on.
+ *
+ * @return Cpu index.
+ */
+int thrd_get_cpu(void);
+
+/**
+ * Schedule the calling thread earliest deadline first (EDF) as a
+ * periodic real-time thread. A job of the thread is released every
+ * period, and should end with a call to `thrd_edf_wait()` within the
+ * relative deadline after its release. The first job is released
+ * now.
+ *
+ * Ready EDF threads run before all fixed priority threads, the one
+ * with the earliest absolute deadline first. Threads are not
+ * preempted, so a job runs until it waits.
+ *
+ * The thread is admitted only if the sum of the worst case execution
+ * times divided by the smaller of the period and the deadline, for
+ * all EDF threads on the cpu, stays within
+ * `THRD_EDF_UTILIZATION_MAX` percent. On SMP the thread is bound to
+ * the cpu it runs on.
+ *
+ * @param[in] edf_p Storage of the scheduling parameters and
+ *                  statistics, used until `thrd_edf_stop()` is called
+ *                  or the thread terminates.
+ * @param[in] period_p Period.
+ * @param[in] deadline_p Relative deadline.
+ * @param[in] wcet_p Worst case execution time of a job.
+ *
+ * @return zero(0) or negative error code. -EBUSY if the thread was
+ *         not admitted.
+ */
+int thrd_edf_start(struct thrd_edf_t *edf_p,
+                   struct time_t *period_p,
+                   struct time_t *deadline_p,
+                   struct time_t *wcet_p);
+
+/**
+ * End the current job of the calling EDF thread and wait for the
+ * release of the next job. Returns immediately if the next job is
+ * already released.
+ *
+ * @return zero(0) or negative error code. -ETIMEDOUT if the ended job
+ *         missed its deadline.
+ */
+int thrd_edf_wait(void);
+
+/**
+ * Go back to fixed priority scheduling of the calling thread.
  *
  * @return zero(0) or negative error code.
  */
-int thrd_wait(struct thrd_t *thrd_p);
+int thrd_edf_stop(void);
+
+/**
+ * Make the calling thread periodic with given period. The thread
+ * calls `thrd_periodic_wait()` at the end of each job, and is woken
+ * at absolute release times, so the execution time of the jobs does
+ * not make the period drift. The first job is released now.
+ *
+ * Release jitter, execution times and overruns are recorded in given
+ * statistics, and listed by `/kernel/thrd/list`. Call this function
+ * again to change the period and reset the statistics.
+ *
+ * @param[in] periodic_p Storage of the release time and statistics,
+ *                       used until `thrd_periodic_stop()` is called
+ *                       or the thread terminates.
+ * @param[in] period_p Period, at least one system tick.
+ *
+ * @return zero(0) or negative error code.
+ */
+int thrd_periodic_start(struct thrd_periodic_t *periodic_p,
+                        struct time_t *period_p);
+
+/**
+ * End the current job of the calling periodic thread and wait for
+ * the next release. If the next release has already passed, the job
+ * overran its period. Missed releases are then skipped, and the next
+ * job starts immediately.
+ *
+ * @return zero(0) or negative error code. -ETIMEDOUT if the ended job
+ *         overran its period.
+ */
+int thrd_periodic_wait(void);
+
+/**
+ * Stop periodic execution of the calling thread.
+ *
+ * @return zero(0) or negative error code.
+ */
+int thrd_periodic_stop(void);
+
+/**
+ * Wait for given thread to terminate. Any number of threads may wait
+ * for the same thread.
+ *
+ * @param[in] thrd_p Thread to wait for.
+ * @param[in] timeout_p Timeout, or NULL to wait forever.
+ *
+ * @return zero(0) or negative error code, -ETIMEDOUT if the thread
+ *         did not terminate within given timeout.
+ */
+int thrd_wait(struct thrd_t *thrd_p,
+              struct time_t *timeout_p);
 
 /**
  * Sleep for given number of microseconds.
@@ -158,6 +415,17 @@ int thrd_get_log_mask(void);
  */
 int thrd_suspend_isr(struct time_t *timeout_p);
 
+/**
+ * Same as `thrd_suspend_isr()`, but the time suspended is counted as
+ * waiting on given kind of object in the thread statistics.
+ *
+ * @param[in] timeout_p Timeout.
+ * @param[in] wait Kind of object waited on, one of `THRD_WAIT_*`.
+ *
+ * @return zero(0) or negative error code.
+ */
+int thrd_suspend_on_isr(struct time_t *timeout_p, int wait);
+
 /**
  * Resume given suspended thread from interrupt context or with the
  * system lock taken (see `sys_lock()`).
@@ -47,7 +47,7 @@ struct date_t {
 
 /**
  * Get current time in seconds and nanoseconds. The resolution of the
- * time is implementation specific.
+ * time is implementation specific, see `time_get_ns()`.
  *
  * @param[out] now_p Current time.
  *
@@ -55,6 +55,17 @@ struct date_t {
  */
 int time_get(struct time_t *now_p);
 
+/**
+ * Get current time in nanoseconds. The time at the latest system
+ * tick is interpolated with the system tick timer counter, or the
+ * monotonic clock on Linux, so the resolution is better than one
+ * system tick. This function does not take the system lock and may
+ * be called from any context.
+ *
+ * @return Current time in nanoseconds.
+ */
+uint64_t time_get_ns(void);
+
 /**
  * Set current time in seconds and nanoseconds.
  *
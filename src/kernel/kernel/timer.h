@@ -29,7 +29,8 @@
 /* Timer. */
 struct timer_t {
     struct timer_t *next_p;
-    sys_tick_t delta;
+    struct timer_t **pprev_p;
+    uint32_t expiry;
     sys_tick_t timeout;
     int flags;
     void (*callback)(void *arg_p);
@@ -58,11 +59,13 @@ int timer_set(struct timer_t *self_p,
               int flags);
 
 /**
- * Cancel the timer.
+ * Cancel given timer. The timer must have been set at least once
+ * with `timer_set()` before it can be cancelled.
  *
  * @param[in] self_p Timer object.
  *
- * @return zero(0) or negative error code.
+ * @return zero(0) if the timer was cancelled, otherwise negative
+ *         error code, for example if the timer already expired.
  */
 int timer_cancel(struct timer_t *self_p);
 
@@ -78,4 +81,12 @@ int timer_set_isr(struct timer_t *self_p,
                   void *arg_p,
                   int flags);
 
+/**
+ * See `timer_cancel()` for a description.
+ *
+ * This function may only be called with the system lock taken (see
+ * `sys_lock()`).
+ */
+int timer_cancel_isr(struct timer_t *self_p);
+
 #endif
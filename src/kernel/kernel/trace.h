@@ -0,0 +1,112 @@
+/**
+ * @file kernel/trace.h
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#ifndef __KERNEL_TRACE_H__
+#define __KERNEL_TRACE_H__
+
+#include "simba.h"
+
+/* Number of records in the ring buffer of each cpu. The oldest
+   records are overwritten when a ring is full. */
+#if !defined(TRACE_RING_LENGTH)
+#    define TRACE_RING_LENGTH 256
+#endif
+
+/* Trace events. */
+#define TRACE_EVENT_THRD_SWITCH                           0
+#define TRACE_EVENT_THRD_SUSPEND                          1
+#define TRACE_EVENT_THRD_RESUME                           2
+#define TRACE_EVENT_QUEUE_READ                            3
+#define TRACE_EVENT_QUEUE_WRITE                           4
+#define TRACE_EVENT_SEM_GET                               5
+#define TRACE_EVENT_SEM_PUT                               6
+#define TRACE_EVENT_TIMER_TICK                            7
+#define TRACE_EVENT_ISR                                   8
+#define TRACE_EVENT_MAX                                   9
+
+/* Interrupt sources, the value of `TRACE_EVENT_ISR`. */
+#define TRACE_ISR_UART                                    0
+#define TRACE_ISR_SPI                                     1
+#define TRACE_ISR_EXTI                                    2
+#define TRACE_ISR_ADC                                     3
+#define TRACE_ISR_DAC                                     4
+#define TRACE_ISR_CAN                                     5
+#define TRACE_ISR_USB                                     6
+
+/**
+ * Record a trace event in the ring buffer of the current cpu.
+ * Tracepoints are only compiled in if the application is built with
+ * `TRACE=yes`, otherwise the macro expands to nothing and the
+ * arguments are not evaluated.
+ *
+ * @param[in] event Trace event, one of `TRACE_EVENT_*`.
+ * @param[in] object_p Thread or kernel object the event refers to.
+ * @param[in] value Event specific value, for example a size.
+ */
+#if defined(TRACE)
+#    define TRACE_EVENT(event, object_p, value)                         \
+    trace_write(event, (uintptr_t)(object_p), value)
+#else
+#    define TRACE_EVENT(event, object_p, value)
+#endif
+
+/* A trace record. */
+struct trace_record_t {
+    /* Time in microseconds since startup. Wraps around. */
+    uint32_t time;
+    uint8_t event;
+    uint16_t value;
+    uintptr_t object;
+};
+
+/**
+ * Initialize the trace module.
+ *
+ * @return zero(0) or negative error code
+ */
+int trace_module_init(void);
+
+/**
+ * Write a record to the ring buffer of the current cpu. Use
+ * `TRACE_EVENT()` instead of calling this function directly. May be
+ * called from any context, including interrupt handlers and with the
+ * system lock or an object lock taken.
+ *
+ * @param[in] event Trace event.
+ * @param[in] object Thread or kernel object address.
+ * @param[in] value Event specific value.
+ *
+ * @return void.
+ */
+void trace_write(int event, uintptr_t object, uint16_t value);
+
+/**
+ * Print all records in the ring buffers in text format to given
+ * channel, oldest first per cpu. Recording is paused while
+ * printing. The output is converted to Chrome trace JSON with
+ * `make/tracedecoder.py`.
+ *
+ * @param[in] chout_p Output channel.
+ *
+ * @return zero(0) or negative error code.
+ */
+int trace_dump(chan_t *chout_p);
+
+#endif
@@ -0,0 +1,183 @@
+/**
+ * @file kernel/workq.h
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#ifndef __KERNEL_WORKQ_H__
+#define __KERNEL_WORKQ_H__
+
+#include "simba.h"
+
+/* Number of worker threads in the system work queue. Set to zero to
+   not create the system work queue. */
+#if !defined(WORKQ_SYSTEM_WORKERS)
+#    define WORKQ_SYSTEM_WORKERS 1
+#endif
+
+/* Priority of the system work queue worker threads. */
+#if !defined(WORKQ_SYSTEM_PRIO)
+#    define WORKQ_SYSTEM_PRIO -40
+#endif
+
+/* Stack size of each system work queue worker thread. */
+#if !defined(WORKQ_SYSTEM_STACK_SIZE)
+#    if defined(ARCH_AVR)
+#        define WORKQ_SYSTEM_STACK_SIZE 256
+#    else
+#        define WORKQ_SYSTEM_STACK_SIZE 1024
+#    endif
+#endif
+
+struct workq_worker_t;
+
+/* A work queue with a pool of worker threads. */
+struct workq_t {
+    const char *name_p;
+    int prio;
+    int workers;
+    struct list_singly_linked_t pending;
+    struct workq_worker_t *idle_p;
+    struct {
+        unsigned long depth;
+        unsigned long depth_max;
+        unsigned long submitted;
+        unsigned long executed;
+        unsigned long cancelled;
+        uint64_t busy_ns;
+        uint64_t start_ns;
+    } stats;
+    struct workq_t *next_p;
+};
+
+/* A work item. */
+struct work_t {
+    struct work_t *next_p;
+    struct workq_t *workq_p;
+    void (*callback)(void *arg_p);
+    void *arg_p;
+    int state;
+    struct timer_t timer;
+};
+
+/**
+ * Initialize the work queue module. Creates the system work queue
+ * unless `WORKQ_SYSTEM_WORKERS` is zero.
+ *
+ * @return zero(0) or negative error code
+ */
+int workq_module_init(void);
+
+/**
+ * Initialize given work queue and spawn its worker threads. Each
+ * worker thread is named after the work queue.
+ *
+ * @param[in] self_p Work queue to initialize.
+ * @param[in] name_p Name of the work queue.
+ * @param[in] prio Priority of the worker threads.
+ * @param[in] stacks_p Worker thread stacks, `workers` stacks of
+ *                     `stack_size` bytes each, for example an array
+ *                     of stacks declared with `THRD_STACK()`.
+ * @param[in] stack_size Size of one worker thread stack.
+ * @param[in] workers Number of worker threads.
+ *
+ * @return zero(0) or negative error code.
+ */
+int workq_init(struct workq_t *self_p,
+               const char *name_p,
+               int prio,
+               void *stacks_p,
+               size_t stack_size,
+               int workers);
+
+/**
+ * Initialize given work item.
+ *
+ * @param[in] self_p Work to initialize.
+ * @param[in] workq_p Work queue to execute the work in, or NULL for
+ *                    the system work queue.
+ * @param[in] callback Work function. Called from a worker thread.
+ * @param[in] arg_p Work function argument.
+ *
+ * @return zero(0) or negative error code.
+ */
+int work_init(struct work_t *self_p,
+              struct workq_t *workq_p,
+              void (*callback)(void *arg_p),
+              void *arg_p);
+
+/**
+ * Submit given work to its work queue. The work function is called
+ * once by the first available worker thread. A work may be submitted
+ * again from its own work function.
+ *
+ * @param[in] self_p Work to submit.
+ *
+ * @return zero(0) or negative error code. -EBUSY if the work is
+ *         already pending or delayed.
+ */
+int work_submit(struct work_t *self_p);
+
+/**
+ * Submit given work to its work queue when given timeout expires.
+ *
+ * @param[in] self_p Work to submit.
+ * @param[in] timeout_p Time until the work is submitted.
+ *
+ * @return zero(0) or negative error code. -EBUSY if the work is
+ *         already pending or delayed.
+ */
+int work_submit_delayed(struct work_t *self_p,
+                        struct time_t *timeout_p);
+
+/**
+ * Cancel given pending or delayed work. A work function that is
+ * already executing is not interrupted.
+ *
+ * @param[in] self_p Work to cancel.
+ *
+ * @return zero(0) if the work was cancelled, otherwise negative error
+ *         code, -ENOENT if the work is neither pending nor delayed.
+ */
+int work_cancel(struct work_t *self_p);
+
+/**
+ * See `work_submit()` for a description.
+ *
+ * This function may only be called with the system lock taken (see
+ * `sys_lock()`), for example from an interrupt handler.
+ */
+int work_submit_isr(struct work_t *self_p);
+
+/**
+ * See `work_submit_delayed()` for a description.
+ *
+ * This function may only be called with the system lock taken (see
+ * `sys_lock()`).
+ */
+int work_submit_delayed_isr(struct work_t *self_p,
+                            struct time_t *timeout_p);
+
+/**
+ * See `work_cancel()` for a description.
+ *
+ * This function may only be called with the system lock taken (see
+ * `sys_lock()`).
+ */
+int work_cancel_isr(struct work_t *self_p);
+
+#endif
@@ -25,17 +25,26 @@
 FS_COMMAND_DEFINE("/kernel/log/set_mode", log_cmd_set_mode);
 FS_COMMAND_DEFINE("/kernel/log/get_mode", log_cmd_get_mode);
 FS_COMMAND_DEFINE("/kernel/log/format", log_cmd_format);
-
-COUNTER_DEFINE("/kernel/log/discarded", log_discarded);
+FS_COMMAND_DEFINE("/kernel/log/rings", log_cmd_rings);
 
 extern int (*log_id_to_format_fn[])(chan_t *, void *);
 
+/* A log ring. Entries are a header followed by the entry data, and
+   may wrap around the end of the buffer. The lock is a leaf lock
+   only taken by threads writing to this ring and when formatting. */
+struct log_ring_t {
+    struct sys_object_lock_t lock;
+    /* Offset of the oldest entry. */
+    size_t tail;
+    size_t used;
+    unsigned long dropped;
+    char buffer[LOG_RING_SIZE];
+};
+
 struct log_t {
-    char mode;
-    char *write_p;
-    char *end_p;
+    volatile char mode;
     unsigned long next_number;
-    char buffer[LOG_BUFFER_SIZE];
+    struct log_ring_t rings[LOG_RINGS];
 };
 
 static struct log_t log;
@@ -117,22 +126,142 @@ int log_cmd_format(int argc,
     return (log_format(chout_p));
 }
 
+int log_cmd_rings(int argc,
+                  const char *argv[],
+                  chan_t *chout_p,
+                  chan_t *chin_p)
+{
+    struct log_ring_t *ring_p;
+    size_t used;
+    unsigned long dropped;
+    int i;
+
+    std_fprintf(chout_p,
+                FSTR("RING  PRIO-MIN  PRIO-MAX   SIZE   USED     DROPPED\r\n"));
+
+    for (i = 0; i < LOG_RINGS; i++) {
+        ring_p = &log.rings[i];
+
+        sys_object_lock(&ring_p->lock);
+        used = ring_p->used;
+        dropped = ring_p->dropped;
+        sys_object_unlock(&ring_p->lock);
+
+        std_fprintf(chout_p,
+                    FSTR("%4d  %8d  %8d  %5u  %5u  %10lu\r\n"),
+                    i,
+                    MAX(DIV_CEIL(256 * i, LOG_RINGS) - 128, -127),
+                    DIV_CEIL(256 * (i + 1), LOG_RINGS) - 129,
+                    (unsigned int)LOG_RING_SIZE,
+                    (unsigned int)used,
+                    dropped);
+    }
+
+    return (0);
+}
+
+/**
+ * Get the ring of the current thread. Priorities [-127..127] are
+ * divided evenly between the rings.
+ */
+static struct log_ring_t *ring_self(void)
+{
+    return (&log.rings[((thrd_self()->prio + 128) * LOG_RINGS) >> 8]);
+}
+
+/**
+ * Get a unique entry number. Called with a ring lock taken. The ring
+ * locks of a single cpu system exclude each other, but not on a
+ * multi cpu system.
+ */
+static unsigned long next_number(void)
+{
+#if THRD_NCPUS > 1
+    return (__atomic_fetch_add(&log.next_number, 1, __ATOMIC_RELAXED));
+#else
+    return (log.next_number++);
+#endif
+}
+
+/**
+ * Copy data from given buffer to given offset in the ring, wrapping
+ * around the end of the ring.
+ */
+static void ring_copy_in(struct log_ring_t *ring_p,
+                         size_t offset,
+                         const void *buf_p,
+                         size_t size)
+{
+    size_t n;
+
+    offset %= LOG_RING_SIZE;
+    n = MIN(size, LOG_RING_SIZE - offset);
+    memcpy(&ring_p->buffer[offset], buf_p, n);
+    memcpy(&ring_p->buffer[0], (const char *)buf_p + n, size - n);
+}
+
+/**
+ * Copy data from given offset in the ring to given buffer, wrapping
+ * around the end of the ring.
+ */
+static void ring_copy_out(struct log_ring_t *ring_p,
+                          size_t offset,
+                          void *buf_p,
+                          size_t size)
+{
+    size_t n;
+
+    offset %= LOG_RING_SIZE;
+    n = MIN(size, LOG_RING_SIZE - offset);
+    memcpy(buf_p, &ring_p->buffer[offset], n);
+    memcpy((char *)buf_p + n, &ring_p->buffer[0], size - n);
+}
+
+/**
+ * Remove the oldest entry in given ring. Called with the ring lock
+ * taken.
+ */
+static void ring_evict(struct log_ring_t *ring_p)
+{
+    struct log_entry_header_t header;
+    size_t entry_size;
+
+    ring_copy_out(ring_p, ring_p->tail, &header, sizeof(header));
+    entry_size = (sizeof(header) + header.size);
+    ring_p->tail = ((ring_p->tail + entry_size) % LOG_RING_SIZE);
+    ring_p->used -= entry_size;
+    ring_p->dropped++;
+}
+
 int log_module_init(void)
 {
+    int i;
+
     log.next_number = 0;
 
+    for (i = 0; i < LOG_RINGS; i++) {
+        sys_object_lock_init(&log.rings[i].lock);
+    }
+
     return (log_reset());
 }
 
 int log_reset(void)
 {
-    sys_lock();
+    struct log_ring_t *ring_p;
+    int i;
 
     log.mode = LOG_MODE_CIRCULAR;
-    log.write_p = &log.buffer[0];
-    log.end_p = &log.buffer[0];
 
-    sys_unlock();
+    for (i = 0; i < LOG_RINGS; i++) {
+        ring_p = &log.rings[i];
+
+        sys_object_lock(&ring_p->lock);
+        ring_p->tail = 0;
+        ring_p->used = 0;
+        ring_p->dropped = 0;
+        sys_object_unlock(&ring_p->lock);
+    }
 
     return (0);
 }
@@ -141,13 +270,9 @@ int log_set_mode(int mode)
 {
     int old;
 
-    sys_lock();
-
     old = log.mode;
     log.mode = mode;
 
-    sys_unlock();
-
     return (old);
 }
 
@@ -160,133 +285,159 @@ int log_write(char level, int id, void *buf_p, size_t size)
 {
     struct time_t now;
     struct log_entry_header_t header;
-    struct log_entry_footer_t footer;
-    int written = 0;
-    size_t entry_size = (size + sizeof(header) + sizeof(footer));
+    struct log_ring_t *ring_p;
+    int written;
+    size_t entry_size;
 
     /* Check if severity level is set. */
     if ((thrd_get_log_mask() & (1 << level)) == 0) {
         return (0);
     }
 
-    /* The entry must fit in the buffer. */
-    if (entry_size > LOG_BUFFER_SIZE) {
+    ring_p = ring_self();
+    entry_size = (sizeof(header) + size);
+
+    /* The entry must fit in the ring. */
+    if (entry_size > LOG_RING_SIZE) {
+        sys_object_lock(&ring_p->lock);
+        ring_p->dropped++;
+        sys_object_unlock(&ring_p->lock);
+
         return (-1);
     }
 
-    /* Create the entry header and footer. */
+    /* Create the entry header. */
     time_get(&now);
     header.size = size;
     header.time = now.seconds;
     header.level = level;
     header.id = id;
 
-    footer.size = size;
+    written = 0;
 
-    sys_lock();
+    sys_object_lock(&ring_p->lock);
 
-    header.number = log.next_number++;
+    header.number = next_number();
 
-    if (log.mode != LOG_MODE_OFF) {
-        /* Write the entry to the beginning of the buffer if it does
-           not fit at the end of the buffer.*/
-        if (entry_size > ((char *)&log.buffer[LOG_BUFFER_SIZE] - log.write_p)) {
-            log.end_p = log.write_p;
-            log.write_p = &log.buffer[0];
+    /* Make room for the entry by evicting the oldest entries. */
+    if (log.mode == LOG_MODE_CIRCULAR) {
+        while (entry_size > (LOG_RING_SIZE - ring_p->used)) {
+            ring_evict(ring_p);
         }
+    }
 
-        /* Write the entry to the buffer. */
-        memcpy(log.write_p, &header, sizeof(header));
-        log.write_p += sizeof(header);
-        memcpy(log.write_p, buf_p, size);
-        log.write_p += size;
-        memcpy(log.write_p, &footer, sizeof(footer));
-        log.write_p += sizeof(footer);
-
-        if (log.write_p > log.end_p) {
-            log.end_p = log.write_p;
-        }
+    if ((log.mode != LOG_MODE_OFF)
+        && (entry_size <= (LOG_RING_SIZE - ring_p->used))) {
+        ring_copy_in(ring_p,
+                     ring_p->tail + ring_p->used,
+                     &header,
+                     sizeof(header));
+        ring_copy_in(ring_p,
+                     ring_p->tail + ring_p->used + sizeof(header),
+                     buf_p,
+                     size);
+        ring_p->used += entry_size;
+        written = 1;
     } else {
-        COUNTER_INC(log_discarded, 1);
+        ring_p->dropped++;
     }
 
-    sys_unlock();
+    sys_object_unlock(&ring_p->lock);
 
     return (written);
 }
 
 int log_format(chan_t *chout_p)
 {
-    int i, number_of_entries;
-    struct log_entry_header_t *header_p;
-    struct log_entry_footer_t *footer_p;
-    char *begin_p = NULL, *buf_p, *entry_end_p;
+    struct log_entry_header_t header, oldest_header;
+    struct log_ring_t *ring_p, *oldest_p;
+    size_t tails[LOG_RINGS];
+    size_t useds[LOG_RINGS];
+    uint64_t buf[DIV_CEIL(LOG_RING_SIZE, sizeof(uint64_t))];
     int (*format_fn)(chan_t *, void *);
-    size_t entry_size;
+    int i, oldest, number_of_entries;
     int old_mode;
 
-    /* Empty log? */
-    if (log.end_p == &log.buffer[0]) {
-        return (0);
-    }
-
+    /* No entries are written while formatting. A writer that took
+       the ring lock before the mode was changed is finished when the
+       lock is taken below. */
     old_mode = log_set_mode(LOG_MODE_OFF);
 
-    /* Find the first entry. */
-    number_of_entries = 0;
-
-    /* From last written entry to the beginning of the buffer. */
-    entry_end_p = log.write_p;
+    for (i = 0; i < LOG_RINGS; i++) {
+        ring_p = &log.rings[i];
 
-    while (entry_end_p != &log.buffer[0]) {
-        number_of_entries++;
-        footer_p = ((struct log_entry_footer_t *)entry_end_p - 1);
-        entry_size = (footer_p->size + sizeof(*header_p) + sizeof(*footer_p));
-        entry_end_p -= entry_size;
-        begin_p = entry_end_p;
+        sys_object_lock(&ring_p->lock);
+        tails[i] = ring_p->tail;
+        useds[i] = ring_p->used;
+        sys_object_unlock(&ring_p->lock);
     }
 
+    number_of_entries = 0;
 
-    /* From the end pointer to the write pointer. */
-    entry_end_p = log.end_p;
+    while (1) {
+        /* Find the ring with the oldest entry. */
+        oldest = -1;
 
-    while (((char *)entry_end_p - sizeof(*footer_p)) > log.write_p) {
-        footer_p = ((struct log_entry_footer_t *)entry_end_p - 1);
-        entry_size = (footer_p->size + sizeof(*header_p) + sizeof(*footer_p));
+        for (i = 0; i < LOG_RINGS; i++) {
+            if (useds[i] == 0) {
+                continue;
+            }
 
-        if (((char *)entry_end_p - entry_size) > log.write_p) {
-            number_of_entries++;
-            begin_p = ((char *)entry_end_p - entry_size);
-        }
+            ring_copy_out(&log.rings[i], tails[i], &header, sizeof(header));
 
-        entry_end_p -= entry_size;
-    }
+            if ((oldest == -1)
+                || ((long)(header.number - oldest_header.number) < 0)) {
+                oldest = i;
+                oldest_header = header;
+            }
+        }
 
-    std_fprintf(chout_p, FSTR("number:time:level: message\r\n"));
+        if (oldest == -1) {
+            break;
+        }
 
-    /* Write entries to the channel. */
-    for (i = 0; i < number_of_entries; i++) {
-        header_p = (struct log_entry_header_t *)begin_p;
-        buf_p = (char *)(header_p + 1);
-        footer_p = (struct log_entry_footer_t *)(buf_p + header_p->size);
+        if (number_of_entries == 0) {
+            std_fprintf(chout_p, FSTR("number:time:level: message\r\n"));
+        }
 
-        std_fprintf(chout_p, FSTR("%lu:%lu:"), header_p->number, header_p->time);
-        std_fprintf(chout_p, level_as_string[(int)header_p->level]);
+        oldest_p = &log.rings[oldest];
+        ring_copy_out(oldest_p,
+                      tails[oldest] + sizeof(oldest_header),
+                      buf,
+                      oldest_header.size);
+        tails[oldest] += (sizeof(oldest_header) + oldest_header.size);
+        useds[oldest] -= (sizeof(oldest_header) + oldest_header.size);
+
+        std_fprintf(chout_p,
+                    FSTR("%lu:%lu:"),
+                    oldest_header.number,
+                    oldest_header.time);
+        std_fprintf(chout_p, level_as_string[(int)oldest_header.level]);
         std_fprintf(chout_p, FSTR(": "));
 
-        format_fn = log_id_to_format_fn[header_p->id];
-        format_fn(chout_p, buf_p);
+        format_fn = log_id_to_format_fn[oldest_header.id];
+        format_fn(chout_p, buf);
 
         std_fprintf(chout_p, FSTR("\r\n"));
-
-        begin_p = (char *)(footer_p + 1);
-
-        if (begin_p >= log.end_p) {
-            begin_p = &log.buffer[0];
-        }
+        number_of_entries++;
     }
 
     log_set_mode(old_mode);
 
     return (number_of_entries);
 }
+
+long log_get_dropped(int ring)
+{
+    long dropped;
+
+    if ((ring < 0) || (ring >= LOG_RINGS)) {
+        return (-EINVAL);
+    }
+
+    sys_object_lock(&log.rings[ring].lock);
+    dropped = log.rings[ring].dropped;
+    sys_object_unlock(&log.rings[ring].lock);
+
+    return (dropped);
+}
@@ -0,0 +1,397 @@
+/**
+ * @file mailbox.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+/* A thread waiting for a mailbox. */
+struct mailbox_elem_t {
+    struct mailbox_elem_t *next_p;
+    struct thrd_t *thrd_p;
+    int woken;
+};
+
+/**
+ * Copy given message to the end of the mailbox buffer.
+ */
+static void put(struct mailbox_t *self_p, const void *msg_p)
+{
+    size_t write;
+
+    write = (self_p->read + self_p->count);
+
+    if (write >= self_p->length) {
+        write -= self_p->length;
+    }
+
+    memcpy(&self_p->buf_p[write * self_p->message_size],
+           msg_p,
+           self_p->message_size);
+    self_p->count++;
+}
+
+/**
+ * Copy up to given number of messages from the beginning of the
+ * mailbox buffer. Returns the number of copied messages.
+ */
+static size_t get(struct mailbox_t *self_p, void *msgs_p, size_t length)
+{
+    size_t n, first;
+
+    n = MIN(length, self_p->count);
+
+    /* The messages may wrap around the end of the buffer. */
+    first = MIN(n, self_p->length - self_p->read);
+    memcpy(msgs_p,
+           &self_p->buf_p[self_p->read * self_p->message_size],
+           first * self_p->message_size);
+    memcpy((char *)msgs_p + first * self_p->message_size,
+           self_p->buf_p,
+           (n - first) * self_p->message_size);
+
+    self_p->read += n;
+
+    if (self_p->read >= self_p->length) {
+        self_p->read -= self_p->length;
+    }
+
+    self_p->count -= n;
+
+    return (n);
+}
+
+/**
+ * Resume up to given number of threads from the head of given
+ * list. Called with the system lock and the mailbox lock taken.
+ */
+static void resume_isr(struct mailbox_elem_t **head_pp, size_t n)
+{
+    struct mailbox_elem_t *elem_p;
+
+    while ((n > 0) && (*head_pp != NULL)) {
+        elem_p = *head_pp;
+        *head_pp = elem_p->next_p;
+        elem_p->woken = 1;
+        thrd_resume_isr(elem_p->thrd_p, 0);
+        n--;
+    }
+}
+
+/**
+ * Resume readers after messages were added. Called with the system
+ * lock and the mailbox lock taken.
+ */
+static void resume_readers_isr(struct mailbox_t *self_p)
+{
+    if (chan_is_polled_isr(&self_p->base)) {
+        thrd_resume_isr(self_p->base.reader_p, 0);
+        self_p->base.reader_p = NULL;
+    }
+
+    resume_isr(&self_p->readers_p, self_p->count);
+}
+
+/**
+ * Add the thread last in given list, release the mailbox lock and
+ * suspend the thread. The lock is taken again when the thread is
+ * resumed. Called with the system lock and the mailbox lock taken.
+ *
+ * @return zero(0) if resumed, or negative error code.
+ */
+static int wait_locked(struct mailbox_t *self_p,
+                       struct mailbox_elem_t **head_pp,
+                       struct time_t *timeout_p)
+{
+    struct mailbox_elem_t elem, **elem_pp;
+    int err;
+
+    elem.next_p = NULL;
+    elem.thrd_p = thrd_self();
+    elem.woken = 0;
+
+    elem_pp = head_pp;
+
+    while (*elem_pp != NULL) {
+        elem_pp = &(*elem_pp)->next_p;
+    }
+
+    *elem_pp = &elem;
+
+    sys_object_unlock(&self_p->base.lock);
+    err = thrd_suspend_on_isr(timeout_p, THRD_WAIT_QUEUE);
+    sys_object_lock(&self_p->base.lock);
+
+    if (elem.woken == 1) {
+        return (0);
+    }
+
+    /* Not resumed by the mailbox, remove the thread from the list. */
+    elem_pp = head_pp;
+
+    while (*elem_pp != &elem) {
+        elem_pp = &(*elem_pp)->next_p;
+    }
+
+    *elem_pp = elem.next_p;
+
+    return (err < 0 ? err : 0);
+}
+
+static ssize_t read_cb(struct mailbox_t *self_p,
+                       void *buf_p,
+                       size_t size)
+{
+    ssize_t res;
+    size_t left;
+
+    if ((size % self_p->message_size) != 0) {
+        return (-EINVAL);
+    }
+
+    left = (size / self_p->message_size);
+
+    while (left > 0) {
+        res = mailbox_recv_n(self_p, buf_p, left, NULL);
+
+        if (res < 0) {
+            return (res);
+        }
+
+        buf_p = ((char *)buf_p + res * self_p->message_size);
+        left -= res;
+    }
+
+    return (size);
+}
+
+static ssize_t write_cb(struct mailbox_t *self_p,
+                        const void *buf_p,
+                        size_t size)
+{
+    int res;
+    size_t left;
+
+    if ((size % self_p->message_size) != 0) {
+        return (-EINVAL);
+    }
+
+    left = (size / self_p->message_size);
+
+    while (left > 0) {
+        res = mailbox_send(self_p, buf_p, NULL);
+
+        if (res != 0) {
+            return (res);
+        }
+
+        buf_p = ((const char *)buf_p + self_p->message_size);
+        left--;
+    }
+
+    return (size);
+}
+
+int mailbox_module_init(void)
+{
+    return (0);
+}
+
+int mailbox_init(struct mailbox_t *self_p,
+                 void *buf_p,
+                 size_t message_size,
+                 size_t length)
+{
+    if ((message_size == 0) || (length == 0)) {
+        return (-EINVAL);
+    }
+
+    chan_init(&self_p->base,
+              (ssize_t (*)(void *, void *, size_t))read_cb,
+              (ssize_t (*)(void *, const void *, size_t))write_cb,
+              (size_t (*)(void *))mailbox_count);
+
+    self_p->buf_p = buf_p;
+    self_p->message_size = message_size;
+    self_p->length = length;
+    self_p->read = 0;
+    self_p->count = 0;
+    self_p->readers_p = NULL;
+    self_p->writers_p = NULL;
+
+    return (0);
+}
+
+int mailbox_init_ptr(struct mailbox_t *self_p,
+                     void **buf_pp,
+                     size_t length)
+{
+    return (mailbox_init(self_p, buf_pp, sizeof(*buf_pp), length));
+}
+
+int mailbox_send(struct mailbox_t *self_p,
+                 const void *msg_p,
+                 struct time_t *timeout_p)
+{
+    int err = 0;
+
+    /* Only the mailbox lock is needed if there is room for the
+       message and no thread has to be resumed. The waiting threads
+       are read without the lock as a hint, and checked again with
+       it. */
+    if ((self_p->readers_p == NULL)
+        && (self_p->writers_p == NULL)
+        && (self_p->base.reader_p == NULL)) {
+        sys_object_lock(&self_p->base.lock);
+
+        if ((self_p->readers_p == NULL)
+            && (self_p->writers_p == NULL)
+            && (self_p->base.reader_p == NULL)
+            && (self_p->count < self_p->length)) {
+            put(self_p, msg_p);
+            sys_object_unlock(&self_p->base.lock);
+
+            return (0);
+        }
+
+        sys_object_unlock(&self_p->base.lock);
+    }
+
+    sys_lock();
+    sys_object_lock(&self_p->base.lock);
+
+    while (self_p->count == self_p->length) {
+        err = wait_locked(self_p, &self_p->writers_p, timeout_p);
+
+        if (err != 0) {
+            break;
+        }
+    }
+
+    if (err == 0) {
+        put(self_p, msg_p);
+        resume_readers_isr(self_p);
+    }
+
+    sys_object_unlock(&self_p->base.lock);
+    sys_unlock();
+
+    return (err);
+}
+
+int mailbox_send_isr(struct mailbox_t *self_p,
+                     const void *msg_p)
+{
+    int err = 0;
+
+    sys_object_lock(&self_p->base.lock);
+
+    if (self_p->count < self_p->length) {
+        put(self_p, msg_p);
+        resume_readers_isr(self_p);
+    } else {
+        err = -ENOSPC;
+    }
+
+    sys_object_unlock(&self_p->base.lock);
+
+    return (err);
+}
+
+int mailbox_recv(struct mailbox_t *self_p,
+                 void *msg_p,
+                 struct time_t *timeout_p)
+{
+    ssize_t res;
+
+    res = mailbox_recv_n(self_p, msg_p, 1, timeout_p);
+
+    return (res < 0 ? res : 0);
+}
+
+ssize_t mailbox_recv_n(struct mailbox_t *self_p,
+                       void *msgs_p,
+                       size_t length,
+                       struct time_t *timeout_p)
+{
+    int err = 0;
+    ssize_t res;
+
+    if (length == 0) {
+        return (0);
+    }
+
+    /* Only the mailbox lock is needed if there are messages and no
+       thread has to be resumed. */
+    if ((self_p->readers_p == NULL) && (self_p->writers_p == NULL)) {
+        sys_object_lock(&self_p->base.lock);
+
+        if ((self_p->readers_p == NULL)
+            && (self_p->writers_p == NULL)
+            && (self_p->count > 0)) {
+            res = get(self_p, msgs_p, length);
+            sys_object_unlock(&self_p->base.lock);
+
+            return (res);
+        }
+
+        sys_object_unlock(&self_p->base.lock);
+    }
+
+    sys_lock();
+    sys_object_lock(&self_p->base.lock);
+
+    while (self_p->count == 0) {
+        err = wait_locked(self_p, &self_p->readers_p, timeout_p);
+
+        if (err != 0) {
+            break;
+        }
+    }
+
+    if (err == 0) {
+        res = get(self_p, msgs_p, length);
+        resume_isr(&self_p->writers_p, res);
+    } else {
+        res = err;
+    }
+
+    sys_object_unlock(&self_p->base.lock);
+    sys_unlock();
+
+    return (res);
+}
+
+int mailbox_send_ptr(struct mailbox_t *self_p,
+                     void *ptr_p,
+                     struct time_t *timeout_p)
+{
+    return (mailbox_send(self_p, &ptr_p, timeout_p));
+}
+
+int mailbox_recv_ptr(struct mailbox_t *self_p,
+                     void **ptr_pp,
+                     struct time_t *timeout_p)
+{
+    return (mailbox_recv(self_p, ptr_pp, timeout_p));
+}
+
+size_t mailbox_count(struct mailbox_t *self_p)
+{
+    return (self_p->count);
+}
@@ -0,0 +1,212 @@
+/**
+ * @file mutex.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+struct mutex_elem_t {
+    struct mutex_elem_t *next_p;
+    struct mutex_elem_t *prev_p;
+    struct thrd_t *thrd_p;
+};
+
+extern void thrd_set_prio_isr(struct thrd_t *thrd_p, int prio);
+
+/**
+ * Recalculate the priority of given thread from its own priority and
+ * the priorities of the threads waiting for mutexes it owns. A
+ * changed priority is propagated to the owner of the mutex the thread
+ * is waiting for, if any.
+ */
+static void update_prio_isr(struct thrd_t *thrd_p)
+{
+    int prio;
+    struct mutex_t *mutex_p;
+    struct mutex_elem_t *elem_p;
+
+    while (thrd_p != NULL) {
+        prio = thrd_p->pi.prio;
+
+        for (mutex_p = thrd_p->pi.owned_p;
+             mutex_p != NULL;
+             mutex_p = mutex_p->next_p) {
+            for (elem_p = mutex_p->head_p;
+                 elem_p != NULL;
+                 elem_p = elem_p->next_p) {
+                if (elem_p->thrd_p->prio < prio) {
+                    prio = elem_p->thrd_p->prio;
+                }
+            }
+        }
+
+        if (prio == thrd_p->prio) {
+            break;
+        }
+
+        thrd_set_prio_isr(thrd_p, prio);
+
+        mutex_p = thrd_p->pi.waiting_p;
+        thrd_p = (mutex_p != NULL ? mutex_p->owner_p : NULL);
+    }
+}
+
+/**
+ * Make given thread the owner of given mutex.
+ */
+static void take_isr(struct mutex_t *self_p,
+                     struct thrd_t *thrd_p)
+{
+    self_p->owner_p = thrd_p;
+    self_p->next_p = thrd_p->pi.owned_p;
+    thrd_p->pi.owned_p = self_p;
+}
+
+/**
+ * Remove given element from the list of waiting threads.
+ */
+static void unlink_isr(struct mutex_t *self_p,
+                       struct mutex_elem_t *elem_p)
+{
+    if (elem_p->prev_p != NULL) {
+        elem_p->prev_p->next_p = elem_p->next_p;
+    } else {
+        self_p->head_p = elem_p->next_p;
+    }
+
+    if (elem_p->next_p != NULL) {
+        elem_p->next_p->prev_p = elem_p->prev_p;
+    }
+}
+
+int mutex_module_init(void)
+{
+    return (0);
+}
+
+int mutex_init(struct mutex_t *self_p)
+{
+    self_p->owner_p = NULL;
+    self_p->head_p = NULL;
+    self_p->next_p = NULL;
+
+    return (0);
+}
+
+int mutex_lock(struct mutex_t *self_p,
+               struct time_t *timeout_p)
+{
+    int err = 0;
+    struct thrd_t *thrd_p;
+    struct mutex_elem_t elem;
+
+    sys_lock();
+
+    thrd_p = thrd_self();
+
+    if (self_p->owner_p == NULL) {
+        take_isr(self_p, thrd_p);
+    } else if (self_p->owner_p == thrd_p) {
+        err = -EDEADLK;
+    } else {
+        elem.thrd_p = thrd_p;
+        elem.next_p = self_p->head_p;
+        elem.prev_p = NULL;
+
+        if (elem.next_p != NULL) {
+            elem.next_p->prev_p = &elem;
+        }
+
+        self_p->head_p = &elem;
+        thrd_p->pi.waiting_p = self_p;
+        update_prio_isr(self_p->owner_p);
+
+        err = thrd_suspend_on_isr(timeout_p, THRD_WAIT_MUTEX);
+
+        /* The element is cleared when the ownership is passed to this
+           thread in mutex_unlock(). */
+        if (elem.thrd_p != NULL) {
+            unlink_isr(self_p, &elem);
+            thrd_p->pi.waiting_p = NULL;
+            update_prio_isr(self_p->owner_p);
+        } else {
+            err = 0;
+        }
+    }
+
+    sys_unlock();
+
+    return (err);
+}
+
+int mutex_unlock(struct mutex_t *self_p)
+{
+    struct thrd_t *thrd_p;
+    struct mutex_t **mutex_pp;
+    struct mutex_elem_t *elem_p, *next_p;
+
+    sys_lock();
+
+    thrd_p = thrd_self();
+
+    if (self_p->owner_p != thrd_p) {
+        sys_unlock();
+
+        return (-EPERM);
+    }
+
+    /* Remove the mutex from the list of owned mutexes. */
+    mutex_pp = &thrd_p->pi.owned_p;
+
+    while (*mutex_pp != self_p) {
+        mutex_pp = &(*mutex_pp)->next_p;
+    }
+
+    *mutex_pp = self_p->next_p;
+    self_p->owner_p = NULL;
+    self_p->next_p = NULL;
+
+    /* Pass the ownership to the waiting thread with highest
+       priority. Elements are added to the head of the list, so the
+       last found is the one that has waited the longest. */
+    if (self_p->head_p != NULL) {
+        elem_p = self_p->head_p;
+
+        for (next_p = elem_p->next_p;
+             next_p != NULL;
+             next_p = next_p->next_p) {
+            if (next_p->thrd_p->prio <= elem_p->thrd_p->prio) {
+                elem_p = next_p;
+            }
+        }
+
+        unlink_isr(self_p, elem_p);
+        elem_p->thrd_p->pi.waiting_p = NULL;
+        take_isr(self_p, elem_p->thrd_p);
+        update_prio_isr(elem_p->thrd_p);
+        thrd_resume_isr(elem_p->thrd_p, 0);
+        elem_p->thrd_p = NULL;
+    }
+
+    /* Drop any priority inherited through this mutex. */
+    update_prio_isr(thrd_p);
+
+    sys_unlock();
+
+    return (0);
+}
@@ -0,0 +1,311 @@
+/**
+ * @file pool.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+COUNTER_DEFINE("/kernel/pool/alloc_failures", pool_alloc_failures);
+
+/* A free block. */
+struct pool_block_t {
+    struct pool_block_t *next_p;
+};
+
+/**
+ * Take a block from the shared free list. Called with the system
+ * lock taken.
+ */
+static struct pool_block_t *take_isr(struct pool_t *self_p)
+{
+    struct pool_block_t *block_p;
+
+    block_p = self_p->free_p;
+
+    if (block_p == NULL) {
+        return (NULL);
+    }
+
+    self_p->free_p = block_p->next_p;
+    self_p->used++;
+
+    if ((long long)self_p->used > *self_p->high_water_p) {
+        *self_p->high_water_p = self_p->used;
+    }
+
+    return (block_p);
+}
+
+/**
+ * Put a block on the shared free list. Called with the system lock
+ * taken.
+ */
+static void give_isr(struct pool_t *self_p,
+                     struct pool_block_t *block_p)
+{
+    block_p->next_p = self_p->free_p;
+    self_p->free_p = block_p;
+    self_p->used--;
+}
+
+static int is_block(struct pool_t *self_p, void *block_p)
+{
+    char *p;
+
+    p = block_p;
+
+    return ((p >= self_p->begin_p)
+            && (p < self_p->end_p)
+            && (((p - self_p->begin_p) % self_p->block_size) == 0));
+}
+
+static void count_failure(struct pool_t *self_p)
+{
+    (*self_p->failures_p)++;
+    COUNTER_INC(pool_alloc_failures, 1);
+}
+
+#if THRD_NCPUS > 1
+
+/**
+ * Move up to half a cache of blocks from the shared free list to
+ * given cache.
+ */
+static void cache_refill(struct pool_t *self_p,
+                         struct pool_cache_t *cache_p)
+{
+    struct pool_block_t *block_p;
+    int i;
+
+    sys_lock();
+
+    for (i = 0; i < DIV_CEIL(self_p->cache_size, 2); i++) {
+        block_p = take_isr(self_p);
+
+        if (block_p == NULL) {
+            break;
+        }
+
+        block_p->next_p = cache_p->free_p;
+        cache_p->free_p = block_p;
+        cache_p->length++;
+    }
+
+    sys_unlock();
+}
+
+/**
+ * Move half of given full cache to the shared free list.
+ */
+static void cache_drain(struct pool_t *self_p,
+                        struct pool_cache_t *cache_p)
+{
+    struct pool_block_t *block_p;
+    int i;
+
+    sys_lock();
+
+    for (i = 0; i < DIV_CEIL(self_p->cache_size, 2); i++) {
+        block_p = cache_p->free_p;
+        cache_p->free_p = block_p->next_p;
+        cache_p->length--;
+        give_isr(self_p, block_p);
+    }
+
+    sys_unlock();
+}
+
+#endif
+
+int pool_module_init(void)
+{
+    return (0);
+}
+
+int pool_init(struct pool_t *self_p,
+              void *buf_p,
+              size_t size,
+              size_t block_size)
+{
+    size_t blocks;
+    struct pool_block_t *block_p;
+#if THRD_NCPUS > 1
+    int i;
+#endif
+
+    block_size = (DIV_CEIL(block_size, sizeof(uint64_t)) * sizeof(uint64_t));
+
+    if (block_size == 0) {
+        return (-EINVAL);
+    }
+
+    blocks = (size / block_size);
+
+    if (blocks == 0) {
+        return (-EINVAL);
+    }
+
+    self_p->begin_p = buf_p;
+    self_p->end_p = (self_p->begin_p + blocks * block_size);
+    self_p->block_size = block_size;
+    self_p->used = 0;
+    self_p->counters.high_water = 0;
+    self_p->counters.failures = 0;
+    self_p->high_water_p = &self_p->counters.high_water;
+    self_p->failures_p = &self_p->counters.failures;
+    self_p->free_p = NULL;
+
+    /* Link all blocks, the first block at the head of the list. */
+    while (blocks > 0) {
+        blocks--;
+        block_p = (struct pool_block_t *)(self_p->begin_p + blocks * block_size);
+        block_p->next_p = self_p->free_p;
+        self_p->free_p = block_p;
+    }
+
+#if THRD_NCPUS > 1
+    /* Blocks in the cache of one cpu cannot be allocated on another
+       cpu, so small pools are not cached. */
+    if ((self_p->end_p - self_p->begin_p)
+        >= (4 * THRD_NCPUS * POOL_CACHE_SIZE * block_size)) {
+        self_p->cache_size = POOL_CACHE_SIZE;
+    } else {
+        self_p->cache_size = 0;
+    }
+
+    for (i = 0; i < THRD_NCPUS; i++) {
+        self_p->caches[i].free_p = NULL;
+        self_p->caches[i].length = 0;
+    }
+#endif
+
+    return (0);
+}
+
+int pool_set_counters(struct pool_t *self_p,
+                      long long *high_water_p,
+                      long long *failures_p)
+{
+    sys_lock();
+
+    if (high_water_p != NULL) {
+        *high_water_p = *self_p->high_water_p;
+        self_p->high_water_p = high_water_p;
+    }
+
+    if (failures_p != NULL) {
+        *failures_p = *self_p->failures_p;
+        self_p->failures_p = failures_p;
+    }
+
+    sys_unlock();
+
+    return (0);
+}
+
+void *pool_alloc(struct pool_t *self_p)
+{
+    struct pool_block_t *block_p;
+#if THRD_NCPUS > 1
+    struct pool_cache_t *cache_p;
+
+    /* Only the thread running on a cpu uses its cache, and it is not
+       preempted by other threads, so the cache needs no lock. */
+    if (self_p->cache_size > 0) {
+        cache_p = &self_p->caches[thrd_get_cpu()];
+
+        if (cache_p->free_p == NULL) {
+            cache_refill(self_p, cache_p);
+        }
+
+        block_p = cache_p->free_p;
+
+        if (block_p != NULL) {
+            cache_p->free_p = block_p->next_p;
+            cache_p->length--;
+        } else {
+            sys_lock();
+            count_failure(self_p);
+            sys_unlock();
+        }
+
+        return (block_p);
+    }
+#endif
+
+    sys_lock();
+    block_p = pool_alloc_isr(self_p);
+    sys_unlock();
+
+    return (block_p);
+}
+
+int pool_free(struct pool_t *self_p, void *block_p)
+{
+    int res;
+#if THRD_NCPUS > 1
+    struct pool_cache_t *cache_p;
+
+    if (self_p->cache_size > 0) {
+        if (!is_block(self_p, block_p)) {
+            return (-EINVAL);
+        }
+
+        cache_p = &self_p->caches[thrd_get_cpu()];
+        ((struct pool_block_t *)block_p)->next_p = cache_p->free_p;
+        cache_p->free_p = block_p;
+        cache_p->length++;
+
+        if (cache_p->length > self_p->cache_size) {
+            cache_drain(self_p, cache_p);
+        }
+
+        return (0);
+    }
+#endif
+
+    sys_lock();
+    res = pool_free_isr(self_p, block_p);
+    sys_unlock();
+
+    return (res);
+}
+
+void *pool_alloc_isr(struct pool_t *self_p)
+{
+    struct pool_block_t *block_p;
+
+    block_p = take_isr(self_p);
+
+    if (block_p == NULL) {
+        count_failure(self_p);
+    }
+
+    return (block_p);
+}
+
+int pool_free_isr(struct pool_t *self_p, void *block_p)
+{
+    if (!is_block(self_p, block_p)) {
+        return (-EINVAL);
+    }
+
+    give_isr(self_p, block_p);
+
+    return (0);
+}
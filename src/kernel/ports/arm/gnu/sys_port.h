@@ -47,4 +47,12 @@
 
 #define PACKED __attribute__((packed))
 
+/* Lock of a kernel object. Interrupts are disabled while it is
+   taken, and the saved interrupt mask restores them on release. */
+struct sys_object_lock_t {
+    uint32_t primask;
+};
+
+#define SYS_OBJECT_LOCK_INIT { .primask = 0 }
+
 #endif
@@ -54,6 +54,28 @@ static void sys_port_unlock_isr(void)
 {
 }
 
+static void sys_port_object_lock_init(struct sys_object_lock_t *lock_p)
+{
+    lock_p->primask = 0;
+}
+
+static void sys_port_object_lock(struct sys_object_lock_t *lock_p)
+{
+    uint32_t primask;
+
+    /* Interrupts may already be disabled by the system lock or an
+       isr, so restore the interrupt mask instead of enabling them
+       on release. */
+    asm volatile("mrs %0, primask" : "=r" (primask));
+    asm volatile("cpsid i" : : : "memory");
+    lock_p->primask = primask;
+}
+
+static void sys_port_object_unlock(struct sys_object_lock_t *lock_p)
+{
+    asm volatile("msr primask, %0" : : "r" (lock_p->primask) : "memory");
+}
+
 void sys_stop(int error)
 {
     return (exit(error));
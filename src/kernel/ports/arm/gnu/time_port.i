@@ -21,3 +21,45 @@
 static void time_port_sleep(int us)
 {
 }
+
+/**
+ * Memory barrier for the time state sequence lock. A compiler
+ * barrier is sufficient on this single core port.
+ */
+static inline void time_port_barrier(void)
+{
+    asm volatile ("" ::: "memory");
+}
+
+/**
+ * The system tick timer counts down from LOAD to zero. A tick
+ * interrupt that is pending, but not yet handled, adds one tick
+ * period.
+ */
+static uint64_t time_port_get_ns_since_tick(uint64_t tick_ns)
+{
+    uint32_t pending;
+    uint32_t value;
+    uint32_t load;
+    uint32_t counts;
+
+    load = SAM_ST->LOAD;
+    pending = (SAM_SCB->ICSR & SCB_ICSR_PENDSTSET);
+    value = SAM_ST->VAL;
+
+    /* The timer may have wrapped around after the pending flag was
+       read. */
+    if ((pending == 0) && (SAM_SCB->ICSR & SCB_ICSR_PENDSTSET)) {
+        pending = 1;
+        value = SAM_ST->VAL;
+    }
+
+    counts = (load - value);
+
+    if (pending != 0) {
+        counts += (load + 1);
+    }
+
+    return (((uint64_t)counts * (1000000000UL / SYS_TICK_FREQUENCY))
+            / (load + 1));
+}
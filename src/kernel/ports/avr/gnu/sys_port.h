@@ -56,6 +56,19 @@
 
 #define SYS_SETTINGS_APP_BASE 0x100
 
+/* Use a small timer wheel to save RAM. */
+#if !defined(TIMER_WHEEL_BITS)
+#    define TIMER_WHEEL_BITS 3
+#endif
+
 #define PACKED __attribute__((packed))
 
+/* Lock of a kernel object. Interrupts are disabled while it is
+   taken, and the saved status register restores them on release. */
+struct sys_object_lock_t {
+    uint8_t sreg;
+};
+
+#define SYS_OBJECT_LOCK_INIT { .sreg = 0 }
+
 #endif
@@ -89,6 +89,29 @@ static void sys_port_unlock_isr(void)
 {
 }
 
+static void sys_port_object_lock_init(struct sys_object_lock_t *lock_p)
+{
+    lock_p->sreg = 0;
+}
+
+static void sys_port_object_lock(struct sys_object_lock_t *lock_p)
+{
+    uint8_t sreg;
+
+    /* Interrupts may already be disabled by the system lock or an
+       isr, so restore the status register instead of enabling
+       them on release. */
+    sreg = SREG;
+    asm volatile ("cli" ::: "memory");
+    lock_p->sreg = sreg;
+}
+
+static void sys_port_object_unlock(struct sys_object_lock_t *lock_p)
+{
+    asm volatile ("" ::: "memory");
+    SREG = lock_p->sreg;
+}
+
 void sys_stop(int error)
 {
     eeprom_write_dword(0x0, error);
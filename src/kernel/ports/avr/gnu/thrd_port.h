@@ -24,6 +24,11 @@
 #define THRD_PORT_STACK(name, size)             \
     char name[sizeof(struct thrd_t) + (size)]
 
+/* Use 32 ready queue priority levels to save RAM. */
+#if !defined(THRD_READY_QUEUE_SHIFT)
+#    define THRD_READY_QUEUE_SHIFT 3
+#endif
+
 struct thrd_port_context_t {
     uint8_t dummy;
     uint8_t r29;
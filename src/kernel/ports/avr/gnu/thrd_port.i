@@ -141,8 +141,16 @@ static void thrd_port_suspend_timer_callback(void *arg)
 {    
     struct thrd_t *thrd = arg;
 
+    /* The thread may have been resumed before the timer expired. */
+    if (thrd->state != THRD_STATE_SUSPENDED) {
+        return;
+    }
+
     // Push thread on scheduler ready queue.
     thrd->state = THRD_STATE_READY;
+#if !defined(NTHRDSTATS)
+    stats_wakeup(thrd);
+#endif
     scheduler_ready_push(thrd);
 }
 
@@ -26,3 +26,40 @@ static void time_port_sleep(int us)
 {
     _delay_loop_2((us * I_CPU) / 4);
 }
+
+/**
+ * Memory barrier for the time state sequence lock. A compiler
+ * barrier is sufficient on this single core port.
+ */
+static inline void time_port_barrier(void)
+{
+    asm volatile ("" ::: "memory");
+}
+
+/**
+ * The system tick timer counts up from zero to OCR0A. A tick
+ * interrupt that is pending, but not yet handled, adds one tick
+ * period.
+ */
+static uint64_t time_port_get_ns_since_tick(uint64_t tick_ns)
+{
+    uint8_t pending;
+    uint16_t counts;
+
+    pending = (TIFR0 & _BV(OCF0A));
+    counts = TCNT0;
+
+    /* The timer may have wrapped around after the pending flag was
+       read. */
+    if ((pending == 0) && (TIFR0 & _BV(OCF0A))) {
+        pending = 1;
+        counts = TCNT0;
+    }
+
+    if (pending != 0) {
+        counts += (OCR0A + 1);
+    }
+
+    return ((uint32_t)counts
+            * ((1000000000UL / SYS_TICK_FREQUENCY) / (OCR0A + 1)));
+}
@@ -49,4 +49,48 @@
 
 #define PACKED __attribute__((packed))
 
+/* Lock of a kernel object. A spinlock that yields the pthread while
+   waiting, as critical sections are short. */
+struct sys_object_lock_t {
+    int locked;
+};
+
+#define SYS_OBJECT_LOCK_INIT { .locked = 0 }
+
+/* The system tick is not periodic on this port. The ticker thread
+   sleeps until the next timer expires and then processes all
+   elapsed ticks in one batch. */
+#define SYS_PORT_TICKLESS
+
+/* The system lock may be taken by several pthreads at the same time,
+   and the lock profiler counts contention with
+   sys_port_lock_try(). */
+#define SYS_PORT_LOCK_TRY
+
+/**
+ * Process all ticks that are due. The tick counter is only updated
+ * when the ticker thread wakes up, so this must be called before
+ * reading it. Called with the system lock taken.
+ */
+void sys_port_tickless_catch_up_isr(void);
+
+/**
+ * Get the number of nanoseconds since the system tick epoch on the
+ * monotonic clock.
+ */
+uint64_t sys_port_get_ns(void);
+
+/**
+ * Monotonic clock in microseconds used for both interrupt and thread
+ * cpu usage bookkeeping. Only differences are used, so it may wrap
+ * around.
+ */
+uint32_t sys_port_cpu_usage_counter(void);
+
+/**
+ * Wake the ticker thread if a timer expiring in given number of
+ * ticks is set before its next wakeup. Called by `timer_set_isr()`.
+ */
+void sys_port_tickless_timer_set_isr(uint32_t ticks);
+
 #endif
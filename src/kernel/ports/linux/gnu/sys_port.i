@@ -19,40 +19,174 @@
  */
 
 #include <pthread.h>
+#include <sched.h>
+#include <time.h>
 
 static pthread_mutex_t mutex;
 
+/**
+ * The ticker thread is the interrupt context of this port. Tick n
+ * is due exactly n tick periods after the epoch on the monotonic
+ * clock, so ticks do not drift and are not affected by changes to
+ * the wall time.
+ */
 struct sys_port_t {
     pthread_t thrd;
     pthread_mutex_t mutex;
     pthread_cond_t cond;
+    struct timespec epoch;
+    struct {
+        int forever;
+        sys_tick_t tick;
+    } wakeup;
+    int pending;
 };
 
 static struct sys_port_t sys_port;
 
-static void *sys_port_ticker(void *arg)
+static void sys_port_interrupt_cpu_usage_reset(void);
+
+uint32_t sys_port_cpu_usage_counter(void)
 {
-    struct timespec abstimeout;
     struct timespec now;
 
-    pthread_mutex_init(&sys_port.mutex, NULL);
-    pthread_cond_init (&sys_port.cond, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (1000000UL * now.tv_sec + now.tv_nsec / 1000);
+}
+
+/**
+ * Monotonic time when given tick is due.
+ */
+static void sys_port_tick_to_timespec(sys_tick_t tick,
+                                      struct timespec *time_p)
+{
+    time_p->tv_sec = (sys_port.epoch.tv_sec + tick / SYS_TICK_FREQUENCY);
+    time_p->tv_nsec = (sys_port.epoch.tv_nsec
+                       + ((1000000000ULL * (tick % SYS_TICK_FREQUENCY))
+                          / SYS_TICK_FREQUENCY));
+
+    if (time_p->tv_nsec >= 1000000000L) {
+        time_p->tv_sec++;
+        time_p->tv_nsec -= 1000000000L;
+    }
+}
+
+/**
+ * Number of ticks due at given monotonic time.
+ */
+static sys_tick_t sys_port_timespec_to_tick(struct timespec *time_p)
+{
+    time_t seconds;
+    long nanoseconds;
+
+    seconds = (time_p->tv_sec - sys_port.epoch.tv_sec);
+    nanoseconds = (time_p->tv_nsec - sys_port.epoch.tv_nsec);
+
+    if (nanoseconds < 0) {
+        seconds--;
+        nanoseconds += 1000000000L;
+    }
 
+    return (((sys_tick_t)seconds * SYS_TICK_FREQUENCY)
+            + (((sys_tick_t)nanoseconds * SYS_TICK_FREQUENCY) / 1000000000L));
+}
+
+/**
+ * Set the tick to wake up on, or forever if no timer is set. Called
+ * with the system lock taken.
+ */
+static void sys_port_set_wakeup_isr(int forever, sys_tick_t tick)
+{
     pthread_mutex_lock(&sys_port.mutex);
+    sys_port.wakeup.forever = forever;
+    sys_port.wakeup.tick = tick;
+    pthread_mutex_unlock(&sys_port.mutex);
+}
+
+uint64_t sys_port_get_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (1000000000ULL * (now.tv_sec - sys_port.epoch.tv_sec)
+            + now.tv_nsec - sys_port.epoch.tv_nsec);
+}
+
+void sys_port_tickless_catch_up_isr(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    sys_tick_batch_isr(sys_port_timespec_to_tick(&now));
+}
+
+static void *sys_port_ticker(void *arg)
+{
+    uint32_t start;
+    uint32_t idle_ticks;
+    sys_tick_t tick;
+    struct timespec deadline;
+
     while (1) {
-        clock_gettime(CLOCK_REALTIME, &now);
-        abstimeout.tv_sec = now.tv_sec;
-        if (now.tv_nsec > 990000000L) {
-            abstimeout.tv_sec++;
+        /* Sleep until the wakeup tick is due or an earlier timer is
+           set. */
+        pthread_mutex_lock(&sys_port.mutex);
+
+        while (sys_port.pending == 0) {
+            if (sys_port.wakeup.forever == 1) {
+                pthread_cond_wait(&sys_port.cond, &sys_port.mutex);
+            } else {
+                sys_port_tick_to_timespec(sys_port.wakeup.tick, &deadline);
+
+                if (pthread_cond_timedwait(&sys_port.cond,
+                                           &sys_port.mutex,
+                                           &deadline) == ETIMEDOUT) {
+                    break;
+                }
+            }
         }
-        abstimeout.tv_nsec = ((now.tv_nsec + 10000000L) % 1000000000L);
-        pthread_cond_timedwait(&sys_port.cond, &sys_port.mutex, &abstimeout);
-        sys_tick();
+
+        sys_port.pending = 0;
+        pthread_mutex_unlock(&sys_port.mutex);
+
+        /* Catch up on all ticks that are due in one batch. */
+        start = sys_port_cpu_usage_counter();
+
+        sys_lock_isr();
+        tick = sys.tick;
+        sys_port_tickless_catch_up_isr();
+        idle_ticks = timer_idle_ticks_isr();
+        sys_port_set_wakeup_isr(idle_ticks == 0xffffffffUL,
+                                sys.tick + idle_ticks + 1);
+        sys_unlock_isr();
+
+        if (sys.tick != tick) {
+            thrd_tick();
+        }
+
+        sys.interrupt.time += (sys_port_cpu_usage_counter() - start);
     }
 
     return (NULL);
 }
 
+void sys_port_tickless_timer_set_isr(uint32_t ticks)
+{
+    pthread_mutex_lock(&sys_port.mutex);
+
+    if ((sys_port.wakeup.forever == 1)
+        || (sys.tick + ticks < sys_port.wakeup.tick)) {
+        sys_port.wakeup.forever = 0;
+        sys_port.wakeup.tick = (sys.tick + ticks);
+        sys_port.pending = 1;
+        pthread_cond_signal(&sys_port.cond);
+    }
+
+    pthread_mutex_unlock(&sys_port.mutex);
+}
+
 static void sys_port_lock(void)
 {
     pthread_mutex_lock(&mutex);
@@ -63,6 +197,20 @@ static void sys_port_unlock(void)
     pthread_mutex_unlock(&mutex);
 }
 
+#if defined(SYS_LOCK_PROFILE)
+
+/**
+ * Try to take the system lock.
+ *
+ * @return zero(0) if the lock was taken, otherwise non-zero.
+ */
+static int sys_port_lock_try(void)
+{
+    return (pthread_mutex_trylock(&mutex));
+}
+
+#endif
+
 static void sys_port_lock_isr(void)
 {
     pthread_mutex_lock(&mutex);
@@ -73,10 +221,40 @@ static void sys_port_unlock_isr(void)
     pthread_mutex_unlock(&mutex);
 }
 
+static void sys_port_object_lock_init(struct sys_object_lock_t *lock_p)
+{
+    lock_p->locked = 0;
+}
+
+static void sys_port_object_lock(struct sys_object_lock_t *lock_p)
+{
+    while (__atomic_exchange_n(&lock_p->locked, 1, __ATOMIC_ACQUIRE) != 0) {
+        /* Let the holder, possibly on the same host cpu, run. */
+        do {
+            sched_yield();
+        } while (__atomic_load_n(&lock_p->locked, __ATOMIC_RELAXED) != 0);
+    }
+}
+
+static void sys_port_object_unlock(struct sys_object_lock_t *lock_p)
+{
+    __atomic_store_n(&lock_p->locked, 0, __ATOMIC_RELEASE);
+}
+
 int sys_port_module_init(void)
 {
+    pthread_condattr_t condattr;
+
     pthread_mutex_init(&mutex, NULL);
-    
+    sys_port_interrupt_cpu_usage_reset();
+
+    pthread_mutex_init(&sys_port.mutex, NULL);
+    pthread_condattr_init(&condattr);
+    pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sys_port.cond, &condattr);
+    pthread_condattr_destroy(&condattr);
+    clock_gettime(CLOCK_MONOTONIC, &sys_port.epoch);
+
     /* Start sys tick thrd.*/
     if (pthread_create(&sys_port.thrd, NULL, sys_port_ticker, NULL)) {
         fprintf(stderr, "Error creating ticker thrd\n");
@@ -93,9 +271,19 @@ void sys_stop(int error)
 
 static float sys_port_interrupt_cpu_usage_get(void)
 {
-    return (0.0f);
+    uint32_t period;
+
+    period = (sys_port_cpu_usage_counter() - sys.interrupt.start);
+
+    if (period == 0) {
+        return (0.0f);
+    }
+
+    return ((100.0f * sys.interrupt.time) / period);
 }
 
 static void sys_port_interrupt_cpu_usage_reset(void)
 {
+    sys.interrupt.start = sys_port_cpu_usage_counter();
+    sys.interrupt.time = 0;
 }
@@ -23,14 +23,58 @@
 
 #include <pthread.h>
 
+/* Cpu usage bookkeeping in microseconds. */
+struct thrd_port_cpu_t {
+    uint32_t start;
+    struct {
+        uint32_t start;
+        uint32_t time;
+    } period;
+};
+
+#if defined(THRD_NCPUS) && (THRD_NCPUS > 1) && !defined(THRD_PORT_PTHREAD)
+#    error "SMP requires the pthread thread port."
+#endif
+
+#if defined(THRD_PORT_PTHREAD)
+
+/* Each thread runs on its own pthread. The stack is not used. */
+#define THRD_PORT_STACK_HOST 0
 #define THRD_PORT_STACK(name, size) char name[sizeof(struct thrd_t) + (size)]
 
 struct thrd_port_t {
     pthread_t thrd;
     pthread_mutex_t mutex;
     pthread_cond_t cond;
+    int running;
     void *(*entry)(void *arg);
     void *arg;
+    struct thrd_port_cpu_t cpu;
 };
 
+#else
+
+#include <ucontext.h>
+
+/* Extra stack needed by the host C library, gprof and gcov on top of
+   the stack size the application requests. */
+#if !defined(THRD_PORT_STACK_HOST)
+#    define THRD_PORT_STACK_HOST 32768
+#endif
+
+/* All threads run on the same pthread and the stack given to
+   thrd_spawn() is the stack of the thread. */
+#define THRD_PORT_STACK(name, size)                                     \
+    char name[sizeof(struct thrd_t) + (size) + THRD_PORT_STACK_HOST]    \
+    __attribute__((aligned (16)))
+
+struct thrd_port_t {
+    ucontext_t context;
+    void *(*entry)(void *arg);
+    void *arg;
+    struct thrd_port_cpu_t cpu;
+};
+
+#endif
+
 #endif
@@ -18,130 +18,107 @@
  * This file is part of the Simba project.
  */
 
-#define THRD_IDLE_STACK_MAX 1024
-#define THRD_MONITOR_STACK_MAX 1024
+#include <unistd.h>
+#include <sys/mman.h>
 
-struct thrd_port_idle_t {
-    pthread_mutex_t mutex;
-    pthread_cond_t cond;
-};
+/* Stacks of dynamically spawned threads are mapped by the port. */
+#define THRD_PORT_STACK_ALLOC
 
-static struct thrd_t main_thrd;
-
-static struct thrd_port_idle_t idle = {
-    .mutex = PTHREAD_MUTEX_INITIALIZER,
-    .cond = PTHREAD_COND_INITIALIZER
-};
-
-static void *thrd_port_entry(void *arg)
+static void thrd_port_cpu_usage_start(struct thrd_t *thrd_p)
 {
-    struct thrd_port_t *port;
-
-    port = arg;
-    pthread_cond_wait(&port->cond, &port->mutex);
-    pthread_mutex_unlock(&port->mutex);
-    sys_unlock();
-    port->entry(port->arg);
-
-    /* Thread termination. */
-    terminate();
-
-    return (NULL);
+    thrd_p->port.cpu.start = sys_port_cpu_usage_counter();
 }
 
-static void thrd_port_swap(struct thrd_t *in,
-                           struct thrd_t *out)
+static void thrd_port_cpu_usage_stop(struct thrd_t *thrd_p)
 {
-    /* Signal 'out' thrd and enter wait.*/
-    pthread_mutex_lock(&out->port.mutex);
-    pthread_mutex_lock(&in->port.mutex);
-    pthread_cond_signal(&in->port.cond);
-    pthread_mutex_unlock(&in->port.mutex);
-    pthread_cond_wait(&out->port.cond, &out->port.mutex);
-    pthread_mutex_unlock(&out->port.mutex);
+    thrd_p->port.cpu.period.time += (sys_port_cpu_usage_counter()
+                                     - thrd_p->port.cpu.start);
 }
 
-static void thrd_port_init_main(struct thrd_port_t *port)
+static float thrd_port_cpu_usage_get(struct thrd_t *thrd_p)
 {
-    port->entry = NULL;
-    port->arg = NULL;
-    pthread_mutex_init(&port->mutex, NULL);
-    pthread_cond_init (&port->cond, NULL);
-}
+    uint32_t period;
 
-static int thrd_port_spawn(struct thrd_t *thrd_p,
-                           void *(*entry)(void *),
-                           void *arg,
-                           void *stack,
-                           size_t stack_size)
-{
-    struct thrd_port_t *port;
-
-    /* Initialize thrd port.*/
-    port = &thrd_p->port;
-    port->entry = entry;
-    port->arg = arg;
-    pthread_mutex_init(&port->mutex, NULL);
-    pthread_cond_init (&port->cond, NULL);
-    pthread_mutex_lock(&port->mutex);
-
-    if (pthread_create(&port->thrd, NULL, thrd_port_entry, port)) {
-        fprintf(stderr, "Error creating thrd\n");
-        return (1);
+    period = (sys_port_cpu_usage_counter() - thrd_p->port.cpu.period.start);
+
+    if (period == 0) {
+        return (0.0f);
     }
 
-    return (0);
+    return ((100.0f * thrd_p->port.cpu.period.time) / period);
 }
 
-static void thrd_port_idle_wait(struct thrd_t *thrd_p)
+static void thrd_port_cpu_usage_reset(struct thrd_t *thrd_p)
 {
-    pthread_mutex_lock(&idle.mutex);
-    pthread_cond_wait(&idle.cond, &idle.mutex);
-    pthread_mutex_unlock(&idle.mutex);
-
-    /* Add this thread to the ready list and reschedule. */
-    sys_lock();
-    thrd_p->state = THRD_STATE_READY;
-    scheduler_ready_push(thrd_p);
-    thrd_reschedule();
-    sys_unlock();
+    thrd_p->port.cpu.period.start = sys_port_cpu_usage_counter();
+    thrd_p->port.cpu.period.time = 0;
 }
 
-static void thrd_port_suspend_timer_callback(void *arg)
+/**
+ * Map a stack of given size, plus the stack needed by the host, with
+ * a guard page below it so that a stack overflow causes a
+ * segmentation fault. The thread is located at the top of the
+ * mapping, above the stack.
+ */
+static struct thrd_t *thrd_port_stack_alloc(size_t size,
+                                            char **stack_pp,
+                                            size_t *stack_size_p)
 {
-    struct thrd_t *thrd_p = arg;
+    struct thrd_t *thrd_p;
+    size_t page_size;
+    size_t map_size;
+    char *map_p;
+
+    page_size = sysconf(_SC_PAGESIZE);
+    map_size = (page_size
+                + DIV_CEIL(sizeof(*thrd_p) + size + THRD_PORT_STACK_HOST,
+                           page_size) * page_size);
+    map_p = mmap(NULL,
+                 map_size,
+                 PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK,
+                 -1,
+                 0);
+
+    if (map_p == MAP_FAILED) {
+        return (NULL);
+    }
 
-    thrd_p->err = -ETIMEDOUT;
-    thrd_p->state = THRD_STATE_READY;
-    scheduler_ready_push(thrd_p);
+    if (mprotect(map_p, page_size, PROT_NONE) != 0) {
+        munmap(map_p, map_size);
 
-    /* Signal idle thrd.*/
-    pthread_mutex_lock(&idle.mutex);
-    pthread_cond_signal(&idle.cond);
-    pthread_mutex_unlock(&idle.mutex);    
-}
+        return (NULL);
+    }
 
-static void thrd_port_tick(void)
-{
-    /* Signal idle thrd.*/
-    pthread_mutex_lock(&idle.mutex);
-    pthread_cond_signal(&idle.cond);
-    pthread_mutex_unlock(&idle.mutex);        
-}
+    thrd_p = (struct thrd_t *)((uintptr_t)(map_p + map_size - sizeof(*thrd_p))
+                               & ~(uintptr_t)15);
+    *stack_pp = (map_p + page_size);
+    *stack_size_p = ((char *)thrd_p - *stack_pp);
 
-static void thrd_port_cpu_usage_start(struct thrd_t *thrd_p)
-{
+    return (thrd_p);
 }
 
-static void thrd_port_cpu_usage_stop(struct thrd_t *thrd_p)
-{
-}
+#if !defined(NPROFILESTACK)
 
-static float thrd_port_cpu_usage_get(struct thrd_t *thrd_p)
+/**
+ * Give the stack pages of given terminated thread back to the
+ * host. They read as zeros when touched again, which is what the
+ * stack usage measurement expects.
+ */
+static void thrd_port_stack_reset(struct thrd_t *thrd_p)
 {
-    return (0.0);
-}
+    uintptr_t page_mask;
+    char *end_p;
 
-static void thrd_port_cpu_usage_reset(struct thrd_t *thrd_p)
-{
+    page_mask = (sysconf(_SC_PAGESIZE) - 1);
+    end_p = (char *)((uintptr_t)thrd_p & ~page_mask);
+    madvise(thrd_p->stack.begin_p, end_p - thrd_p->stack.begin_p, MADV_DONTNEED);
 }
+
+#endif
+
+#if defined(THRD_PORT_PTHREAD)
+#    include "thrd_port_pthread.i"
+#else
+#    include "thrd_port_ucontext.i"
+#endif
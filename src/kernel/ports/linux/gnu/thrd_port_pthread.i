@@ -0,0 +1,237 @@
+/**
+ * @file linux/gnu/thrd_port_pthread.i
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#define THRD_IDLE_STACK_MAX 1024
+#define THRD_MONITOR_STACK_MAX 1024
+
+/* The idle thread of a cpu blocks until the ticker, or on SMP another
+   cpu, signals that a thread may have become ready. The ticker does
+   not tick periodically, so a signal must not be lost. */
+struct thrd_port_idle_t {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int pending;
+};
+
+static struct thrd_t main_thrd;
+
+static struct thrd_port_idle_t idle[THRD_NCPUS] = {
+    [0 ... THRD_NCPUS - 1] = {
+        .mutex = PTHREAD_MUTEX_INITIALIZER,
+        .cond = PTHREAD_COND_INITIALIZER,
+        .pending = 0
+    }
+};
+
+#if THRD_NCPUS > 1
+
+/* The cpu the thread on this pthread runs on. Set when the thread is
+   swapped in, as it may run on a different cpu each time. */
+static __thread int thrd_port_cpu = 0;
+
+static int thrd_port_cpu_self(void)
+{
+    return (thrd_port_cpu);
+}
+
+#endif
+
+/**
+ * Let the pthread of given thread run.
+ */
+static void thrd_port_run(struct thrd_port_t *port)
+{
+    pthread_mutex_lock(&port->mutex);
+    port->running = 1;
+    pthread_cond_signal(&port->cond);
+    pthread_mutex_unlock(&port->mutex);
+}
+
+/**
+ * Block the calling pthread until its thread is allowed to run.
+ */
+static void thrd_port_wait_run(struct thrd_port_t *port)
+{
+    pthread_mutex_lock(&port->mutex);
+
+    while (port->running == 0) {
+        pthread_cond_wait(&port->cond, &port->mutex);
+    }
+
+    pthread_mutex_unlock(&port->mutex);
+}
+
+static void *thrd_port_entry(void *arg)
+{
+    struct thrd_port_t *port;
+
+    port = arg;
+    thrd_port_wait_run(port);
+#if THRD_NCPUS > 1
+    thrd_port_cpu = container_of(port, struct thrd_t, port)->cpu.index;
+#endif
+    sys_unlock();
+    thrd_port_cpu_usage_start(thrd_self());
+    port->entry(port->arg);
+
+    /* Thread termination. */
+    terminate();
+
+    return (NULL);
+}
+
+static void thrd_port_swap(struct thrd_t *in,
+                           struct thrd_t *out)
+{
+    /* A terminated thread signals 'in' thrd and exits. Its stack
+       may be reused by a new thread as soon as 'in' runs. */
+    if (out->state == THRD_STATE_TERMINATED) {
+        thrd_port_run(&in->port);
+        pthread_exit(NULL);
+    }
+
+    /* Signal 'in' thrd and wait until 'out' thrd is swapped in
+       again, possibly before this pthread starts waiting. */
+    pthread_mutex_lock(&out->port.mutex);
+    out->port.running = 0;
+    pthread_mutex_unlock(&out->port.mutex);
+    thrd_port_run(&in->port);
+    thrd_port_wait_run(&out->port);
+#if THRD_NCPUS > 1
+    thrd_port_cpu = out->cpu.index;
+#endif
+}
+
+static void thrd_port_init_main(struct thrd_port_t *port)
+{
+    port->cpu.start = sys_port_cpu_usage_counter();
+    port->cpu.period.start = port->cpu.start;
+    port->cpu.period.time = 0;
+    port->entry = NULL;
+    port->arg = NULL;
+    port->running = 1;
+    pthread_mutex_init(&port->mutex, NULL);
+    pthread_cond_init (&port->cond, NULL);
+}
+
+static int thrd_port_spawn(struct thrd_t *thrd_p,
+                           void *(*entry)(void *),
+                           void *arg,
+                           void *stack,
+                           size_t stack_size)
+{
+    struct thrd_port_t *port;
+
+    /* Initialize thrd port.*/
+    port = &thrd_p->port;
+    port->entry = entry;
+    port->arg = arg;
+    port->running = 0;
+    pthread_mutex_init(&port->mutex, NULL);
+    pthread_cond_init (&port->cond, NULL);
+    thrd_port_cpu_usage_reset(thrd_p);
+
+    if (pthread_create(&port->thrd, NULL, thrd_port_entry, port)) {
+        fprintf(stderr, "Error creating thrd\n");
+        return (1);
+    }
+
+    pthread_detach(port->thrd);
+
+    return (0);
+}
+
+static void thrd_port_idle_wait(struct thrd_t *thrd_p)
+{
+    struct thrd_port_idle_t *idle_p;
+
+    idle_p = &idle[CPU_SELF()];
+    pthread_mutex_lock(&idle_p->mutex);
+
+    while (idle_p->pending == 0) {
+        pthread_cond_wait(&idle_p->cond, &idle_p->mutex);
+    }
+
+    idle_p->pending = 0;
+    pthread_mutex_unlock(&idle_p->mutex);
+
+    /* Add this thread to the ready list and reschedule. */
+    sys_lock();
+    thrd_p->state = THRD_STATE_READY;
+    scheduler_ready_push(thrd_p);
+    thrd_reschedule();
+    sys_unlock();
+}
+
+/**
+ * Wake the idle thread of given cpu.
+ */
+static void thrd_port_cpu_kick(int cpu)
+{
+    pthread_mutex_lock(&idle[cpu].mutex);
+    idle[cpu].pending = 1;
+    pthread_cond_signal(&idle[cpu].cond);
+    pthread_mutex_unlock(&idle[cpu].mutex);
+}
+
+#if THRD_NCPUS > 1
+
+/**
+ * Start given thread on a cpu that has no current thread. Called with
+ * the system lock taken, which is released by the started thread.
+ */
+static void thrd_port_cpu_start(struct thrd_t *thrd_p)
+{
+    thrd_port_run(&thrd_p->port);
+}
+
+#endif
+
+static void thrd_port_idle_signal(void)
+{
+    /* On SMP, scheduler_ready_push() wakes the cpu of the pushed
+       thread. */
+#if THRD_NCPUS == 1
+    thrd_port_cpu_kick(0);
+#endif
+}
+
+static void thrd_port_suspend_timer_callback(void *arg)
+{
+    struct thrd_t *thrd_p = arg;
+
+    /* The thread may have been resumed before the timer expired. */
+    if (thrd_p->state != THRD_STATE_SUSPENDED) {
+        return;
+    }
+
+    thrd_p->err = -ETIMEDOUT;
+    thrd_p->state = THRD_STATE_READY;
+#if !defined(NTHRDSTATS)
+    stats_wakeup(thrd_p);
+#endif
+    scheduler_ready_push(thrd_p);
+    thrd_port_idle_signal();
+}
+
+static void thrd_port_tick(void)
+{
+    thrd_port_idle_signal();
+}
@@ -0,0 +1,144 @@
+/**
+ * @file linux/gnu/thrd_port_ucontext.i
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#define THRD_IDLE_STACK_MAX 1024
+#define THRD_MONITOR_STACK_MAX 1024
+
+/* The idle thread blocks the pthread running all threads until the
+   ticker signals that a thread may have become ready. */
+struct thrd_port_idle_t {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int pending;
+};
+
+static struct thrd_t main_thrd;
+
+static struct thrd_port_idle_t idle = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .pending = 0
+};
+
+static void thrd_port_entry(void)
+{
+    struct thrd_port_t *port_p;
+
+    /* The system lock was taken by the thread swapping to this
+       thread. */
+    sys_unlock();
+
+    thrd_port_cpu_usage_start(thrd_self());
+    port_p = &thrd_self()->port;
+    port_p->entry(port_p->arg);
+
+    /* Thread termination. */
+    terminate();
+}
+
+static void thrd_port_swap(struct thrd_t *in_p,
+                           struct thrd_t *out_p)
+{
+    swapcontext(&out_p->port.context, &in_p->port.context);
+}
+
+static void thrd_port_init_main(struct thrd_port_t *port)
+{
+    port->cpu.start = sys_port_cpu_usage_counter();
+    port->cpu.period.start = port->cpu.start;
+    port->cpu.period.time = 0;
+    port->entry = NULL;
+    port->arg = NULL;
+}
+
+static int thrd_port_spawn(struct thrd_t *thrd_p,
+                           void *(*entry)(void *),
+                           void *arg,
+                           void *stack,
+                           size_t stack_size)
+{
+    struct thrd_port_t *port_p;
+
+    port_p = &thrd_p->port;
+    port_p->entry = entry;
+    port_p->arg = arg;
+
+    if (getcontext(&port_p->context) != 0) {
+        return (-1);
+    }
+
+    port_p->context.uc_stack.ss_sp = stack;
+    port_p->context.uc_stack.ss_size = stack_size;
+    port_p->context.uc_link = NULL;
+    makecontext(&port_p->context, thrd_port_entry, 0);
+    thrd_port_cpu_usage_reset(thrd_p);
+
+    return (0);
+}
+
+static void thrd_port_idle_wait(struct thrd_t *thrd_p)
+{
+    pthread_mutex_lock(&idle.mutex);
+
+    while (idle.pending == 0) {
+        pthread_cond_wait(&idle.cond, &idle.mutex);
+    }
+
+    idle.pending = 0;
+    pthread_mutex_unlock(&idle.mutex);
+
+    /* Add this thread to the ready list and reschedule. */
+    sys_lock();
+    thrd_p->state = THRD_STATE_READY;
+    scheduler_ready_push(thrd_p);
+    thrd_reschedule();
+    sys_unlock();
+}
+
+static void thrd_port_idle_signal(void)
+{
+    pthread_mutex_lock(&idle.mutex);
+    idle.pending = 1;
+    pthread_cond_signal(&idle.cond);
+    pthread_mutex_unlock(&idle.mutex);
+}
+
+static void thrd_port_suspend_timer_callback(void *arg)
+{
+    struct thrd_t *thrd_p = arg;
+
+    /* The thread may have been resumed before the timer expired. */
+    if (thrd_p->state != THRD_STATE_SUSPENDED) {
+        return;
+    }
+
+    thrd_p->err = -ETIMEDOUT;
+    thrd_p->state = THRD_STATE_READY;
+#if !defined(NTHRDSTATS)
+    stats_wakeup(thrd_p);
+#endif
+    scheduler_ready_push(thrd_p);
+    thrd_port_idle_signal();
+}
+
+static void thrd_port_tick(void)
+{
+    thrd_port_idle_signal();
+}
@@ -23,3 +23,22 @@
 static void time_port_sleep(int us)
 {
 }
+
+/**
+ * Memory barrier for the time state sequence lock. The ticker thread
+ * may run on another cpu than the reader.
+ */
+static inline void time_port_barrier(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/**
+ * Ticks are processed lazily by the tickless ticker thread, so the
+ * time since the latest processed tick is read from the monotonic
+ * clock.
+ */
+static uint64_t time_port_get_ns_since_tick(uint64_t tick_ns)
+{
+    return (sys_port_get_ns() - tick_ns);
+}
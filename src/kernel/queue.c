@@ -47,6 +47,113 @@ static inline size_t get_buffer_used(struct queue_buffer_t *buffer_p)
     }
 }
 
+/**
+ * Copy up to size bytes from given buffer.
+ */
+static size_t buffer_read(struct queue_buffer_t *buffer_p,
+                          char *buf_p,
+                          size_t size)
+{
+    size_t n, buffer_used_until_end, buffer_used;
+
+    buffer_used = get_buffer_used(buffer_p);
+
+    if (size < buffer_used) {
+        n = size;
+    } else {
+        n = buffer_used;
+    }
+
+    buffer_used_until_end = BUFFER_USED_UNTIL_END(buffer_p);
+
+    if (n <= buffer_used_until_end) {
+        memcpy(buf_p, buffer_p->read_p, n);
+        buffer_p->read_p += n;
+    } else {
+        memcpy(buf_p, buffer_p->read_p, buffer_used_until_end);
+        memcpy(buf_p + buffer_used_until_end,
+               buffer_p->begin_p,
+               (n - buffer_used_until_end));
+        buffer_p->read_p = buffer_p->begin_p;
+        buffer_p->read_p += (n - buffer_used_until_end);
+    }
+
+    return (n);
+}
+
+/**
+ * Copy up to size bytes to given buffer.
+ */
+static size_t buffer_write(struct queue_buffer_t *buffer_p,
+                           const char *buf_p,
+                           size_t size)
+{
+    size_t n, buffer_unused_until_end, buffer_unused;
+
+    buffer_unused = BUFFER_UNUSED(buffer_p);
+
+    if (size < buffer_unused) {
+        n = size;
+    } else {
+        n = buffer_unused;
+    }
+
+    buffer_unused_until_end = BUFFER_UNUSED_UNTIL_END(buffer_p);
+
+    if (n <= buffer_unused_until_end) {
+        memcpy(buffer_p->write_p, buf_p, n);
+        buffer_p->write_p += n;
+    } else {
+        memcpy(buffer_p->write_p, buf_p, buffer_unused_until_end);
+        memcpy(buffer_p->begin_p,
+               buf_p + buffer_unused_until_end,
+               (n - buffer_unused_until_end));
+        buffer_p->write_p = buffer_p->begin_p;
+        buffer_p->write_p += (n - buffer_unused_until_end);
+    }
+
+    return (n);
+}
+
+/**
+ * Describe size bytes starting at given position as one or two
+ * contiguous spans of the buffer.
+ */
+static void buffer_get_spans(struct queue_buffer_t *buffer_p,
+                             char *position_p,
+                             size_t size,
+                             struct queue_span_t spans[2])
+{
+    size_t until_end;
+
+    if (position_p == buffer_p->end_p) {
+        position_p = buffer_p->begin_p;
+    }
+
+    until_end = (buffer_p->end_p - position_p);
+
+    spans[0].buf_p = position_p;
+    spans[0].size = MIN(size, until_end);
+    spans[1].buf_p = buffer_p->begin_p;
+    spans[1].size = (size - spans[0].size);
+}
+
+/**
+ * Return given position moved size bytes forward.
+ */
+static char *buffer_advance(struct queue_buffer_t *buffer_p,
+                            char *position_p,
+                            size_t size)
+{
+    position_p += size;
+
+    if (position_p > buffer_p->end_p) {
+        position_p = (buffer_p->begin_p + (position_p - buffer_p->end_p));
+    }
+
+    return (position_p);
+}
+
 int queue_init(struct queue_t *self_p,
                void *buf_p,
                size_t size)
@@ -55,6 +162,9 @@ int queue_init(struct queue_t *self_p,
               (ssize_t (*)(void *, void *, size_t))queue_read,
               (ssize_t (*)(void *, const void *, size_t))queue_write,
               (size_t (*)(void *))queue_size);
+    chan_set_iov_cb(&self_p->base,
+                    (ssize_t (*)(void *, struct iov_t *, size_t))queue_readv,
+                    (ssize_t (*)(void *, struct iov_t *, size_t))queue_writev);
 
     self_p->buffer.begin_p = buf_p;
     self_p->buffer.read_p = buf_p;
@@ -68,40 +178,34 @@ int queue_init(struct queue_t *self_p,
     return (0);
 }
 
-ssize_t queue_read(struct queue_t *self_p, void *buf_p, size_t size)
+/**
+ * Release the queue lock and suspend the thread. The lock is taken
+ * again when the thread is resumed. Called with the system lock and
+ * the queue lock taken.
+ */
+static void suspend_locked(struct queue_t *self_p)
 {
-    size_t left, n, buffer_used_until_end, buffer_used;
+    sys_object_unlock(&self_p->base.lock);
+    thrd_suspend_on_isr(NULL, THRD_WAIT_QUEUE);
+    sys_object_lock(&self_p->base.lock);
+}
+
+/**
+ * Read size bytes from given queue. Called with the system lock and
+ * the queue lock taken. Suspends the thread until all data has been
+ * read.
+ */
+static void read_locked(struct queue_t *self_p, char *buf_p, size_t size)
+{
+    size_t left, n;
     char *cbuf_p;
 
     left = size;
     cbuf_p = buf_p;
 
-    sys_lock();
-
     /* Copy data from queue buffer. */
     if (self_p->buffer.begin_p != NULL) {
-        buffer_used = get_buffer_used(&self_p->buffer);
-
-        if (left < buffer_used) {
-            n = left;
-        } else {
-            n = buffer_used;
-        }
-
-        buffer_used_until_end = BUFFER_USED_UNTIL_END(&self_p->buffer);
-
-        if (n <= buffer_used_until_end) {
-            memcpy(cbuf_p, self_p->buffer.read_p, n);
-            self_p->buffer.read_p += n;
-        } else {
-            memcpy(cbuf_p, self_p->buffer.read_p, buffer_used_until_end);
-            memcpy(cbuf_p + buffer_used_until_end,
-                   self_p->buffer.begin_p,
-                   (n - buffer_used_until_end));
-            self_p->buffer.read_p = self_p->buffer.begin_p;
-            self_p->buffer.read_p += (n - buffer_used_until_end);
-        }
-
+        n = buffer_read(&self_p->buffer, cbuf_p, left);
         cbuf_p += n;
         left -= n;
     }
@@ -135,17 +239,67 @@ ssize_t queue_read(struct queue_t *self_p, void *buf_p, size_t size)
         self_p->buf_p = cbuf_p;
         self_p->left = left;
 
-        thrd_suspend_isr(NULL);
+        suspend_locked(self_p);
     }
+}
 
-    sys_unlock();
+/**
+ * Write up to size bytes to given queue without blocking. Called
+ * with the system lock and the queue lock taken.
+ */
+static size_t write_isr_locked(struct queue_t *self_p,
+                               const char *buf_p,
+                               size_t size)
+{
+    size_t n, left;
+    const char *cbuf_p;
 
-    return (size);
+    left = size;
+    cbuf_p = buf_p;
+
+    if (chan_is_polled_isr(&self_p->base)) {
+        thrd_resume_isr(self_p->base.reader_p, 0);
+        self_p->base.reader_p = NULL;
+    }
+
+    /* Copy data to the reader, if one is present. */
+    if (self_p->base.reader_p != NULL) {
+        if (left < self_p->left) {
+            n = left;
+        } else {
+            n = self_p->left;
+        }
+
+        memcpy(self_p->buf_p, cbuf_p, n);
+
+        self_p->buf_p += n;
+        self_p->left -= n;
+        cbuf_p += n;
+        left -= n;
+
+        /* Read buffer full. */
+        if (self_p->left == 0) {
+            /* Wake the reader. */
+            thrd_resume_isr(self_p->base.reader_p, 0);
+            self_p->base.reader_p = NULL;
+        }
+    }
+
+    if ((left > 0) && (self_p->buffer.begin_p != NULL)) {
+        left -= buffer_write(&self_p->buffer, cbuf_p, left);
+    }
+
+    return (size - left);
 }
 
-ssize_t queue_write(struct queue_t *self_p,
-                    const void *buf_p,
-                    size_t size)
+/**
+ * Write size bytes to given queue. Called with the system lock and
+ * the queue lock taken. Suspends the thread until all data has been
+ * written.
+ */
+static void write_locked(struct queue_t *self_p,
+                         const char *buf_p,
+                         size_t size)
 {
     size_t left;
     const char *cbuf_p;
@@ -153,9 +307,7 @@ ssize_t queue_write(struct queue_t *self_p,
     left = size;
     cbuf_p = buf_p;
 
-    sys_lock();
-
-    left -= queue_write_isr(self_p, cbuf_p, size);
+    left -= write_isr_locked(self_p, cbuf_p, size);
 
     /* The writer writes the remaining data. */
     if (left > 0) {
@@ -164,9 +316,190 @@ ssize_t queue_write(struct queue_t *self_p,
         self_p->buf_p = (void *)cbuf_p;
         self_p->left = left;
 
-        thrd_suspend_isr(NULL);
+        suspend_locked(self_p);
+    }
+}
+
+/**
+ * Make size bytes written in place available to the reader. Called
+ * with the queue lock taken, and with the system lock taken if a
+ * reader is present.
+ */
+static ssize_t commit_locked(struct queue_t *self_p, size_t size)
+{
+    size_t n;
+
+    if ((self_p->buffer.begin_p == NULL)
+        || (size > BUFFER_UNUSED(&self_p->buffer))) {
+        return (-EINVAL);
+    }
+
+    self_p->buffer.write_p = buffer_advance(&self_p->buffer,
+                                            self_p->buffer.write_p,
+                                            size);
+
+    if (chan_is_polled_isr(&self_p->base)) {
+        thrd_resume_isr(self_p->base.reader_p, 0);
+        self_p->base.reader_p = NULL;
+    }
+
+    /* Move the committed data to the reader, if one is present. */
+    if (self_p->base.reader_p != NULL) {
+        n = buffer_read(&self_p->buffer, self_p->buf_p, self_p->left);
+        self_p->buf_p += n;
+        self_p->left -= n;
+
+        /* Read buffer full. */
+        if (self_p->left == 0) {
+            /* Wake the reader. */
+            thrd_resume_isr(self_p->base.reader_p, 0);
+            self_p->base.reader_p = NULL;
+        }
+    }
+
+    return (size);
+}
+
+/**
+ * Remove size bytes from the queue buffer. Called with the queue lock
+ * taken, and with the system lock taken if a writer is present.
+ */
+static ssize_t consume_locked(struct queue_t *self_p, size_t size)
+{
+    size_t n;
+
+    if ((self_p->buffer.begin_p == NULL)
+        || (size > get_buffer_used(&self_p->buffer))) {
+        return (-EINVAL);
     }
 
+    self_p->buffer.read_p = buffer_advance(&self_p->buffer,
+                                           self_p->buffer.read_p,
+                                           size);
+
+    /* Move data from the writer, if one is present, to the space
+       just made available. */
+    if (self_p->base.writer_p != NULL) {
+        n = buffer_write(&self_p->buffer, self_p->buf_p, self_p->left);
+        self_p->buf_p += n;
+        self_p->left -= n;
+
+        /* Writer buffer empty. */
+        if (self_p->left == 0) {
+            /* Wake the writer. */
+            thrd_resume_isr(self_p->base.writer_p, 0);
+            self_p->base.writer_p = NULL;
+        }
+    }
+
+    return (size);
+}
+
+ssize_t queue_read(struct queue_t *self_p, void *buf_p, size_t size)
+{
+    TRACE_EVENT(TRACE_EVENT_QUEUE_READ, self_p, MIN(size, 0xffff));
+
+    /* Only the queue lock is needed if all data is in the queue
+       buffer and no writer has to be resumed. The writer is read
+       without the lock as a hint, and checked again with it. */
+    if (self_p->base.writer_p == NULL) {
+        sys_object_lock(&self_p->base.lock);
+
+        if ((self_p->base.writer_p == NULL)
+            && (get_buffer_used(&self_p->buffer) >= size)) {
+            buffer_read(&self_p->buffer, buf_p, size);
+            sys_object_unlock(&self_p->base.lock);
+
+            return (size);
+        }
+
+        sys_object_unlock(&self_p->base.lock);
+    }
+
+    sys_lock();
+    sys_object_lock(&self_p->base.lock);
+    read_locked(self_p, buf_p, size);
+    sys_object_unlock(&self_p->base.lock);
+    sys_unlock();
+
+    return (size);
+}
+
+ssize_t queue_write(struct queue_t *self_p,
+                    const void *buf_p,
+                    size_t size)
+{
+    TRACE_EVENT(TRACE_EVENT_QUEUE_WRITE, self_p, MIN(size, 0xffff));
+
+    /* Only the queue lock is needed if all data fits in the queue
+       buffer and no reader has to be resumed. The reader is read
+       without the lock as a hint, and checked again with it. */
+    if (self_p->base.reader_p == NULL) {
+        sys_object_lock(&self_p->base.lock);
+
+        if ((self_p->base.reader_p == NULL)
+            && (self_p->base.writer_p == NULL)
+            && (self_p->buffer.begin_p != NULL)
+            && (BUFFER_UNUSED(&self_p->buffer) >= size)) {
+            buffer_write(&self_p->buffer, buf_p, size);
+            sys_object_unlock(&self_p->base.lock);
+
+            return (size);
+        }
+
+        sys_object_unlock(&self_p->base.lock);
+    }
+
+    sys_lock();
+    sys_object_lock(&self_p->base.lock);
+    write_locked(self_p, buf_p, size);
+    sys_object_unlock(&self_p->base.lock);
+    sys_unlock();
+
+    return (size);
+}
+
+ssize_t queue_readv(struct queue_t *self_p,
+                    struct iov_t *iov_p,
+                    size_t length)
+{
+    ssize_t size;
+    size_t i;
+
+    size = 0;
+
+    sys_lock();
+    sys_object_lock(&self_p->base.lock);
+
+    for (i = 0; i < length; i++) {
+        read_locked(self_p, iov_p[i].buf_p, iov_p[i].size);
+        size += iov_p[i].size;
+    }
+
+    sys_object_unlock(&self_p->base.lock);
+    sys_unlock();
+
+    return (size);
+}
+
+ssize_t queue_writev(struct queue_t *self_p,
+                     struct iov_t *iov_p,
+                     size_t length)
+{
+    ssize_t size;
+    size_t i;
+
+    size = 0;
+
+    sys_lock();
+    sys_object_lock(&self_p->base.lock);
+
+    for (i = 0; i < length; i++) {
+        write_locked(self_p, iov_p[i].buf_p, iov_p[i].size);
+        size += iov_p[i].size;
+    }
+
+    sys_object_unlock(&self_p->base.lock);
     sys_unlock();
 
     return (size);
@@ -176,71 +509,507 @@ ssize_t queue_write_isr(struct queue_t *self_p,
                         const void *buf_p,
                         size_t size)
 {
-    size_t n, left;
-    size_t buffer_unused_until_end, buffer_unused;
-    const char *cbuf_p;
+    sys_object_lock(&self_p->base.lock);
+    size = write_isr_locked(self_p, buf_p, size);
+    sys_object_unlock(&self_p->base.lock);
+
+    return (size);
+}
+
+ssize_t queue_size(struct queue_t *self_p)
+{
+    return (get_buffer_used(&self_p->buffer) + WRITER_SIZE(self_p));
+}
+
+ssize_t queue_write_reserve(struct queue_t *self_p,
+                            struct queue_span_t spans[2],
+                            size_t size)
+{
+    /* Only the queue lock is needed. */
+    return (queue_write_reserve_isr(self_p, spans, size));
+}
+
+ssize_t queue_write_reserve_isr(struct queue_t *self_p,
+                                struct queue_span_t spans[2],
+                                size_t size)
+{
+    size_t buffer_unused;
+
+    if (self_p->buffer.begin_p == NULL) {
+        return (-EINVAL);
+    }
+
+    sys_object_lock(&self_p->base.lock);
+
+    buffer_unused = BUFFER_UNUSED(&self_p->buffer);
+
+    if (size > buffer_unused) {
+        size = buffer_unused;
+    }
+
+    buffer_get_spans(&self_p->buffer, self_p->buffer.write_p, size, spans);
+
+    sys_object_unlock(&self_p->base.lock);
+
+    return (size);
+}
+
+ssize_t queue_write_commit(struct queue_t *self_p, size_t size)
+{
+    ssize_t res;
+
+    if (self_p->base.reader_p == NULL) {
+        sys_object_lock(&self_p->base.lock);
+
+        if (self_p->base.reader_p == NULL) {
+            res = commit_locked(self_p, size);
+            sys_object_unlock(&self_p->base.lock);
+
+            return (res);
+        }
+
+        sys_object_unlock(&self_p->base.lock);
+    }
+
+    sys_lock();
+    sys_object_lock(&self_p->base.lock);
+    res = commit_locked(self_p, size);
+    sys_object_unlock(&self_p->base.lock);
+    sys_unlock();
+
+    return (res);
+}
+
+ssize_t queue_write_commit_isr(struct queue_t *self_p, size_t size)
+{
+    ssize_t res;
+
+    sys_object_lock(&self_p->base.lock);
+    res = commit_locked(self_p, size);
+    sys_object_unlock(&self_p->base.lock);
+
+    return (res);
+}
+
+ssize_t queue_read_peek(struct queue_t *self_p,
+                        struct queue_span_t spans[2])
+{
+    size_t buffer_used;
+
+    if (self_p->buffer.begin_p == NULL) {
+        return (-EINVAL);
+    }
+
+    sys_object_lock(&self_p->base.lock);
+    buffer_used = get_buffer_used(&self_p->buffer);
+
+    if (buffer_used > 0) {
+        buffer_get_spans(&self_p->buffer,
+                         self_p->buffer.read_p,
+                         buffer_used,
+                         spans);
+        sys_object_unlock(&self_p->base.lock);
+
+        return (buffer_used);
+    }
+
+    sys_object_unlock(&self_p->base.lock);
+
+    sys_lock();
+    sys_object_lock(&self_p->base.lock);
+
+    /* Wait for data. A reader without a buffer is woken by the next
+       write, which then stores its data in the queue buffer. */
+    while ((buffer_used = get_buffer_used(&self_p->buffer)) == 0) {
+        self_p->base.reader_p = thrd_self();
+        self_p->buf_p = NULL;
+        self_p->left = 0;
+
+        suspend_locked(self_p);
+    }
+
+    buffer_get_spans(&self_p->buffer,
+                     self_p->buffer.read_p,
+                     buffer_used,
+                     spans);
+
+    sys_object_unlock(&self_p->base.lock);
+    sys_unlock();
+
+    return (buffer_used);
+}
+
+ssize_t queue_read_consume(struct queue_t *self_p, size_t size)
+{
+    ssize_t res;
+
+    if (self_p->base.writer_p == NULL) {
+        sys_object_lock(&self_p->base.lock);
+
+        if (self_p->base.writer_p == NULL) {
+            res = consume_locked(self_p, size);
+            sys_object_unlock(&self_p->base.lock);
+
+            return (res);
+        }
+
+        sys_object_unlock(&self_p->base.lock);
+    }
+
+    sys_lock();
+    sys_object_lock(&self_p->base.lock);
+    res = consume_locked(self_p, size);
+    sys_object_unlock(&self_p->base.lock);
+    sys_unlock();
+
+    return (res);
+}
+
+ssize_t queue_read_until(struct queue_t *self_p,
+                         void *buf_p,
+                         size_t size,
+                         char delim)
+{
+    struct queue_span_t spans[2];
+    size_t left, n, consumed;
+    ssize_t res;
+    char *cbuf_p, *delim_p;
+    int i, found;
 
     left = size;
     cbuf_p = buf_p;
+    found = 0;
+
+    while ((left > 0) && (found == 0)) {
+        res = queue_read_peek(self_p, spans);
+
+        if (res < 0) {
+            return (res);
+        }
+
+        consumed = 0;
+
+        for (i = 0; (i < 2) && (left > 0) && (found == 0); i++) {
+            n = MIN(spans[i].size, left);
+            delim_p = memchr(spans[i].buf_p, delim, n);
+
+            if (delim_p != NULL) {
+                n = (delim_p - spans[i].buf_p + 1);
+                found = 1;
+            }
+
+            memcpy(cbuf_p, spans[i].buf_p, n);
+            cbuf_p += n;
+            left -= n;
+            consumed += n;
+        }
+
+        queue_read_consume(self_p, consumed);
+    }
+
+    return (size - left);
+}
+
+/* Ring indices shared between the reader and the writer. */
+#define LOAD_RELAXED(var) __atomic_load_n(&(var), __ATOMIC_RELAXED)
+#define LOAD_ACQUIRE(var) __atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#define STORE_RELAXED(var, value)                       \
+    __atomic_store_n(&(var), (value), __ATOMIC_RELAXED)
+#define STORE_RELEASE(var, value)                       \
+    __atomic_store_n(&(var), (value), __ATOMIC_RELEASE)
+
+/* Orders the publication of an index with the check for a blocked
+   reader or writer, and vice versa. */
+#define FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#define SPSC_CAPACITY(self_p) ((size_t)(self_p)->mask + 1)
+#define SPSC_USED(read, write) ((size_t)(queue_spsc_index_t)((write) - (read)))
+
+static void spsc_copy_in(struct queue_spsc_t *self_p,
+                         queue_spsc_index_t index,
+                         const char *buf_p,
+                         size_t size)
+{
+    size_t offset, until_end;
+
+    offset = (index & self_p->mask);
+    until_end = (SPSC_CAPACITY(self_p) - offset);
+
+    if (size <= until_end) {
+        memcpy(&self_p->buf_p[offset], buf_p, size);
+    } else {
+        memcpy(&self_p->buf_p[offset], buf_p, until_end);
+        memcpy(self_p->buf_p, buf_p + until_end, size - until_end);
+    }
+}
+
+static void spsc_copy_out(struct queue_spsc_t *self_p,
+                          queue_spsc_index_t index,
+                          char *buf_p,
+                          size_t size)
+{
+    size_t offset, until_end;
+
+    offset = (index & self_p->mask);
+    until_end = (SPSC_CAPACITY(self_p) - offset);
+
+    if (size <= until_end) {
+        memcpy(buf_p, &self_p->buf_p[offset], size);
+    } else {
+        memcpy(buf_p, &self_p->buf_p[offset], until_end);
+        memcpy(buf_p + until_end, self_p->buf_p, size - until_end);
+    }
+}
+
+/**
+ * Copy as many bytes as fits into the ring. Only called by the
+ * writer.
+ */
+static size_t spsc_put(struct queue_spsc_t *self_p,
+                       const char *buf_p,
+                       size_t size)
+{
+    queue_spsc_index_t read, write;
+    size_t n;
+
+    write = self_p->write;
+    read = LOAD_ACQUIRE(self_p->read);
+    n = (SPSC_CAPACITY(self_p) - SPSC_USED(read, write));
+
+    if (size < n) {
+        n = size;
+    }
+
+    if (n > 0) {
+        spsc_copy_in(self_p, write, buf_p, n);
+        STORE_RELEASE(self_p->write, (queue_spsc_index_t)(write + n));
+    }
+
+    return (n);
+}
+
+/**
+ * Copy as many bytes as available from the ring. Only called by the
+ * reader.
+ */
+static size_t spsc_get(struct queue_spsc_t *self_p,
+                       char *buf_p,
+                       size_t size)
+{
+    queue_spsc_index_t read, write;
+    size_t n;
+
+    read = self_p->read;
+    write = LOAD_ACQUIRE(self_p->write);
+    n = SPSC_USED(read, write);
+
+    if (size < n) {
+        n = size;
+    }
+
+    if (n > 0) {
+        spsc_copy_out(self_p, read, buf_p, n);
+        STORE_RELEASE(self_p->read, (queue_spsc_index_t)(read + n));
+    }
+
+    return (n);
+}
+
+/**
+ * Resume the reader if it is polling the queue or waiting for the
+ * data now available. Called with the system lock taken.
+ */
+static void spsc_resume_reader_isr(struct queue_spsc_t *self_p)
+{
+    size_t used;
 
     if (chan_is_polled_isr(&self_p->base)) {
         thrd_resume_isr(self_p->base.reader_p, 0);
-        self_p->base.reader_p = NULL;
+        STORE_RELAXED(self_p->base.reader_p, NULL);
+    } else if (self_p->reader_wanted > 0) {
+        used = SPSC_USED(self_p->read, LOAD_ACQUIRE(self_p->write));
+
+        if (used >= self_p->reader_wanted) {
+            thrd_resume_isr(self_p->base.reader_p, 0);
+            STORE_RELAXED(self_p->base.reader_p, NULL);
+            self_p->reader_wanted = 0;
+        }
+    } else {
+        /* Left behind by a list poll that returned another
+           channel. */
+        STORE_RELAXED(self_p->base.reader_p, NULL);
     }
+}
 
-    /* Copy data to the reader, if one is present. */
-    if (self_p->base.reader_p != NULL) {
-        if (left < self_p->left) {
-            n = left;
-        } else {
-            n = self_p->left;
+/**
+ * Resume the writer if enough space is available. Called with the
+ * system lock taken.
+ */
+static void spsc_resume_writer_isr(struct queue_spsc_t *self_p)
+{
+    size_t unused;
+
+    if (self_p->writer_wanted > 0) {
+        unused = (SPSC_CAPACITY(self_p)
+                  - SPSC_USED(LOAD_ACQUIRE(self_p->read), self_p->write));
+
+        if (unused >= self_p->writer_wanted) {
+            thrd_resume_isr(self_p->base.writer_p, 0);
+            STORE_RELAXED(self_p->base.writer_p, NULL);
+            self_p->writer_wanted = 0;
         }
-        
-        memcpy(self_p->buf_p, cbuf_p, n);
+    }
+}
 
-        self_p->buf_p += n;
-        self_p->left -= n;
+int queue_spsc_init(struct queue_spsc_t *self_p,
+                    void *buf_p,
+                    size_t size)
+{
+    /* The size must be a power of two that the free running indices
+       can tell apart from an empty ring. */
+    if ((size == 0)
+        || ((size & (size - 1)) != 0)
+        || ((size - 1) > ((queue_spsc_index_t)-1 >> 1))) {
+        return (-EINVAL);
+    }
+
+    chan_init(&self_p->base,
+              (ssize_t (*)(void *, void *, size_t))queue_spsc_read,
+              (ssize_t (*)(void *, const void *, size_t))queue_spsc_write,
+              (size_t (*)(void *))queue_spsc_size);
+
+    self_p->buf_p = buf_p;
+    self_p->mask = (size - 1);
+    self_p->read = 0;
+    self_p->write = 0;
+    self_p->reader_wanted = 0;
+    self_p->writer_wanted = 0;
+
+    return (0);
+}
+
+ssize_t queue_spsc_read(struct queue_spsc_t *self_p,
+                        void *buf_p,
+                        size_t size)
+{
+    size_t left, n;
+    char *cbuf_p;
+
+    left = size;
+    cbuf_p = buf_p;
+
+    while (1) {
+        n = spsc_get(self_p, cbuf_p, left);
         cbuf_p += n;
         left -= n;
 
-        /* Read buffer full. */
-        if (self_p->left == 0) {
-            /* Wake the reader. */
-            thrd_resume_isr(self_p->base.reader_p, 0);
-            self_p->base.reader_p = NULL;
+        /* Wake the writer if it waits for space. */
+        if (n > 0) {
+            FENCE();
+
+            if (LOAD_RELAXED(self_p->base.writer_p) != NULL) {
+                sys_lock();
+                spsc_resume_writer_isr(self_p);
+                sys_unlock();
+            }
         }
-    }
 
-    if ((left > 0) && (self_p->buffer.begin_p != NULL)) {
-        buffer_unused = BUFFER_UNUSED(&self_p->buffer);
+        if (left == 0) {
+            break;
+        }
 
-        if (left < buffer_unused) {
-            n = left;
+        /* The ring is empty. Wait for the writer, unless it wrote
+           more data before it could see this reader. */
+        sys_lock();
+
+        self_p->reader_wanted = MIN(left, SPSC_CAPACITY(self_p));
+        STORE_RELAXED(self_p->base.reader_p, thrd_self());
+        FENCE();
+
+        if (SPSC_USED(self_p->read, LOAD_ACQUIRE(self_p->write))
+            < self_p->reader_wanted) {
+            thrd_suspend_on_isr(NULL, THRD_WAIT_QUEUE);
         } else {
-            n = buffer_unused;
+            STORE_RELAXED(self_p->base.reader_p, NULL);
+            self_p->reader_wanted = 0;
         }
 
-        buffer_unused_until_end = BUFFER_UNUSED_UNTIL_END(&self_p->buffer);
+        sys_unlock();
+    }
+
+    return (size);
+}
+
+ssize_t queue_spsc_write(struct queue_spsc_t *self_p,
+                         const void *buf_p,
+                         size_t size)
+{
+    size_t left, n;
+    const char *cbuf_p;
 
-        if (n <= buffer_unused_until_end) {
-            memcpy(self_p->buffer.write_p, cbuf_p, n);
-            self_p->buffer.write_p += n;
+    left = size;
+    cbuf_p = buf_p;
+
+    while (1) {
+        n = spsc_put(self_p, cbuf_p, left);
+        cbuf_p += n;
+        left -= n;
+
+        /* Wake the reader if it waits for data. */
+        FENCE();
+
+        if (LOAD_RELAXED(self_p->base.reader_p) != NULL) {
+            sys_lock();
+            spsc_resume_reader_isr(self_p);
+            sys_unlock();
+        }
+
+        if (left == 0) {
+            break;
+        }
+
+        /* The ring is full. Wait for the reader, unless it read some
+           data before it could see this writer. */
+        sys_lock();
+
+        self_p->writer_wanted = MIN(left, SPSC_CAPACITY(self_p));
+        STORE_RELAXED(self_p->base.writer_p, thrd_self());
+        FENCE();
+
+        if ((SPSC_CAPACITY(self_p)
+             - SPSC_USED(LOAD_ACQUIRE(self_p->read), self_p->write))
+            < self_p->writer_wanted) {
+            thrd_suspend_on_isr(NULL, THRD_WAIT_QUEUE);
         } else {
-            memcpy(self_p->buffer.write_p, cbuf_p, buffer_unused_until_end);
-            memcpy(self_p->buffer.begin_p,
-                   cbuf_p + buffer_unused_until_end,
-                   (n - buffer_unused_until_end));
-            self_p->buffer.write_p = self_p->buffer.begin_p;
-            self_p->buffer.write_p += (n - buffer_unused_until_end);
+            STORE_RELAXED(self_p->base.writer_p, NULL);
+            self_p->writer_wanted = 0;
         }
 
-        left -= n;
+        sys_unlock();
     }
 
-    return (size - left);
+    return (size);
 }
 
-ssize_t queue_size(struct queue_t *self_p)
+ssize_t queue_spsc_write_isr(struct queue_spsc_t *self_p,
+                             const void *buf_p,
+                             size_t size)
 {
-    return (get_buffer_used(&self_p->buffer) + WRITER_SIZE(self_p));
+    size_t n;
+
+    n = spsc_put(self_p, buf_p, size);
+
+    /* The reader registers itself with the system lock taken, which
+       is already held here. */
+    if (self_p->base.reader_p != NULL) {
+        spsc_resume_reader_isr(self_p);
+    }
+
+    return (n);
+}
+
+ssize_t queue_spsc_size(struct queue_spsc_t *self_p)
+{
+    return (SPSC_USED(LOAD_ACQUIRE(self_p->read),
+                      LOAD_ACQUIRE(self_p->write)));
 }
@@ -20,12 +20,6 @@
 
 #include "simba.h"
 
-struct sem_elem_t {
-    struct sem_elem_t *next_p;
-    struct sem_elem_t *prev_p;
-    struct thrd_t *thrd_p;
-};
-
 int sem_module_init(void)
 {
     return (0);
@@ -35,63 +29,62 @@ int sem_init(struct sem_t *self_p,
              int count)
 {
     self_p->count = count;
+    self_p->order = SEM_ORDER_FIFO;
     self_p->head_p = NULL;
+    self_p->tail_p = NULL;
+    sys_object_lock_init(&self_p->lock);
 
     return (0);
 }
 
-int sem_get(struct sem_t *self_p,
-            struct time_t *timeout_p)
+int sem_set_order(struct sem_t *self_p,
+                  int order)
 {
     int err = 0;
-    struct sem_elem_t elem;
 
-    sys_lock();
+    sys_object_lock(&self_p->lock);
 
-    if (self_p->count == 0) {
-        elem.thrd_p = thrd_self();
-        elem.next_p = self_p->head_p;
-        elem.prev_p = NULL;
-        self_p->head_p = &elem;
-        err = thrd_suspend_isr(timeout_p);
-
-        if (err == -ETIMEDOUT) {
-            if (elem.prev_p != NULL) {
-                elem.prev_p->next_p = elem.next_p;
-            } else {
-                self_p->head_p = elem.next_p;
-            }
-
-            if (elem.next_p != NULL) {
-                elem.next_p->prev_p = elem.prev_p;
-            }
-        }
+    if (self_p->head_p != NULL) {
+        err = -EBUSY;
     } else {
-        self_p->count--;
+        self_p->order = order;
     }
 
-    sys_unlock();
+    sys_object_unlock(&self_p->lock);
 
     return (err);
 }
 
-int sem_put(struct sem_t *self_p,
-            int count)
+/**
+ * Remove given element from the queue of waiting threads.
+ */
+static void remove_elem(struct sem_t *self_p, struct sem_elem_t *elem_p)
 {
-    sys_lock();
-    sem_put_isr(self_p, count);
-    sys_unlock();
+    if (elem_p->prev_p != NULL) {
+        elem_p->prev_p->next_p = elem_p->next_p;
+    } else {
+        self_p->head_p = elem_p->next_p;
+    }
 
-    return (0);
+    if (elem_p->next_p != NULL) {
+        elem_p->next_p->prev_p = elem_p->prev_p;
+    } else {
+        self_p->tail_p = elem_p->prev_p;
+    }
 }
 
-int sem_put_isr(struct sem_t *self_p,
-                int count)
+/**
+ * Add given count and wake waiting threads. Called with the system
+ * lock and the semaphore lock taken.
+ */
+static void put_isr_locked(struct sem_t *self_p, int count)
 {
     struct sem_elem_t *elem_p;
+    struct thrd_t *thrd_p;
 
     self_p->count += count;
 
+    /* Wake waiting threads from the head of the queue. */
     while ((self_p->count > 0) && (self_p->head_p != NULL)) {
         self_p->count--;
         elem_p = self_p->head_p;
@@ -99,10 +92,177 @@ int sem_put_isr(struct sem_t *self_p,
 
         if (elem_p->next_p != NULL) {
             elem_p->next_p->prev_p = NULL;
+        } else {
+            self_p->tail_p = NULL;
+        }
+
+        /* The thread pointer tells an element queued with
+           sem_wait_isr() that it got the semaphore. */
+        thrd_p = elem_p->thrd_p;
+        elem_p->thrd_p = NULL;
+        thrd_resume_isr(thrd_p, 0);
+    }
+}
+
+/**
+ * Insert given element in the queue of waiting threads. Called with
+ * the semaphore lock taken.
+ */
+static void insert_elem(struct sem_t *self_p, struct sem_elem_t *elem_p)
+{
+    struct sem_elem_t *prev_p;
+
+    prev_p = self_p->tail_p;
+
+    /* Find the last waiting thread with higher or equal priority. */
+    if (self_p->order == SEM_ORDER_PRIO) {
+        while ((prev_p != NULL)
+               && (prev_p->thrd_p->prio > elem_p->thrd_p->prio)) {
+            prev_p = prev_p->prev_p;
         }
+    }
+
+    /* Insert after 'prev_p'. */
+    elem_p->prev_p = prev_p;
+
+    if (prev_p != NULL) {
+        elem_p->next_p = prev_p->next_p;
+        prev_p->next_p = elem_p;
+    } else {
+        elem_p->next_p = self_p->head_p;
+        self_p->head_p = elem_p;
+    }
 
-        thrd_resume_isr(elem_p->thrd_p, 0);
+    if (elem_p->next_p != NULL) {
+        elem_p->next_p->prev_p = elem_p;
+    } else {
+        self_p->tail_p = elem_p;
     }
+}
+
+int sem_get(struct sem_t *self_p,
+            struct time_t *timeout_p)
+{
+    int err = 0;
+    struct sem_elem_t elem;
+
+    TRACE_EVENT(TRACE_EVENT_SEM_GET, self_p, 0);
+
+    /* Only the semaphore lock is needed if the count is non-zero. */
+    sys_object_lock(&self_p->lock);
+
+    if (self_p->count > 0) {
+        self_p->count--;
+        sys_object_unlock(&self_p->lock);
+
+        return (0);
+    }
+
+    /* Queue the thread before the semaphore lock is released, so a
+       thread calling sem_get() later cannot take the semaphore
+       first. The system lock cannot be taken with the semaphore lock
+       held, so a put before the thread is suspended resumes it and
+       the suspend below returns immediately. */
+    elem.thrd_p = thrd_self();
+    insert_elem(self_p, &elem);
+    sys_object_unlock(&self_p->lock);
+
+    sys_lock();
+    err = thrd_suspend_on_isr(timeout_p, THRD_WAIT_SEM);
+
+    if (err == -ETIMEDOUT) {
+        sys_object_lock(&self_p->lock);
+
+        /* The semaphore may have been given after the timeout. */
+        if (elem.thrd_p != NULL) {
+            remove_elem(self_p, &elem);
+        } else {
+            err = 0;
+        }
+
+        sys_object_unlock(&self_p->lock);
+    }
+
+    sys_unlock();
+
+    return (err);
+}
+
+int sem_wait_isr(struct sem_t *self_p,
+                 struct sem_elem_t *elem_p)
+{
+    int err = 0;
+
+    sys_object_lock(&self_p->lock);
+
+    if (self_p->count > 0) {
+        self_p->count--;
+    } else {
+        elem_p->thrd_p = thrd_self();
+        insert_elem(self_p, elem_p);
+        err = -EAGAIN;
+    }
+
+    sys_object_unlock(&self_p->lock);
+
+    return (err);
+}
+
+int sem_cancel_isr(struct sem_t *self_p,
+                   struct sem_elem_t *elem_p)
+{
+    sys_object_lock(&self_p->lock);
+
+    if (elem_p->thrd_p != NULL) {
+        remove_elem(self_p, elem_p);
+        elem_p->thrd_p = NULL;
+    } else {
+        put_isr_locked(self_p, 1);
+    }
+
+    sys_object_unlock(&self_p->lock);
+
+    return (0);
+}
+
+int sem_put(struct sem_t *self_p,
+            int count)
+{
+    TRACE_EVENT(TRACE_EVENT_SEM_PUT, self_p, count);
+
+    /* Only the semaphore lock is needed if no thread is waiting. The
+       queue of waiting threads is read without the lock as a hint,
+       and checked again with it. A thread is queued by sem_get()
+       before it releases the semaphore lock, so a count added here
+       cannot be taken ahead of a waiting thread. */
+    if (self_p->head_p == NULL) {
+        sys_object_lock(&self_p->lock);
+
+        if (self_p->head_p == NULL) {
+            self_p->count += count;
+            sys_object_unlock(&self_p->lock);
+
+            return (0);
+        }
+
+        sys_object_unlock(&self_p->lock);
+    }
+
+    sys_lock();
+    sys_object_lock(&self_p->lock);
+    put_isr_locked(self_p, count);
+    sys_object_unlock(&self_p->lock);
+    sys_unlock();
+
+    return (0);
+}
+
+int sem_put_isr(struct sem_t *self_p,
+                int count)
+{
+    sys_object_lock(&self_p->lock);
+    put_isr_locked(self_p, count);
+    sys_object_unlock(&self_p->lock);
 
     return (0);
 }
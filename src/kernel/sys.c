@@ -21,6 +21,10 @@
 #include "simba.h"
 
 FS_COMMAND_DEFINE("/kernel/sys/info", sys_cmd_info);
+#if defined(SYS_LOCK_PROFILE)
+FS_COMMAND_DEFINE("/kernel/sys/lock_stats/list", sys_cmd_lock_stats_list);
+FS_COMMAND_DEFINE("/kernel/sys/lock_stats/reset", sys_cmd_lock_stats_reset);
+#endif
 
 struct sys_t sys = {
     .tick = 0,
@@ -33,10 +37,19 @@ struct sys_t sys = {
 };
 
 extern void time_tick(void);
+extern void time_tick_n(uint32_t ticks);
 extern void timer_tick(void);
+extern void timer_tick_isr(void);
+extern uint32_t timer_idle_ticks_isr(void);
+extern void timer_skip_isr(uint32_t ticks);
 extern void thrd_tick(void);
+#if THRD_NCPUS > 1
+extern void thrd_start_cpus(void);
+#endif
 extern const FAR char sysinfo[];
 
+#if !defined(SYS_PORT_TICKLESS)
+
 static void sys_tick(void) {
     sys.tick++;
     time_tick();
@@ -44,6 +57,54 @@ static void sys_tick(void) {
     thrd_tick();
 }
 
+#else
+
+/* Set while timers are processed in a batch. */
+static int tick_batch_active = 0;
+
+/**
+ * Process all ticks up to given tick in one batch, for ports that do
+ * not tick periodically. Ticks in which no timer expires are skipped
+ * in one step. Called with the system lock taken. `thrd_tick()` is
+ * not called.
+ */
+static void sys_tick_batch_isr(sys_tick_t tick)
+{
+    uint32_t idle_ticks;
+    sys_tick_t ticks;
+
+    /* A timer callback setting a timer must not process later ticks
+       before all timers of the current tick have fired. */
+    if (tick_batch_active == 1) {
+        return;
+    }
+
+    tick_batch_active = 1;
+
+    while (sys.tick < tick) {
+        ticks = (tick - sys.tick);
+        idle_ticks = timer_idle_ticks_isr();
+
+        if (idle_ticks >= ticks) {
+            sys.tick += ticks;
+            time_tick_n(ticks);
+            timer_skip_isr(ticks);
+            break;
+        }
+
+        /* Skip idle ticks and process the next tick with expiring
+           timers. */
+        sys.tick += (idle_ticks + 1);
+        time_tick_n(idle_ticks + 1);
+        timer_skip_isr(idle_ticks);
+        timer_tick_isr();
+    }
+
+    tick_batch_active = 0;
+}
+
+#endif
+
 #include "sys_port.i"
 
 int sys_cmd_info(int argc,
@@ -63,13 +124,22 @@ int sys_module_init(void)
 
 int sys_start(void)
 {
+    trace_module_init();
     setting_module_init();
     std_module_init();
     log_module_init();
     sem_module_init();
+    mutex_module_init();
+    pool_module_init();
+    mailbox_module_init();
     chan_module_init();
     thrd_module_init();
+    workq_module_init();
+    task_module_init();
     sys_port_module_init();
+#if THRD_NCPUS > 1
+    thrd_start_cpus();
+#endif
 
     return (0);
 }
@@ -89,26 +159,296 @@ chan_t *sys_get_stdout(void)
     return (sys.std_out_p);
 }
 
-void sys_lock(void)
+sys_tick_t sys_get_tick(void)
+{
+    sys_tick_t tick;
+
+    sys_lock();
+    tick = sys_get_tick_isr();
+    sys_unlock();
+
+    return (tick);
+}
+
+sys_tick_t sys_get_tick_isr(void)
+{
+#if defined(SYS_PORT_TICKLESS)
+    sys_port_tickless_catch_up_isr();
+#endif
+
+    return (sys.tick);
+}
+
+#if defined(SYS_LOCK_PROFILE)
+
+/* Statistics of a call site of the system lock. */
+struct sys_lock_site_t {
+    const char *file_p;
+    int line;
+    uint32_t count;
+    uint32_t contended;
+    uint32_t max_ns;
+    uint32_t histogram[SYS_LOCK_PROFILE_BUCKETS];
+};
+
+/* Protected by the system lock itself. */
+struct sys_lock_profile_t {
+    /* The last site is shared by all sites not fitting in the
+       table. */
+    struct sys_lock_site_t sites[SYS_LOCK_PROFILE_SITES_MAX + 1];
+    int length;
+    struct sys_lock_site_t *holder_p;
+    uint64_t start_ns;
+};
+
+static struct sys_lock_profile_t lock_profile;
+
+/**
+ * Find given call site, or add it if missing.
+ */
+static struct sys_lock_site_t *lock_site_get(const char *file_p, int line)
+{
+    struct sys_lock_site_t *site_p;
+    int i;
+
+    for (i = 0; i < lock_profile.length; i++) {
+        site_p = &lock_profile.sites[i];
+
+        if ((site_p->line == line) && (site_p->file_p == file_p)) {
+            return (site_p);
+        }
+    }
+
+    if (lock_profile.length == SYS_LOCK_PROFILE_SITES_MAX) {
+        site_p = &lock_profile.sites[SYS_LOCK_PROFILE_SITES_MAX];
+        site_p->file_p = "other";
+
+        return (site_p);
+    }
+
+    site_p = &lock_profile.sites[lock_profile.length];
+    site_p->file_p = file_p;
+    site_p->line = line;
+    lock_profile.length++;
+
+    return (site_p);
+}
+
+/**
+ * Take the system lock, counting it as contended if it is already
+ * taken by another cpu, and make given call site its holder.
+ */
+static void lock_profile_acquire(const char *file_p,
+                                 int line,
+                                 void (*lock)(void))
+{
+    struct sys_lock_site_t *site_p;
+    int contended;
+
+    contended = 0;
+
+#if defined(SYS_PORT_LOCK_TRY)
+    if (sys_port_lock_try() != 0) {
+        contended = 1;
+        lock();
+    }
+#else
+    lock();
+#endif
+
+    site_p = lock_site_get(file_p, line);
+    site_p->count++;
+    site_p->contended += contended;
+    lock_profile.holder_p = site_p;
+    lock_profile.start_ns = time_get_ns();
+}
+
+/**
+ * Add the hold time to the statistics of the holder. Called just
+ * before the system lock is released. The lock is held over context
+ * switches, so the hold time is attributed to the site that took the
+ * lock, not the one releasing it.
+ */
+static void lock_profile_release(void)
+{
+    struct sys_lock_site_t *site_p;
+    uint64_t hold_ns;
+    int bucket;
+
+    site_p = lock_profile.holder_p;
+
+    if (site_p == NULL) {
+        return;
+    }
+
+    hold_ns = (time_get_ns() - lock_profile.start_ns);
+
+    if (hold_ns > 0xffffffff) {
+        hold_ns = 0xffffffff;
+    }
+
+    if (hold_ns > site_p->max_ns) {
+        site_p->max_ns = hold_ns;
+    }
+
+    /* log2 buckets, starting at 64 ns. */
+    bucket = 0;
+    hold_ns >>= 6;
+
+    while ((hold_ns > 0) && (bucket < SYS_LOCK_PROFILE_BUCKETS - 1)) {
+        hold_ns >>= 1;
+        bucket++;
+    }
+
+    site_p->histogram[bucket]++;
+    lock_profile.holder_p = NULL;
+}
+
+/**
+ * Strip the directories from given path.
+ */
+static const char *lock_site_basename(const char *path_p)
+{
+    const char *name_p;
+
+    name_p = path_p;
+
+    while (*path_p != '\0') {
+        if (*path_p == '/') {
+            name_p = (path_p + 1);
+        }
+
+        path_p++;
+    }
+
+    return (name_p);
+}
+
+int sys_cmd_lock_stats_list(int argc,
+                            const char *argv[],
+                            chan_t *out_p,
+                            chan_t *in_p)
+{
+    struct sys_lock_site_t site;
+    int i, j;
+
+    std_fprintf(out_p,
+                FSTR("                          SITE      COUNT  CONTENDED"
+                     "     MAX-NS  HISTOGRAM\r\n"));
+
+    /* Including the overflow site. */
+    for (i = 0; i <= SYS_LOCK_PROFILE_SITES_MAX; i++) {
+        sys_lock();
+        site = lock_profile.sites[i];
+        sys_unlock();
+
+        if (site.count == 0) {
+            continue;
+        }
+
+        std_fprintf(out_p,
+                    FSTR("%25s:%-4d %10lu %10lu %10lu "),
+                    lock_site_basename(site.file_p),
+                    site.line,
+                    (unsigned long)site.count,
+                    (unsigned long)site.contended,
+                    (unsigned long)site.max_ns);
+
+        for (j = 0; j < SYS_LOCK_PROFILE_BUCKETS; j++) {
+            std_fprintf(out_p,
+                        FSTR(" %lu"),
+                        (unsigned long)site.histogram[j]);
+        }
+
+        std_fprintf(out_p, FSTR("\r\n"));
+    }
+
+    return (0);
+}
+
+int sys_cmd_lock_stats_reset(int argc,
+                             const char *argv[],
+                             chan_t *out_p,
+                             chan_t *in_p)
+{
+    return (sys_lock_stats_reset());
+}
+
+void sys_lock_profile(const char *file_p, int line)
+{
+    lock_profile_acquire(file_p, line, sys_port_lock);
+}
+
+void sys_lock_isr_profile(const char *file_p, int line)
+{
+    lock_profile_acquire(file_p, line, sys_port_lock_isr);
+}
+
+int sys_lock_stats_reset(void)
+{
+    const char *file_p;
+    int line;
+
+    sys_lock();
+
+    /* Keep the ongoing hold time of this call. */
+    file_p = lock_profile.holder_p->file_p;
+    line = lock_profile.holder_p->line;
+    memset(&lock_profile.sites[0], 0, sizeof(lock_profile.sites));
+    lock_profile.length = 0;
+    lock_profile.holder_p = lock_site_get(file_p, line);
+
+    sys_unlock();
+
+    return (0);
+}
+
+#endif
+
+/* The parentheses prevent expansion of the profiling macros. */
+void (sys_lock)(void)
 {
     sys_port_lock();
 }
 
 void sys_unlock(void)
 {
+#if defined(SYS_LOCK_PROFILE)
+    lock_profile_release();
+#endif
+
     sys_port_unlock();
 }
 
-void sys_lock_isr(void)
+void (sys_lock_isr)(void)
 {
     sys_port_lock_isr();
 }
 
 void sys_unlock_isr(void)
 {
+#if defined(SYS_LOCK_PROFILE)
+    lock_profile_release();
+#endif
+
     sys_port_unlock_isr();
 }
 
+void sys_object_lock_init(struct sys_object_lock_t *lock_p)
+{
+    sys_port_object_lock_init(lock_p);
+}
+
+void sys_object_lock(struct sys_object_lock_t *lock_p)
+{
+    sys_port_object_lock(lock_p);
+}
+
+void sys_object_unlock(struct sys_object_lock_t *lock_p)
+{
+    sys_port_object_unlock(lock_p);
+}
+
 const FAR char *sys_get_info(void)
 {
     return (sysinfo);
@@ -0,0 +1,320 @@
+/**
+ * @file task.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+/**
+ * Check if given task can run.
+ */
+static int is_ready(struct task_t *task_p, uint32_t tick)
+{
+    switch (task_p->wait) {
+
+    case TASK_WAIT_CHAN:
+        return (chan_size(task_p->u.chan_p) > 0);
+
+    case TASK_WAIT_EVENT:
+        return ((task_p->u.event.event_p->mask & task_p->u.event.mask) != 0);
+
+    case TASK_WAIT_SEM:
+        return (task_p->u.sem.elem.thrd_p == NULL);
+
+    case TASK_WAIT_SLEEP:
+        return ((int32_t)(tick - task_p->u.expiry) >= 0);
+
+    default:
+        return (1);
+    }
+}
+
+/**
+ * Move spawned tasks to the task list.
+ */
+static void add_spawned_tasks(struct task_executor_t *self_p)
+{
+    struct task_t *task_p, *next_p;
+
+    sys_lock();
+    task_p = self_p->spawned_p;
+    self_p->spawned_p = NULL;
+    sys_unlock();
+
+    while (task_p != NULL) {
+        next_p = task_p->next_p;
+        task_p->next_p = self_p->head_p;
+        self_p->head_p = task_p;
+        task_p = next_p;
+    }
+}
+
+/**
+ * Run all tasks that can run, until none can.
+ */
+static void run_ready_tasks(struct task_executor_t *self_p)
+{
+    struct task_t *task_p, **task_pp;
+    uint32_t tick;
+    int ran;
+
+    do {
+        if (self_p->spawned_p != NULL) {
+            add_spawned_tasks(self_p);
+        }
+
+        tick = (uint32_t)sys_get_tick();
+        ran = 0;
+        task_pp = &self_p->head_p;
+
+        while (*task_pp != NULL) {
+            task_p = *task_pp;
+
+            if (is_ready(task_p, tick)) {
+                ran = 1;
+
+                if (task_p->fn(task_p) == TASK_EXITED) {
+                    *task_pp = task_p->next_p;
+                    task_p->executor_p = NULL;
+                    continue;
+                }
+            }
+
+            task_pp = &task_p->next_p;
+        }
+    } while (ran == 1);
+}
+
+/**
+ * Add given channel to the list of polled channels, unless already
+ * added.
+ *
+ * @return zero(0) or negative error code.
+ */
+static int add_chan(struct task_executor_t *self_p, chan_t *chan_p)
+{
+    size_t i;
+
+    for (i = 0; i < self_p->chans.len; i++) {
+        if (self_p->chans.chans_pp[i] == chan_p) {
+            return (0);
+        }
+    }
+
+    return (chan_list_add(&self_p->chans, chan_p));
+}
+
+/**
+ * Suspend the executor thread until a task can run.
+ */
+static void wait_for_ready_task(struct task_executor_t *self_p)
+{
+    struct task_t *task_p;
+    struct time_t timeout, *timeout_p;
+    uint32_t tick, ticks, min;
+    int res;
+
+    res = 0;
+    min = 0xffffffff;
+
+    sys_lock();
+
+    /* Poll the channels the tasks are waiting for. */
+    self_p->chans.len = 0;
+
+    for (task_p = self_p->head_p; task_p != NULL; task_p = task_p->next_p) {
+        if (task_p->wait == TASK_WAIT_CHAN) {
+            res |= add_chan(self_p, task_p->u.chan_p);
+        } else if (task_p->wait == TASK_WAIT_EVENT) {
+            res |= add_chan(self_p, task_p->u.event.event_p);
+        }
+    }
+
+    chan_list_poll_begin_isr(&self_p->chans);
+
+    /* Check all tasks again after polling started, as the thread is
+       not resumed by writes before that. */
+    tick = (uint32_t)sys_get_tick_isr();
+
+    for (task_p = self_p->head_p; task_p != NULL; task_p = task_p->next_p) {
+        if (is_ready(task_p, tick)) {
+            break;
+        }
+
+        if (task_p->wait == TASK_WAIT_SLEEP) {
+            ticks = (task_p->u.expiry - tick);
+
+            if (ticks < min) {
+                min = ticks;
+            }
+        }
+    }
+
+    if ((task_p == NULL) && (self_p->spawned_p == NULL)) {
+        /* Too many channels to poll, check them every tick. */
+        if (res != 0) {
+            min = 1;
+        }
+
+        if (min != 0xffffffff) {
+            st2t(min, &timeout);
+            timeout_p = &timeout;
+        } else {
+            timeout_p = NULL;
+        }
+
+        thrd_suspend_isr(timeout_p);
+    }
+
+    chan_list_poll_end_isr(&self_p->chans);
+
+    sys_unlock();
+}
+
+static void *executor_main(void *arg_p)
+{
+    struct task_executor_t *self_p;
+
+    self_p = arg_p;
+    thrd_set_name("executor");
+
+    sys_lock();
+    self_p->thrd_p = thrd_self();
+    sys_unlock();
+
+    while (1) {
+        run_ready_tasks(self_p);
+        wait_for_ready_task(self_p);
+    }
+
+    return (NULL);
+}
+
+int task_module_init(void)
+{
+    return (0);
+}
+
+int task_executor_init(struct task_executor_t *self_p,
+                       void *workspace_p,
+                       size_t size)
+{
+    self_p->head_p = NULL;
+    self_p->spawned_p = NULL;
+    self_p->thrd_p = NULL;
+
+    return (chan_list_init(&self_p->chans, workspace_p, size));
+}
+
+struct thrd_t *task_executor_start(struct task_executor_t *self_p,
+                                   int prio,
+                                   void *stack_p,
+                                   size_t stack_size)
+{
+    return (thrd_spawn(executor_main,
+                       self_p,
+                       prio,
+                       stack_p,
+                       stack_size));
+}
+
+int task_init(struct task_t *self_p,
+              task_fn_t fn,
+              void *arg_p)
+{
+    self_p->next_p = NULL;
+    self_p->executor_p = NULL;
+    self_p->fn = fn;
+    self_p->arg_p = arg_p;
+    self_p->line = 0;
+    self_p->wait = TASK_WAIT_NONE;
+
+    return (0);
+}
+
+int task_spawn(struct task_t *self_p,
+               struct task_executor_t *executor_p)
+{
+    if (self_p->executor_p != NULL) {
+        return (-EBUSY);
+    }
+
+    self_p->executor_p = executor_p;
+    self_p->line = 0;
+    self_p->wait = TASK_WAIT_NONE;
+
+    sys_lock();
+
+    self_p->next_p = executor_p->spawned_p;
+    executor_p->spawned_p = self_p;
+
+    /* A task spawning a task is already running in the executor
+       thread. */
+    if ((executor_p->thrd_p != NULL) && (executor_p->thrd_p != thrd_self())) {
+        thrd_resume_isr(executor_p->thrd_p, 0);
+    }
+
+    sys_unlock();
+
+    return (0);
+}
+
+int task_await_chan(struct task_t *self_p, chan_t *chan_p)
+{
+    self_p->wait = TASK_WAIT_CHAN;
+    self_p->u.chan_p = chan_p;
+
+    return (0);
+}
+
+int task_await_event(struct task_t *self_p,
+                     struct event_t *event_p,
+                     uint32_t mask)
+{
+    self_p->wait = TASK_WAIT_EVENT;
+    self_p->u.event.event_p = event_p;
+    self_p->u.event.mask = mask;
+
+    return (0);
+}
+
+int task_await_sem(struct task_t *self_p, struct sem_t *sem_p)
+{
+    int res;
+
+    sys_lock();
+    res = sem_wait_isr(sem_p, &self_p->u.sem.elem);
+    sys_unlock();
+
+    if (res == -EAGAIN) {
+        self_p->wait = TASK_WAIT_SEM;
+        self_p->u.sem.sem_p = sem_p;
+
+        return (1);
+    }
+
+    return (0);
+}
+
+int task_await_sleep(struct task_t *self_p, struct time_t *timeout_p)
+{
+    self_p->wait = TASK_WAIT_SLEEP;
+    self_p->u.expiry = ((uint32_t)sys_get_tick() + (uint32_t)t2st(timeout_p));
+
+    return (0);
+}
@@ -35,6 +35,29 @@
 #    define THRD_MONITOR_PRIO -80
 #endif
 
+/* Stacks of dynamically spawned threads are taken from size
+   classes. Class n holds stacks of THRD_DYNAMIC_STACK_MIN << n
+   bytes. */
+#if !defined(THRD_DYNAMIC_STACK_MIN)
+#    define THRD_DYNAMIC_STACK_MIN 256
+#endif
+
+#if !defined(THRD_DYNAMIC_STACK_CLASSES)
+#    define THRD_DYNAMIC_STACK_CLASSES 9
+#endif
+
+/* Size of the static heap dynamic stacks are carved from on ports
+   without a stack allocator. */
+#if !defined(THRD_DYNAMIC_HEAP_SIZE)
+#    define THRD_DYNAMIC_HEAP_SIZE 0
+#endif
+
+/* Maximum total utilization of the EDF threads on a cpu, in
+   percent. */
+#if !defined(THRD_EDF_UTILIZATION_MAX)
+#    define THRD_EDF_UTILIZATION_MAX 100
+#endif
+
 static char *state_fmt[] = {
     "current",
     "ready",
@@ -45,12 +68,50 @@ static char *state_fmt[] = {
 
 FS_COMMAND_DEFINE("/kernel/thrd/list", thrd_cmd_list);
 FS_COMMAND_DEFINE("/kernel/thrd/set_log_mask", thrd_cmd_set_log_mask);
+#if !defined(NTHRDSTATS)
+FS_COMMAND_DEFINE("/kernel/thrd/stats", thrd_cmd_stats);
+#endif
+FS_COMMAND_DEFINE("/kernel/thrd/edf/list", thrd_cmd_edf_list);
 FS_COMMAND_DEFINE("/kernel/thrd/monitor/set_period_ms", thrd_cmd_monitor_set_period_ms);
 FS_COMMAND_DEFINE("/kernel/thrd/monitor/set_print", thrd_cmd_monitor_set_print);
 
-struct thrd_scheduler_t {
+/* Ready queue configuration. Thread priorities [-127..127] are
+   mapped to (256 >> THRD_READY_QUEUE_SHIFT) priority levels. Threads
+   with different priorities sharing a level are kept in priority
+   order within the level. */
+#if !defined(THRD_READY_QUEUE_SHIFT)
+#    define THRD_READY_QUEUE_SHIFT 0
+#endif
+
+#define THRD_READY_QUEUE_LEVELS (256 >> THRD_READY_QUEUE_SHIFT)
+#define THRD_READY_QUEUE_WORDS DIV_CEIL(THRD_READY_QUEUE_LEVELS, 32)
+
+#define PRIO_TO_LEVEL(prio) (((prio) + 128) >> THRD_READY_QUEUE_SHIFT)
+
+/* The ready queue is one circular doubly linked list of threads per
+   priority level, and a bitmap of non-empty levels. EDF threads are
+   kept in a separate list in deadline order, before all levels. */
+struct thrd_ready_queue_t {
+    struct thrd_t *edf_p;
+    uint32_t summary;
+    uint32_t bitmap[THRD_READY_QUEUE_WORDS];
+    struct thrd_t *levels[THRD_READY_QUEUE_LEVELS];
+};
+
+/* Scheduler state of a cpu. */
+struct thrd_cpu_t {
     struct thrd_t *current_p;
-    struct thrd_t *ready_p;
+    struct thrd_ready_queue_t ready;
+    /* Total utilization of the EDF threads, see struct
+       thrd_edf_t. */
+    uint32_t edf_utilization;
+#if THRD_NCPUS > 1
+    struct thrd_t *idle_p;
+#endif
+};
+
+struct thrd_scheduler_t {
+    struct thrd_cpu_t cpus[THRD_NCPUS];
 };
 
 struct monitor_t {
@@ -59,8 +120,14 @@ struct monitor_t {
 };
 
 static volatile struct thrd_scheduler_t scheduler = {
-    .current_p = NULL,
-    .ready_p = NULL
+    .cpus = {
+        [0] = {
+            .current_p = NULL,
+            .ready = {
+                .summary = 0
+            }
+        }
+    }
 };
 
 static struct monitor_t monitor = {
@@ -68,93 +135,516 @@ static struct monitor_t monitor = {
     .print = 0
 };
 
+/* Index of the cpu executing the caller. */
+#if THRD_NCPUS > 1
+#    define CPU_SELF() thrd_port_cpu_self()
+#else
+#    define CPU_SELF() 0
+#endif
+
 /* Forward declarations for thrd_port. */
 static void scheduler_ready_push(struct thrd_t *thrd_p);
+#if !defined(NTHRDSTATS)
+static void stats_wakeup(struct thrd_t *thrd_p);
+#endif
 static void thrd_reschedule(void);
 static void terminate(void);
 
 #include "thrd_port.i"
 
 /* Stacks. */
-static THRD_STACK(idle_thrd_stack, THRD_IDLE_STACK_MAX);
+static THRD_STACK(idle_thrd_stacks[THRD_NCPUS], THRD_IDLE_STACK_MAX);
 static THRD_STACK(monitor_thrd_stack, THRD_MONITOR_STACK_MAX);
 
+/* Stacks of dynamically spawned threads. Free stacks are linked
+   through their threads' next_p pointers. */
+struct thrd_dynamic_t {
+    struct thrd_t *free_p[THRD_DYNAMIC_STACK_CLASSES];
+    struct thrd_t *terminated_p;
+#if !defined(THRD_PORT_STACK_ALLOC)
+    size_t heap_used;
+#endif
+};
+
+static struct thrd_dynamic_t dynamic;
+
+#if !defined(THRD_PORT_STACK_ALLOC) && (THRD_DYNAMIC_HEAP_SIZE > 0)
+static uint64_t dynamic_heap[THRD_DYNAMIC_HEAP_SIZE / sizeof(uint64_t)];
+#endif
+
+/* A thread waiting in thrd_wait(). */
+struct thrd_join_elem_t {
+    struct thrd_join_elem_t *next_p;
+    struct thrd_join_elem_t *prev_p;
+    struct thrd_t *thrd_p;
+};
+
+/**
+ * Remove given terminated thread from its parent's list of
+ * children. Its children are adopted by the parent. Called with the
+ * system lock taken.
+ */
+static void unlink_from_parent(struct thrd_t *thrd_p)
+{
+    struct thrd_t *parent_p;
+    struct thrd_parent_t *child_p, *elem_p, *prev_p;
+    struct list_sl_iterator_t iter;
+
+    parent_p = thrd_p->parent.thrd_p;
+
+    if (parent_p == NULL) {
+        return;
+    }
+
+    LIST_SL_REMOVE_ELEM(&parent_p->children,
+                        &iter,
+                        &thrd_p->parent,
+                        elem_p,
+                        prev_p);
+
+    while (1) {
+        LIST_SL_REMOVE_HEAD(&thrd_p->children, &child_p);
+
+        if (child_p == NULL) {
+            break;
+        }
+
+        child_p->thrd_p = parent_p;
+        LIST_SL_ADD_TAIL(&parent_p->children, child_p);
+    }
+}
+
 static void terminate(void)
 {
-    /* The thread is terminated. */
+    struct thrd_t *thrd_p;
+    struct thrd_join_elem_t *elem_p;
+
     sys_lock();
-    thrd_self()->state = THRD_STATE_TERMINATED;
+
+    /* The thread is terminated. */
+    thrd_p = thrd_self();
+    thrd_p->state = THRD_STATE_TERMINATED;
+    unlink_from_parent(thrd_p);
+
+    /* Release the utilization of an EDF thread. */
+    if (thrd_p->edf_p != NULL) {
+        scheduler.cpus[thrd_p->edf_p->cpu].edf_utilization -=
+            thrd_p->edf_p->utilization;
+        thrd_p->edf_p = NULL;
+    }
+
+    thrd_p->periodic_p = NULL;
+
+    /* Wake all threads waiting for this thread to terminate. */
+    while (thrd_p->joiners_p != NULL) {
+        elem_p = thrd_p->joiners_p;
+        thrd_p->joiners_p = elem_p->next_p;
+        thrd_resume_isr(elem_p->thrd_p, 0);
+        elem_p->thrd_p = NULL;
+    }
+
+    /* The stack is still in use, so it is recycled by the next
+       dynamic spawn, after this thread has been swapped out. */
+    if (thrd_p->stack.size_class >= 0) {
+        thrd_p->next_p = dynamic.terminated_p;
+        dynamic.terminated_p = thrd_p;
+    }
+
     thrd_reschedule();
     sys_unlock();
 }
 
 /**
- * Push a thread on the list of threads that are ready to be
- * scheduled. The ready list is a linked list with the highest
- * priority thread in the first element. The pushed thread is added
- * _after_ any already pushed threads with the same priority.
+ * Push an EDF thread on given ready queue, after any already pushed
+ * threads with an earlier or the same deadline.
+ */
+static void ready_push_edf(volatile struct thrd_ready_queue_t *ready_p,
+                           struct thrd_t *thrd_p)
+{
+    struct thrd_t *head_p, *prev_p;
+    uint32_t deadline;
+
+    head_p = ready_p->edf_p;
+
+    if (head_p == NULL) {
+        thrd_p->prev_p = thrd_p;
+        thrd_p->next_p = thrd_p;
+        ready_p->edf_p = thrd_p;
+
+        return;
+    }
+
+    /* Find the last thread with an earlier or the same deadline,
+       starting from the tail. */
+    deadline = thrd_p->edf_p->job_deadline;
+    prev_p = head_p->prev_p;
+
+    while ((int32_t)(prev_p->edf_p->job_deadline - deadline) > 0) {
+        if (prev_p == head_p) {
+            /* Insert first. */
+            ready_p->edf_p = thrd_p;
+            prev_p = head_p->prev_p;
+            break;
+        }
+
+        prev_p = prev_p->prev_p;
+    }
+
+    thrd_p->prev_p = prev_p;
+    thrd_p->next_p = prev_p->next_p;
+    prev_p->next_p->prev_p = thrd_p;
+    prev_p->next_p = thrd_p;
+}
+
+/**
+ * Push a thread on given ready queue. The thread is added to the list
+ * of its priority level, _after_ any already pushed threads with the
+ * same priority. Constant time unless threads with different
+ * priorities share a level.
  *
- * @param[in] thrd_p Thread to push to the the ready list.
+ * @param[in] ready_p Ready queue.
+ * @param[in] thrd_p Thread to push to the the ready queue.
  */
-static void scheduler_ready_push(struct thrd_t *thrd_p)
+static void ready_push(volatile struct thrd_ready_queue_t *ready_p,
+                       struct thrd_t *thrd_p)
 {
-    struct thrd_t *ready_p;
+    struct thrd_t *head_p, *prev_p;
+    int level;
 
-    /* Add in prio order, with highest prio first. */
-    ready_p = scheduler.ready_p;
+    if (thrd_p->edf_p != NULL) {
+        ready_push_edf(ready_p, thrd_p);
 
-    while (ready_p != NULL) {
-        if (thrd_p->prio < ready_p->prio) {
-            /* Insert before the 'ready_p' thrd. */
-            if (ready_p->prev_p != NULL) {
-                ready_p->prev_p->next_p = thrd_p;
-            } else {
-                scheduler.ready_p = thrd_p;
-            }
+        return;
+    }
+
+    level = PRIO_TO_LEVEL(thrd_p->prio);
+    head_p = ready_p->levels[level];
+
+    /* Empty level. */
+    if (head_p == NULL) {
+        thrd_p->prev_p = thrd_p;
+        thrd_p->next_p = thrd_p;
+        ready_p->levels[level] = thrd_p;
+        ready_p->bitmap[level / 32] |= (1UL << (level % 32));
+        ready_p->summary |= (1UL << (level / 32));
+
+        return;
+    }
+
+    /* Find the last thread with higher or equal priority, starting
+       from the tail of the level. */
+    prev_p = head_p->prev_p;
+
+    while (prev_p->prio > thrd_p->prio) {
+        if (prev_p == head_p) {
+            /* Insert first in the level. */
+            ready_p->levels[level] = thrd_p;
+            prev_p = head_p->prev_p;
+            break;
+        }
 
-            thrd_p->prev_p = ready_p->prev_p;
-            thrd_p->next_p = ready_p;
-            ready_p->prev_p = thrd_p;
-            return;
+        prev_p = prev_p->prev_p;
+    }
+
+    /* Insert after 'prev_p'. */
+    thrd_p->prev_p = prev_p;
+    thrd_p->next_p = prev_p->next_p;
+    prev_p->next_p->prev_p = thrd_p;
+    prev_p->next_p = thrd_p;
+}
+
+/**
+ * Remove given thread from given ready queue.
+ */
+static void ready_remove(volatile struct thrd_ready_queue_t *ready_p,
+                         struct thrd_t *thrd_p)
+{
+    int level;
+
+    if (thrd_p->edf_p != NULL) {
+        if (thrd_p->next_p == thrd_p) {
+            ready_p->edf_p = NULL;
+        } else {
+            thrd_p->prev_p->next_p = thrd_p->next_p;
+            thrd_p->next_p->prev_p = thrd_p->prev_p;
+
+            if (ready_p->edf_p == thrd_p) {
+                ready_p->edf_p = thrd_p->next_p;
+            }
         }
 
-        /* End of ready list. */
-        if (ready_p->next_p == NULL) {
-            ready_p->next_p = thrd_p;
-            thrd_p->prev_p = ready_p;
-            thrd_p->next_p = NULL;
-            return;
+        thrd_p->prev_p = NULL;
+        thrd_p->next_p = NULL;
+
+        return;
+    }
+
+    level = PRIO_TO_LEVEL(thrd_p->prio);
+
+    if (thrd_p->next_p == thrd_p) {
+        /* Last thread in the level. */
+        ready_p->levels[level] = NULL;
+        ready_p->bitmap[level / 32] &= ~(1UL << (level % 32));
+
+        if (ready_p->bitmap[level / 32] == 0) {
+            ready_p->summary &= ~(1UL << (level / 32));
         }
+    } else {
+        thrd_p->prev_p->next_p = thrd_p->next_p;
+        thrd_p->next_p->prev_p = thrd_p->prev_p;
 
-        ready_p = ready_p->next_p;
+        if (ready_p->levels[level] == thrd_p) {
+            ready_p->levels[level] = thrd_p->next_p;
+        }
     }
 
-    /* Empty list. */
-    scheduler.ready_p = thrd_p;
     thrd_p->prev_p = NULL;
     thrd_p->next_p = NULL;
 }
 
 /**
- * Pop the most important thread from the ready list.
+ * Get the most important thread in given non-empty ready queue, which
+ * is the EDF thread with the earliest deadline, or the first thread
+ * in the lowest non-empty level.
+ */
+static struct thrd_t *ready_peek(volatile struct thrd_ready_queue_t *ready_p)
+{
+    int word, level;
+
+    if (ready_p->edf_p != NULL) {
+        return (ready_p->edf_p);
+    }
+
+    word = __builtin_ctzl(ready_p->summary);
+    level = (32 * word + __builtin_ctzl(ready_p->bitmap[word]));
+
+    return (ready_p->levels[level]);
+}
+
+#if THRD_NCPUS > 1
+
+/**
+ * Get the most important thread in given ready queue that may run on
+ * any cpu, or NULL if there is none.
+ */
+static struct thrd_t *ready_peek_any(volatile struct thrd_ready_queue_t *ready_p)
+{
+    struct thrd_t *head_p, *thrd_p;
+    int level;
+
+    for (level = 0; level < THRD_READY_QUEUE_LEVELS; level++) {
+        if ((ready_p->bitmap[level / 32] & (1UL << (level % 32))) == 0) {
+            continue;
+        }
+
+        head_p = ready_p->levels[level];
+        thrd_p = head_p;
+
+        do {
+            if (thrd_p->cpu.affinity == THRD_CPU_ANY) {
+                return (thrd_p);
+            }
+
+            thrd_p = thrd_p->next_p;
+        } while (thrd_p != head_p);
+    }
+
+    return (NULL);
+}
+
+/**
+ * Steal the most important thread that may run on any cpu from the
+ * ready queues of the other cpus.
+ */
+static struct thrd_t *scheduler_steal(int cpu)
+{
+    struct thrd_t *thrd_p, *best_p;
+    int i;
+
+    best_p = NULL;
+
+    for (i = 0; i < THRD_NCPUS; i++) {
+        if ((i == cpu) || (scheduler.cpus[i].ready.summary == 0)) {
+            continue;
+        }
+
+        thrd_p = ready_peek_any(&scheduler.cpus[i].ready);
+
+        if ((thrd_p != NULL)
+            && ((best_p == NULL) || (thrd_p->prio < best_p->prio))) {
+            best_p = thrd_p;
+        }
+    }
+
+    if (best_p != NULL) {
+        ready_remove(&scheduler.cpus[best_p->cpu.index].ready, best_p);
+        best_p->cpu.index = cpu;
+    }
+
+    return (best_p);
+}
+
+/**
+ * Wake given cpu if it is idle.
+ */
+static int scheduler_kick_if_idle(int cpu)
+{
+    if ((scheduler.cpus[cpu].idle_p == NULL)
+        || (scheduler.cpus[cpu].current_p != scheduler.cpus[cpu].idle_p)) {
+        return (0);
+    }
+
+    thrd_port_cpu_kick(cpu);
+
+    return (1);
+}
+
+#endif
+
+/**
+ * Push a thread on the list of threads that are ready to be
+ * scheduled. On SMP the thread is pushed on the ready queue of the
+ * cpu it is bound to, or the cpu it last ran on. An idle cpu is woken
+ * to run or steal the thread.
+ *
+ * @param[in] thrd_p Thread to push to the the ready list.
+ */
+static void scheduler_ready_push(struct thrd_t *thrd_p)
+{
+#if THRD_NCPUS > 1
+    int cpu, i;
+
+    if (thrd_p->cpu.affinity != THRD_CPU_ANY) {
+        thrd_p->cpu.index = thrd_p->cpu.affinity;
+    }
+
+    cpu = thrd_p->cpu.index;
+    ready_push(&scheduler.cpus[cpu].ready, thrd_p);
+
+    /* Idle threads wake themselves. */
+    if (thrd_p == scheduler.cpus[cpu].idle_p) {
+        return;
+    }
+
+    if (scheduler_kick_if_idle(cpu) == 1) {
+        return;
+    }
+
+    if (thrd_p->cpu.affinity == THRD_CPU_ANY) {
+        for (i = 0; i < THRD_NCPUS; i++) {
+            if (scheduler_kick_if_idle(i) == 1) {
+                break;
+            }
+        }
+    }
+#else
+    ready_push(&scheduler.cpus[0].ready, thrd_p);
+#endif
+}
+
+/**
+ * Remove given ready thread from the ready list.
+ */
+static void scheduler_ready_remove(struct thrd_t *thrd_p)
+{
+#if THRD_NCPUS > 1
+    ready_remove(&scheduler.cpus[thrd_p->cpu.index].ready, thrd_p);
+#else
+    ready_remove(&scheduler.cpus[0].ready, thrd_p);
+#endif
+}
+
+/**
+ * Pop the most important thread from the ready list of given cpu. An
+ * otherwise idle cpu steals a thread from the other cpus.
  */
-static struct thrd_t *scheduler_ready_pop(void)
+static struct thrd_t *scheduler_ready_pop(int cpu)
 {
+    volatile struct thrd_ready_queue_t *ready_p;
     struct thrd_t *thrd_p;
 
-    thrd_p = scheduler.ready_p;
-    scheduler.ready_p = thrd_p->next_p;
+    ready_p = &scheduler.cpus[cpu].ready;
+    thrd_p = ready_peek(ready_p);
+
+#if THRD_NCPUS > 1
+    if (thrd_p == scheduler.cpus[cpu].idle_p) {
+        if ((thrd_p = scheduler_steal(cpu)) != NULL) {
+            return (thrd_p);
+        }
 
-    if (scheduler.ready_p != NULL) {
-        scheduler.ready_p->prev_p = NULL;
+        thrd_p = scheduler.cpus[cpu].idle_p;
     }
+#endif
 
-    thrd_p->prev_p = NULL;
-    thrd_p->next_p = NULL;
+    ready_remove(ready_p, thrd_p);
 
     return (thrd_p);
 }
 
+#if !defined(NTHRDSTATS)
+
+static void stats_init(struct thrd_stats_t *stats_p)
+{
+    memset(stats_p, 0, sizeof(*stats_p));
+    stats_p->wait = THRD_WAIT_OTHER;
+}
+
+/**
+ * Start counting the time the current thread is suspended. Called
+ * with the system lock taken.
+ */
+static void stats_suspend(struct thrd_t *thrd_p, int wait)
+{
+    thrd_p->stats.wait = wait;
+    thrd_p->stats.timestamp_ns = time_get_ns();
+}
+
+/**
+ * Add the time suspended to the statistics of given thread, which is
+ * made ready after being suspended. Called with the system lock
+ * taken.
+ */
+static void stats_wakeup(struct thrd_t *thrd_p)
+{
+    struct thrd_stats_t *stats_p;
+    uint64_t now_ns;
+
+    stats_p = &thrd_p->stats;
+    now_ns = time_get_ns();
+    stats_p->blocked_ns[stats_p->wait] += (now_ns - stats_p->timestamp_ns);
+    stats_p->timestamp_ns = now_ns;
+    stats_p->woken = 1;
+}
+
+/**
+ * Add the time from the wakeup to running to the latency histogram
+ * of given thread.
+ */
+static void stats_running(struct thrd_stats_t *stats_p)
+{
+    uint32_t latency_ns;
+    int bucket;
+
+    latency_ns = (time_get_ns() - stats_p->timestamp_ns);
+    stats_p->woken = 0;
+
+    if (latency_ns > stats_p->latency_max_ns) {
+        stats_p->latency_max_ns = latency_ns;
+    }
+
+    bucket = 0;
+    latency_ns /= 1000;
+
+    while ((latency_ns > 0) && (bucket < THRD_STATS_LATENCY_BUCKETS - 1)) {
+        latency_ns >>= 1;
+        bucket++;
+    }
+
+    stats_p->latency[bucket]++;
+}
+
+#endif
+
 /**
  * Perform a rescheduling to let the currently most improtant thread
  * to run.
@@ -165,18 +655,39 @@ static struct thrd_t *scheduler_ready_pop(void)
 static void thrd_reschedule(void)
 {
     struct thrd_t *in_p, *out_p;
+    int cpu;
 
-    out_p = thrd_self();
+    cpu = CPU_SELF();
+    out_p = scheduler.cpus[cpu].current_p;
 
     ASSERTN(out_p->stack_low_magic == THRD_STACK_LOW_MAGIC, ESTACK);
 
-    in_p = scheduler_ready_pop();
+    in_p = scheduler_ready_pop(cpu);
 
     /* Swap threads. */
     in_p->state = THRD_STATE_CURRENT;
 
+#if !defined(NTHRDSTATS)
+    if (in_p->stats.woken == 1) {
+        stats_running(&in_p->stats);
+    }
+#endif
+
     if (in_p != out_p) {
-        scheduler.current_p = in_p;
+        TRACE_EVENT(TRACE_EVENT_THRD_SWITCH, in_p, out_p->state);
+
+#if !defined(NTHRDSTATS)
+        if (out_p->state == THRD_STATE_READY) {
+            out_p->stats.switches_involuntary++;
+        } else {
+            out_p->stats.switches_voluntary++;
+        }
+#endif
+
+#if THRD_NCPUS > 1
+        in_p->cpu.index = cpu;
+#endif
+        scheduler.cpus[cpu].current_p = in_p;
         thrd_port_cpu_usage_stop(out_p);
         thrd_port_swap(in_p, out_p);
         thrd_port_cpu_usage_start(out_p);
@@ -199,23 +710,54 @@ static void thrd_fill_pattern(char *from_p, size_t size)
 static int thrd_get_used_stack(struct thrd_t *thrd_p)
 {
   char *stack_p;
+  char pattern;
   size_t i;
 
-  stack_p = (char *)&thrd_p[1];
+  stack_p = thrd_p->stack.begin_p;
   i = 0;
 
+  /* Dynamic stacks are zeroed instead of filled with a pattern. */
+  pattern = (thrd_p->stack.size_class >= 0 ? 0 : THRD_FILL_PATTERN);
+
   /* Stack grows towards lower memory addresses, so start from the
      bottom.*/
-  while ((i < thrd_p->stack_size) &&
-         (stack_p[i] == THRD_FILL_PATTERN)) {
+  while ((i < thrd_p->stack.size) &&
+         (stack_p[i] == pattern)) {
       i++;
   }
 
-  return (thrd_p->stack_size - i);
+  return (thrd_p->stack.size - i);
 }
 
 #endif
 
+static void thrd_list_periodic(struct thrd_periodic_t *periodic_p,
+                               chan_t *chout_p)
+{
+    uint64_t exec_min_ns, exec_avg_ns;
+
+    exec_min_ns = 0;
+    exec_avg_ns = 0;
+
+    if (periodic_p->jobs > 0) {
+        exec_min_ns = periodic_p->exec_min_ns;
+        exec_avg_ns = (periodic_p->exec_total_ns / periodic_p->jobs);
+    }
+
+    std_fprintf(chout_p,
+                FSTR("%16s period %lu us, jobs %lu, overruns %lu, "
+                     "jitter %lu us, exec %lu/%lu/%lu us\r\n"),
+                "",
+                (unsigned long)(periodic_p->period
+                                * (1000000 / SYS_TICK_FREQUENCY)),
+                (unsigned long)periodic_p->jobs,
+                (unsigned long)periodic_p->overruns,
+                (unsigned long)(periodic_p->jitter_max_ns / 1000),
+                (unsigned long)(exec_min_ns / 1000),
+                (unsigned long)(exec_avg_ns / 1000),
+                (unsigned long)(periodic_p->exec_max_ns / 1000));
+}
+
 static void thrd_list_thrd(struct thrd_t *thrd_p, chan_t *chout_p)
 {
     struct thrd_parent_t *child_p;
@@ -234,10 +776,15 @@ static void thrd_list_thrd(struct thrd_t *thrd_p, chan_t *chout_p)
                 (unsigned int)thrd_p->cpu.usage,
 #if !defined(NPROFILESTACK)
                 thrd_get_used_stack(thrd_p),
-                (int)thrd_p->stack_size,
+                (int)thrd_p->stack.size,
 #endif
                 thrd_p->log_mask);
 
+    /* Statistics of a periodic thread on a separate line. */
+    if (thrd_p->periodic_p != NULL) {
+        thrd_list_periodic(thrd_p->periodic_p, chout_p);
+    }
+
     /* Children. */
     LIST_SL_ITERATOR_INIT(&iter, &thrd_p->children);
 
@@ -269,21 +816,140 @@ int thrd_cmd_list(int argc,
     return (0);
 }
 
-static struct thrd_t *get_by_name(struct thrd_t *thrd_p,
-                                  const char *name_p)
+#if !defined(NTHRDSTATS)
+
+static void thrd_stats_thrd(struct thrd_t *thrd_p, chan_t *chout_p)
 {
     struct thrd_parent_t *child_p;
     struct list_sl_iterator_t iter;
+    struct thrd_stats_t stats;
+    int i;
 
-    /* Thread found? */
-    if (strcmp(thrd_p->name_p, name_p) == 0) {
-        return (thrd_p);
-    }
+    sys_lock();
+    stats = thrd_p->stats;
+    sys_unlock();
 
-    /* Iterate over children. */
-    LIST_SL_ITERATOR_INIT(&iter, &thrd_p->children);
+    std_fprintf(chout_p,
+                FSTR("%16s %10lu %11lu"),
+                thrd_p->name_p,
+                (unsigned long)stats.switches_voluntary,
+                (unsigned long)stats.switches_involuntary);
 
-    thrd_p = NULL;
+    for (i = 0; i < THRD_WAIT_MAX; i++) {
+        std_fprintf(chout_p,
+                    FSTR(" %10lu"),
+                    (unsigned long)(stats.blocked_ns[i] / 1000000));
+    }
+
+    /* Wakeup latency histogram on a separate line. */
+    std_fprintf(chout_p,
+                FSTR("\r\n%16s latency max %lu us, histogram"),
+                "",
+                (unsigned long)(stats.latency_max_ns / 1000));
+
+    for (i = 0; i < THRD_STATS_LATENCY_BUCKETS; i++) {
+        std_fprintf(chout_p,
+                    FSTR(" %lu"),
+                    (unsigned long)stats.latency[i]);
+    }
+
+    std_fprintf(chout_p, FSTR("\r\n"));
+
+    /* Children. */
+    LIST_SL_ITERATOR_INIT(&iter, &thrd_p->children);
+
+    while (1) {
+        LIST_SL_ITERATOR_NEXT(&iter, &child_p);
+
+        if (child_p == NULL) {
+            break;
+        }
+
+        thrd_stats_thrd(container_of(child_p, struct thrd_t, parent), chout_p);
+    }
+}
+
+int thrd_cmd_stats(int argc,
+                   const char *argv[],
+                   chan_t *chout,
+                   chan_t *chin,
+                   char *name)
+{
+    std_fprintf(chout,
+                FSTR("            NAME  VOLUNTARY INVOLUNTARY"
+                     "   QUEUE-MS     SEM-MS   EVENT-MS   MUTEX-MS"
+                     "   SLEEP-MS   OTHER-MS\r\n"));
+    thrd_stats_thrd(&main_thrd, chout);
+
+    return (0);
+}
+
+#endif
+
+static void thrd_edf_list_thrd(struct thrd_t *thrd_p, chan_t *chout_p)
+{
+    struct thrd_parent_t *child_p;
+    struct list_sl_iterator_t iter;
+    struct thrd_edf_t *edf_p;
+
+    edf_p = thrd_p->edf_p;
+
+    if (edf_p != NULL) {
+        std_fprintf(chout_p,
+                    FSTR("%16s %4d %9lu %11lu %5lu%% %10lu %10lu\r\n"),
+                    thrd_p->name_p,
+                    edf_p->cpu,
+                    (unsigned long)(edf_p->period * 1000 / SYS_TICK_FREQUENCY),
+                    (unsigned long)(edf_p->deadline * 1000 / SYS_TICK_FREQUENCY),
+                    (unsigned long)((edf_p->utilization * 100 + 32768) >> 16),
+                    (unsigned long)edf_p->jobs,
+                    (unsigned long)edf_p->misses);
+    }
+
+    /* Children. */
+    LIST_SL_ITERATOR_INIT(&iter, &thrd_p->children);
+
+    while (1) {
+        LIST_SL_ITERATOR_NEXT(&iter, &child_p);
+
+        if (child_p == NULL) {
+            break;
+        }
+
+        thrd_edf_list_thrd(container_of(child_p, struct thrd_t, parent),
+                           chout_p);
+    }
+}
+
+int thrd_cmd_edf_list(int argc,
+                      const char *argv[],
+                      chan_t *chout,
+                      chan_t *chin,
+                      char *name)
+{
+    std_fprintf(chout,
+                FSTR("            NAME  CPU PERIOD-MS DEADLINE-MS  UTIL"
+                     "       JOBS     MISSES\r\n"));
+    thrd_edf_list_thrd(&main_thrd, chout);
+
+    return (0);
+}
+
+static struct thrd_t *get_by_name(struct thrd_t *thrd_p,
+                                  const char *name_p)
+{
+    struct thrd_parent_t *child_p;
+    struct list_sl_iterator_t iter;
+
+    /* Thread found? */
+    if (strcmp(thrd_p->name_p, name_p) == 0) {
+        return (thrd_p);
+    }
+
+    /* Iterate over children. */
+    LIST_SL_ITERATOR_INIT(&iter, &thrd_p->children);
+
+    thrd_p = NULL;
 
     while (thrd_p == NULL) {
         LIST_SL_ITERATOR_NEXT(&iter, &child_p);
@@ -433,11 +1099,24 @@ static void *monitor_thrd(void *arg_p)
 {
     int print;
     float irq_usage;
+    long period_us;
+    struct time_t period;
+    struct thrd_periodic_t periodic;
 
     thrd_set_name("monitor");
 
+    period_us = -1;
+
     while (1) {
-        thrd_usleep(monitor.period_us);
+        /* The new period is used when the current period ends. */
+        if (monitor.period_us != period_us) {
+            period_us = monitor.period_us;
+            period.seconds = (period_us / 1000000);
+            period.nanoseconds = (1000 * (period_us % 1000000));
+            thrd_periodic_start(&periodic, &period);
+        }
+
+        thrd_periodic_wait();
         print = monitor.print;
 
         if (print == 1) {
@@ -459,6 +1138,10 @@ int thrd_module_init(void)
 #if !defined(NPROFILESTACK)
     char dummy = 0;
 #endif
+#if THRD_NCPUS > 1
+    struct thrd_t *thrd_p;
+    int i;
+#endif
 
     /* Main function becomes a thrd. */
     main_thrd.prev_p = NULL;
@@ -470,19 +1153,62 @@ int thrd_module_init(void)
     main_thrd.name_p = "main";
     main_thrd.parent.thrd_p = NULL;
     LIST_SL_INIT(&main_thrd.children);
+    main_thrd.joiners_p = NULL;
+    main_thrd.pi.prio = 0;
+    main_thrd.pi.owned_p = NULL;
+    main_thrd.pi.waiting_p = NULL;
+    main_thrd.edf_p = NULL;
+    main_thrd.periodic_p = NULL;
+#if !defined(NTHRDSTATS)
+    stats_init(&main_thrd.stats);
+#endif
     main_thrd.cpu.usage = 0;
+    main_thrd.stack.begin_p = (char *)(&main_thrd + 1);
+    main_thrd.stack.size = 0;
+    main_thrd.stack.size_class = -1;
+#if THRD_NCPUS > 1
+    main_thrd.cpu.index = 0;
+    main_thrd.cpu.affinity = THRD_CPU_ANY;
+#endif
 #if !defined(NASSERT)
     main_thrd.stack_low_magic = THRD_STACK_LOW_MAGIC;
 #endif
 #if !defined(NPROFILESTACK)
-    main_thrd.stack_size = (&__main_stack_end - (char *)(&main_thrd + 1));
+    main_thrd.stack.size = (&__main_stack_end - (char *)(&main_thrd + 1));
     thrd_fill_pattern((char *)(&main_thrd + 1),
                       &dummy - (char *)(&main_thrd + 2));
 #endif
     thrd_port_init_main(&main_thrd.port);
-    scheduler.current_p = &main_thrd;
+    scheduler.cpus[0].current_p = &main_thrd;
+
+#if THRD_NCPUS > 1
+    /* One idle thread per cpu, bound to the cpu. */
+    for (i = 0; i < THRD_NCPUS; i++) {
+        thrd_p = thrd_spawn(idle_thrd,
+                            NULL,
+                            127,
+                            idle_thrd_stacks[i],
+                            sizeof(idle_thrd_stacks[i]));
+        sys_lock();
+        scheduler_ready_remove(thrd_p);
+        thrd_p->cpu.index = i;
+        thrd_p->cpu.affinity = i;
+        scheduler.cpus[i].idle_p = thrd_p;
+
+        if (i == 0) {
+            scheduler_ready_push(thrd_p);
+        }
 
-    thrd_spawn(idle_thrd, NULL, 127, idle_thrd_stack, sizeof(idle_thrd_stack));
+        sys_unlock();
+    }
+
+#else
+    thrd_spawn(idle_thrd,
+               NULL,
+               127,
+               idle_thrd_stacks[0],
+               sizeof(idle_thrd_stacks[0]));
+#endif
     thrd_spawn(monitor_thrd,
                NULL,
                THRD_MONITOR_PRIO,
@@ -492,17 +1218,20 @@ int thrd_module_init(void)
     return (0);
 }
 
-struct thrd_t *thrd_spawn(void *(*entry)(void *),
-                          void *arg_p,
-                          int prio,
-                          void *stack_p,
-                          size_t stack_size)
+/**
+ * Initialize given thread, located outside given stack for dynamic
+ * threads, and make it ready to run.
+ */
+static int spawn(struct thrd_t *thrd_p,
+                 void *(*entry)(void *),
+                 void *arg_p,
+                 int prio,
+                 char *stack_p,
+                 size_t stack_size,
+                 int size_class)
 {
-    struct thrd_t *thrd_p;
-    int err = 0;
+    int err;
 
-    /* Initialize thrd structure in the beginning of the stack. */
-    thrd_p = stack_p;
     thrd_p->prev_p = NULL;
     thrd_p->next_p = NULL;
     thrd_p->prio = prio;
@@ -512,23 +1241,204 @@ struct thrd_t *thrd_spawn(void *(*entry)(void *),
     thrd_p->name_p = "";
     thrd_p->parent.thrd_p = thrd_self();
     LIST_SL_INIT(&thrd_p->children);
+    thrd_p->joiners_p = NULL;
+    thrd_p->pi.prio = prio;
+    thrd_p->pi.owned_p = NULL;
+    thrd_p->pi.waiting_p = NULL;
+    thrd_p->edf_p = NULL;
+    thrd_p->periodic_p = NULL;
+#if !defined(NTHRDSTATS)
+    stats_init(&thrd_p->stats);
+#endif
     thrd_p->cpu.usage = 0.0f;
+#if THRD_NCPUS > 1
+    thrd_p->cpu.index = CPU_SELF();
+    thrd_p->cpu.affinity = THRD_CPU_ANY;
+#endif
+    thrd_p->stack.begin_p = stack_p;
+    thrd_p->stack.size = stack_size;
+    thrd_p->stack.size_class = size_class;
 #if !defined(NASSERT)
     thrd_p->stack_low_magic = THRD_STACK_LOW_MAGIC;
 #endif
 #if !defined(NPROFILESTACK)
-    thrd_p->stack_size = (stack_size - sizeof(*thrd_p));
-    thrd_fill_pattern((char *)(thrd_p + 1), thrd_p->stack_size);
+    /* Dynamic stacks are already zeroed. */
+    if (size_class < 0) {
+        thrd_fill_pattern(stack_p, stack_size);
+    }
 #endif
-    LIST_SL_ADD_TAIL(&thrd_p->parent.thrd_p->children, &thrd_p->parent);
 
     err = thrd_port_spawn(thrd_p, entry, arg_p, stack_p, stack_size);
 
     sys_lock();
+    LIST_SL_ADD_TAIL(&thrd_p->parent.thrd_p->children, &thrd_p->parent);
     scheduler_ready_push(thrd_p);
     sys_unlock();
 
-    return (err == 0 ? stack_p : NULL);
+    return (err);
+}
+
+/**
+ * Allocate a new dynamic stack of given size. The thread is located
+ * at the bottom of the stack, unless the port decides otherwise.
+ */
+static struct thrd_t *dynamic_stack_alloc(size_t size,
+                                          char **stack_pp,
+                                          size_t *stack_size_p)
+{
+#if defined(THRD_PORT_STACK_ALLOC)
+    return (thrd_port_stack_alloc(size, stack_pp, stack_size_p));
+#elif THRD_DYNAMIC_HEAP_SIZE > 0
+    struct thrd_t *thrd_p;
+    size_t total;
+
+    total = (DIV_CEIL(sizeof(*thrd_p) + size, sizeof(uint64_t))
+             * sizeof(uint64_t));
+
+    sys_lock();
+
+    if ((dynamic.heap_used + total) > sizeof(dynamic_heap)) {
+        thrd_p = NULL;
+    } else {
+        thrd_p = (struct thrd_t *)((char *)dynamic_heap + dynamic.heap_used);
+        dynamic.heap_used += total;
+    }
+
+    sys_unlock();
+
+    if (thrd_p != NULL) {
+        *stack_pp = (char *)(thrd_p + 1);
+        *stack_size_p = (total - sizeof(*thrd_p));
+    }
+
+    return (thrd_p);
+#else
+    return (NULL);
+#endif
+}
+
+#if !defined(NPROFILESTACK)
+
+/**
+ * Zero the used part of the stack of given terminated thread, as the
+ * stack usage measurement expects unused dynamic stack to be zero.
+ */
+static void dynamic_stack_reset(struct thrd_t *thrd_p)
+{
+#if defined(THRD_PORT_STACK_ALLOC)
+    thrd_port_stack_reset(thrd_p);
+#else
+    size_t used;
+
+    used = thrd_get_used_stack(thrd_p);
+    memset(thrd_p->stack.begin_p + thrd_p->stack.size - used, 0, used);
+#endif
+}
+
+#endif
+
+/**
+ * Move the stacks of all terminated dynamic threads to the free
+ * lists of their size classes.
+ */
+static void dynamic_recycle(void)
+{
+    struct thrd_t *thrd_p;
+    struct thrd_t *next_p;
+
+    sys_lock();
+    thrd_p = dynamic.terminated_p;
+    dynamic.terminated_p = NULL;
+    sys_unlock();
+
+    while (thrd_p != NULL) {
+        next_p = thrd_p->next_p;
+#if !defined(NPROFILESTACK)
+        dynamic_stack_reset(thrd_p);
+#endif
+
+        sys_lock();
+        thrd_p->next_p = dynamic.free_p[thrd_p->stack.size_class];
+        dynamic.free_p[thrd_p->stack.size_class] = thrd_p;
+        sys_unlock();
+
+        thrd_p = next_p;
+    }
+}
+
+struct thrd_t *thrd_spawn(void *(*entry)(void *),
+                          void *arg_p,
+                          int prio,
+                          void *stack_p,
+                          size_t stack_size)
+{
+    struct thrd_t *thrd_p;
+    int err;
+
+    /* Initialize thrd structure in the beginning of the stack. */
+    thrd_p = stack_p;
+    err = spawn(thrd_p,
+                entry,
+                arg_p,
+                prio,
+                (char *)(thrd_p + 1),
+                stack_size - sizeof(*thrd_p),
+                -1);
+
+    return (err == 0 ? thrd_p : NULL);
+}
+
+struct thrd_t *thrd_spawn_dynamic(void *(*entry)(void *),
+                                  void *arg_p,
+                                  int prio,
+                                  size_t stack_size)
+{
+    struct thrd_t *thrd_p;
+    char *stack_p;
+    size_t size;
+    int size_class;
+
+    size = THRD_DYNAMIC_STACK_MIN;
+
+    for (size_class = 0; size_class < THRD_DYNAMIC_STACK_CLASSES; size_class++) {
+        if (stack_size <= size) {
+            break;
+        }
+
+        size <<= 1;
+    }
+
+    if (size_class == THRD_DYNAMIC_STACK_CLASSES) {
+        return (NULL);
+    }
+
+    dynamic_recycle();
+
+    sys_lock();
+    thrd_p = dynamic.free_p[size_class];
+
+    if (thrd_p != NULL) {
+        dynamic.free_p[size_class] = thrd_p->next_p;
+    }
+
+    sys_unlock();
+
+    if (thrd_p != NULL) {
+        stack_p = thrd_p->stack.begin_p;
+        size = thrd_p->stack.size;
+    } else {
+        thrd_p = dynamic_stack_alloc(size, &stack_p, &size);
+
+        if (thrd_p == NULL) {
+            return (NULL);
+        }
+    }
+
+    if (spawn(thrd_p, entry, arg_p, prio, stack_p, size, size_class) != 0) {
+        return (NULL);
+    }
+
+    return (thrd_p);
 }
 
 int thrd_suspend(struct time_t *timeout_p)
@@ -553,10 +1463,15 @@ int thrd_resume(struct thrd_t *thrd_p, int err)
 
 int thrd_resume_isr(struct thrd_t *thrd_p, int err)
 {
+    TRACE_EVENT(TRACE_EVENT_THRD_RESUME, thrd_p, thrd_p->state);
+
     thrd_p->err = err;
 
     if (thrd_p->state == THRD_STATE_SUSPENDED) {
         thrd_p->state = THRD_STATE_READY;
+#if !defined(NTHRDSTATS)
+        stats_wakeup(thrd_p);
+#endif
         scheduler_ready_push(thrd_p);
     } else if (thrd_p->state != THRD_STATE_TERMINATED) {
         thrd_p->state = THRD_STATE_RESUMED;
@@ -565,24 +1480,412 @@ int thrd_resume_isr(struct thrd_t *thrd_p, int err)
     return (0);
 }
 
-int thrd_wait(struct thrd_t *thrd_p)
+int thrd_yield(void)
 {
-    while (1) {
+    struct thrd_t *thrd_p;
+
+    sys_lock();
+    thrd_p = thrd_self();
+    thrd_p->state = THRD_STATE_READY;
+    scheduler_ready_push(thrd_p);
+    thrd_reschedule();
+    sys_unlock();
+
+    return (0);
+}
+
+#if THRD_NCPUS > 1
+
+/**
+ * Start the other cpus by running their idle threads. Called by
+ * sys_start() when the system is initialized.
+ */
+void thrd_start_cpus(void)
+{
+    struct thrd_t *thrd_p;
+    int i;
+
+    for (i = 1; i < THRD_NCPUS; i++) {
         sys_lock();
+        thrd_p = scheduler.cpus[i].idle_p;
+        thrd_p->state = THRD_STATE_CURRENT;
+        scheduler.cpus[i].current_p = thrd_p;
 
-        if (thrd_p->state == THRD_STATE_TERMINATED) {
-            sys_unlock();
-            break;
+        /* The system lock is released by the started thread. */
+        thrd_port_cpu_start(thrd_p);
+    }
+}
+
+#endif
+
+int thrd_set_cpu(struct thrd_t *thrd_p, int cpu)
+{
+    if ((cpu < THRD_CPU_ANY) || (cpu >= THRD_NCPUS)) {
+        return (-EINVAL);
+    }
+
+#if THRD_NCPUS > 1
+    sys_lock();
+
+    /* EDF threads are bound to the cpu they were admitted on. */
+    if (thrd_p->edf_p != NULL) {
+        sys_unlock();
+
+        return (-EBUSY);
+    }
+
+    thrd_p->cpu.affinity = cpu;
+
+    if (cpu != THRD_CPU_ANY) {
+        if (thrd_p == thrd_self()) {
+            /* Move the calling thread now. */
+            if (cpu != CPU_SELF()) {
+                thrd_p->state = THRD_STATE_READY;
+                scheduler_ready_push(thrd_p);
+                thrd_reschedule();
+            }
+        } else if ((thrd_p->next_p != NULL) && (thrd_p->cpu.index != cpu)) {
+            /* Move a ready thread to the ready list of given cpu. */
+            scheduler_ready_remove(thrd_p);
+            scheduler_ready_push(thrd_p);
+        }
+    }
+
+    sys_unlock();
+#endif
+
+    return (0);
+}
+
+int thrd_get_cpu(void)
+{
+    return (CPU_SELF());
+}
+
+int thrd_periodic_start(struct thrd_periodic_t *periodic_p,
+                        struct time_t *period_p)
+{
+    uint32_t period;
+
+    period = t2st(period_p);
+
+    if (period == 0) {
+        return (-EINVAL);
+    }
+
+    periodic_p->period = period;
+    periodic_p->jitter_max_ns = 0;
+    periodic_p->exec_min_ns = 0xffffffffffffffffULL;
+    periodic_p->exec_max_ns = 0;
+    periodic_p->exec_total_ns = 0;
+    periodic_p->jobs = 0;
+    periodic_p->overruns = 0;
+
+    sys_lock();
+    periodic_p->release = sys_get_tick_isr();
+    periodic_p->wakeup_ns = time_get_ns();
+    thrd_self()->periodic_p = periodic_p;
+    sys_unlock();
+
+    return (0);
+}
+
+int thrd_periodic_wait(void)
+{
+    struct thrd_periodic_t *periodic_p;
+    struct time_t timeout;
+    uint32_t tick, release;
+    uint64_t now_ns, exec_ns, interval_ns, expected_ns;
+    int err;
+
+    err = 0;
+    now_ns = time_get_ns();
+
+    sys_lock();
+
+    periodic_p = thrd_self()->periodic_p;
+
+    if (periodic_p == NULL) {
+        sys_unlock();
+
+        return (-EINVAL);
+    }
+
+    /* Execution time of the ended job. */
+    exec_ns = (now_ns - periodic_p->wakeup_ns);
+    periodic_p->exec_total_ns += exec_ns;
+    periodic_p->jobs++;
+
+    if (exec_ns < periodic_p->exec_min_ns) {
+        periodic_p->exec_min_ns = exec_ns;
+    }
+
+    if (exec_ns > periodic_p->exec_max_ns) {
+        periodic_p->exec_max_ns = exec_ns;
+    }
+
+    tick = sys_get_tick_isr();
+    release = (periodic_p->release + periodic_p->period);
+
+    if ((int32_t)(tick - release) >= 0) {
+        /* Overrun. Skip missed releases, keeping the phase. */
+        periodic_p->overruns++;
+        release += (((tick - release) / periodic_p->period)
+                    * periodic_p->period);
+        err = -ETIMEDOUT;
+    } else {
+        /* Resumes from other threads are ignored until the
+           release. */
+        do {
+            st2t(release - tick, &timeout);
+            thrd_suspend_on_isr(&timeout, THRD_WAIT_SLEEP);
+            tick = sys_get_tick_isr();
+        } while ((int32_t)(release - tick) > 0);
+    }
+
+    now_ns = time_get_ns();
+
+    /* The first job was not started at a release tick. */
+    if (periodic_p->jobs > 1) {
+        interval_ns = (now_ns - periodic_p->wakeup_ns);
+        expected_ns = ((uint64_t)(release - periodic_p->release)
+                       * 1000000000 / SYS_TICK_FREQUENCY);
+
+        if (interval_ns > expected_ns) {
+            interval_ns -= expected_ns;
+        } else {
+            interval_ns = (expected_ns - interval_ns);
         }
 
+        if (interval_ns > periodic_p->jitter_max_ns) {
+            periodic_p->jitter_max_ns = interval_ns;
+        }
+    }
+
+    periodic_p->release = release;
+    periodic_p->wakeup_ns = now_ns;
+
+    sys_unlock();
+
+    return (err);
+}
+
+int thrd_periodic_stop(void)
+{
+    struct thrd_t *thrd_p;
+
+    thrd_p = thrd_self();
+
+    if (thrd_p->periodic_p == NULL) {
+        return (-EINVAL);
+    }
+
+    sys_lock();
+    thrd_p->periodic_p = NULL;
+    sys_unlock();
+
+    return (0);
+}
+
+/**
+ * Get given time in nanoseconds.
+ */
+static uint64_t time_to_ns(struct time_t *time_p)
+{
+    return ((uint64_t)time_p->seconds * 1000000000 + time_p->nanoseconds);
+}
+
+int thrd_edf_start(struct thrd_edf_t *edf_p,
+                   struct time_t *period_p,
+                   struct time_t *deadline_p,
+                   struct time_t *wcet_p)
+{
+    struct thrd_t *thrd_p;
+    uint64_t period, deadline, utilization;
+    int cpu;
+
+    period = time_to_ns(period_p);
+    deadline = time_to_ns(deadline_p);
+
+    if ((period == 0) || (deadline == 0)) {
+        return (-EINVAL);
+    }
+
+    utilization = ((time_to_ns(wcet_p) << 16) / MIN(period, deadline));
+
+    sys_lock();
+
+    thrd_p = thrd_self();
+    cpu = CPU_SELF();
+
+    if (thrd_p->edf_p != NULL) {
+        sys_unlock();
+
+        return (-EBUSY);
+    }
+
+    /* Admission test. */
+    if ((scheduler.cpus[cpu].edf_utilization + utilization)
+        > ((THRD_EDF_UTILIZATION_MAX << 16) / 100)) {
+        sys_unlock();
+
+        return (-EBUSY);
+    }
+
+    scheduler.cpus[cpu].edf_utilization += utilization;
+
+    edf_p->period = t2st(period_p);
+    edf_p->deadline = t2st(deadline_p);
+    edf_p->utilization = utilization;
+    edf_p->release = sys_get_tick_isr();
+    edf_p->job_deadline = (edf_p->release + edf_p->deadline);
+    edf_p->jobs = 0;
+    edf_p->misses = 0;
+    edf_p->cpu = cpu;
+    thrd_p->edf_p = edf_p;
+#if THRD_NCPUS > 1
+    thrd_p->cpu.affinity = cpu;
+#endif
+
+    sys_unlock();
+
+    return (0);
+}
+
+int thrd_edf_wait(void)
+{
+    struct thrd_t *thrd_p;
+    struct thrd_edf_t *edf_p;
+    struct time_t timeout;
+    uint32_t tick;
+    int missed;
+
+    sys_lock();
+
+    thrd_p = thrd_self();
+    edf_p = thrd_p->edf_p;
+
+    if (edf_p == NULL) {
+        sys_unlock();
+
+        return (-EINVAL);
+    }
+
+    tick = sys_get_tick_isr();
+    edf_p->jobs++;
+    missed = ((int32_t)(tick - edf_p->job_deadline) > 0);
+
+    if (missed) {
+        edf_p->misses++;
+    }
+
+    /* Release the next job. */
+    edf_p->release += edf_p->period;
+    edf_p->job_deadline = (edf_p->release + edf_p->deadline);
+
+    if ((int32_t)(edf_p->release - tick) > 0) {
+        /* Resumes from other threads are ignored until the
+           release. */
+        do {
+            st2t(edf_p->release - tick, &timeout);
+            thrd_suspend_on_isr(&timeout, THRD_WAIT_SLEEP);
+            tick = sys_get_tick_isr();
+        } while ((int32_t)(edf_p->release - tick) > 0);
+    } else {
+        /* Already released. Let threads with earlier deadlines run
+           first. */
+        thrd_p->state = THRD_STATE_READY;
+        scheduler_ready_push(thrd_p);
+        thrd_reschedule();
+    }
+
+    sys_unlock();
+
+    return (missed ? -ETIMEDOUT : 0);
+}
+
+int thrd_edf_stop(void)
+{
+    struct thrd_t *thrd_p;
+
+    sys_lock();
+
+    thrd_p = thrd_self();
+
+    if (thrd_p->edf_p == NULL) {
         sys_unlock();
 
-        thrd_usleep(50000);
+        return (-EINVAL);
     }
 
+    scheduler.cpus[thrd_p->edf_p->cpu].edf_utilization -=
+        thrd_p->edf_p->utilization;
+    thrd_p->edf_p = NULL;
+#if THRD_NCPUS > 1
+    thrd_p->cpu.affinity = THRD_CPU_ANY;
+#endif
+
+    sys_unlock();
+
     return (0);
 }
 
+/**
+ * Change the scheduling priority of given thread. A ready thread is
+ * moved to the ready list of its new priority. Used by the mutex
+ * module for priority inheritance. Called with the system lock taken.
+ */
+void thrd_set_prio_isr(struct thrd_t *thrd_p, int prio)
+{
+    /* Only threads in the ready list are linked. */
+    if (thrd_p->next_p != NULL) {
+        scheduler_ready_remove(thrd_p);
+        thrd_p->prio = prio;
+        scheduler_ready_push(thrd_p);
+    } else {
+        thrd_p->prio = prio;
+    }
+}
+
+int thrd_wait(struct thrd_t *thrd_p,
+              struct time_t *timeout_p)
+{
+    int err = 0;
+    struct thrd_join_elem_t elem;
+
+    sys_lock();
+
+    if (thrd_p->state != THRD_STATE_TERMINATED) {
+        elem.thrd_p = thrd_self();
+        elem.prev_p = NULL;
+        elem.next_p = thrd_p->joiners_p;
+
+        if (elem.next_p != NULL) {
+            elem.next_p->prev_p = &elem;
+        }
+
+        thrd_p->joiners_p = &elem;
+        err = thrd_suspend_isr(timeout_p);
+
+        /* Still waiting if not woken by the terminating thread. */
+        if (elem.thrd_p != NULL) {
+            if (elem.prev_p != NULL) {
+                elem.prev_p->next_p = elem.next_p;
+            } else {
+                thrd_p->joiners_p = elem.next_p;
+            }
+
+            if (elem.next_p != NULL) {
+                elem.next_p->prev_p = elem.prev_p;
+            }
+        }
+    }
+
+    sys_unlock();
+
+    return (err);
+}
+
 int thrd_usleep(long useconds)
 {
     struct time_t timeout;
@@ -590,14 +1893,17 @@ int thrd_usleep(long useconds)
 
     timeout.seconds = (useconds / 1000000);
     timeout.nanoseconds = 1000 * (useconds % 1000000);
-    err = thrd_suspend(&timeout);
+
+    sys_lock();
+    err = thrd_suspend_on_isr(&timeout, THRD_WAIT_SLEEP);
+    sys_unlock();
 
     return (err == -ETIMEDOUT ? 0 : -1);
 }
 
 struct thrd_t *thrd_self(void)
 {
-    return (scheduler.current_p);
+    return (scheduler.cpus[CPU_SELF()].current_p);
 }
 
 int thrd_set_name(const char *name_p)
@@ -619,7 +1925,7 @@ int thrd_set_log_mask(struct thrd_t *thrd_p, int mask)
 
 int thrd_get_log_mask(void)
 {
-    return (scheduler.current_p->log_mask);
+    return (thrd_self()->log_mask);
 }
 
 void thrd_tick(void)
@@ -628,11 +1934,19 @@ void thrd_tick(void)
 }
 
 int thrd_suspend_isr(struct time_t *timeout_p)
+{
+    return (thrd_suspend_on_isr(timeout_p, THRD_WAIT_OTHER));
+}
+
+int thrd_suspend_on_isr(struct time_t *timeout_p, int wait)
 {
     struct thrd_t *thrd_p;
-    struct timer_t timer;
+    struct timer_t timer, *timer_p;
 
     thrd_p = thrd_self();
+    timer_p = NULL;
+
+    TRACE_EVENT(TRACE_EVENT_THRD_SUSPEND, thrd_p, timeout_p != NULL);
 
     /* Immediatly return if the thread is already resumed. */
     if (thrd_p->state == THRD_STATE_RESUMED) {
@@ -643,18 +1957,30 @@ int thrd_suspend_isr(struct time_t *timeout_p)
 
         if (timeout_p != NULL) {
             if ((timeout_p->seconds == 0) && (timeout_p->nanoseconds == 0)) {
+                thrd_p->state = THRD_STATE_CURRENT;
+
                 return (-ETIMEDOUT);
             } else {
-                timer_set_isr(&timer,
+                timer_p = &timer;
+                timer_set_isr(timer_p,
                               timeout_p,
                               thrd_port_suspend_timer_callback,
                               thrd_p,
                               0);
             }
         }
+
+#if !defined(NTHRDSTATS)
+        stats_suspend(thrd_p, wait);
+#endif
     }
 
     thrd_reschedule();
 
+    /* Cancel the timeout timer if resumed before it expired. */
+    if (timer_p != NULL) {
+        timer_cancel_isr(timer_p);
+    }
+
     return (thrd_p->err);
 }
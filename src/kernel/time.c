@@ -57,24 +57,81 @@
 #define DAYS_PER_100Y (365L*100L + 24L)
 #define DAYS_PER_4Y   (365L*4L   + 1L)
 
+/* Length of a system tick is NS_PER_TICK nanoseconds plus
+   NS_PER_TICK_REM / SYS_TICK_FREQUENCY nanoseconds. */
+#define NS_PER_TICK (1000000000UL / SYS_TICK_FREQUENCY)
+#define NS_PER_TICK_REM (1000000000UL % SYS_TICK_FREQUENCY)
+
+/**
+ * The time is kept as the number of nanoseconds since startup at the
+ * latest system tick, and interpolated with the port's tick counter
+ * when read. The state is protected by a sequence lock. It is only
+ * updated with the system lock taken, or in the system tick
+ * interrupt, so readers never take the system lock.
+ */
 struct state_t {
-    uint64_t tick; /* Current tick. 64 bits so it does not wrap around
-                      during the system's uptime. */
-    struct time_t now;
+    volatile uint32_t sequence; /* Odd while the state is updated. */
+    uint64_t tick;              /* Number of ticks since startup. 64
+                                   bits so it does not wrap around
+                                   during the system's uptime. */
+    uint64_t tick_ns;           /* Nanoseconds since startup at the
+                                   latest tick. */
+    uint32_t tick_ns_rem;       /* Fraction of a nanosecond, in units
+                                   of 1 / SYS_TICK_FREQUENCY. */
+    uint64_t offset_ns;         /* Set by time_set(). */
 };
 
 static struct state_t state = {
+    .sequence = 0,
     .tick = 0,
-    .now = { .seconds = 0, .nanoseconds = 0 }
+    .tick_ns = 0,
+    .tick_ns_rem = 0,
+    .offset_ns = 0
 };
 
-static inline void tick_to_time(uint64_t tick,
-                                struct time_t *time_p)
+static inline void state_write_begin(void)
+{
+    state.sequence++;
+    time_port_barrier();
+}
+
+static inline void state_write_end(void)
 {
-    time_p->seconds = (tick / SYS_TICK_FREQUENCY);
-    time_p->nanoseconds =
-        ((1000000000ULL * (tick % SYS_TICK_FREQUENCY))
-         / SYS_TICK_FREQUENCY);
+    time_port_barrier();
+    state.sequence++;
+}
+
+/**
+ * Update the current time after given number of system ticks. Called
+ * from the tick interrupt, so the nanoseconds are accumulated
+ * without 64 bits divisions, except when several ticks are processed
+ * at once.
+ */
+void time_tick_n(uint32_t ticks)
+{
+    uint64_t rem;
+
+    state_write_begin();
+    state.tick += ticks;
+    state.tick_ns += ((uint64_t)ticks * NS_PER_TICK);
+
+    if (NS_PER_TICK_REM != 0) {
+        rem = (state.tick_ns_rem + (uint64_t)ticks * NS_PER_TICK_REM);
+
+        if (rem >= SYS_TICK_FREQUENCY) {
+            if (ticks == 1) {
+                state.tick_ns++;
+                rem -= SYS_TICK_FREQUENCY;
+            } else {
+                state.tick_ns += (rem / SYS_TICK_FREQUENCY);
+                rem %= SYS_TICK_FREQUENCY;
+            }
+        }
+
+        state.tick_ns_rem = rem;
+    }
+
+    state_write_end();
 }
 
 /**
@@ -82,28 +139,49 @@ static inline void tick_to_time(uint64_t tick,
  */
 void time_tick(void)
 {
-    state.tick += 1;
-    tick_to_time(state.tick, &state.now);
+    time_tick_n(1);
+}
+
+uint64_t time_get_ns(void)
+{
+    uint32_t sequence;
+    uint64_t ns;
+
+    do {
+        sequence = state.sequence;
+        time_port_barrier();
+        ns = (state.tick_ns
+              + state.offset_ns
+              + time_port_get_ns_since_tick(state.tick_ns));
+        time_port_barrier();
+    } while ((sequence & 1) || (sequence != state.sequence));
+
+    return (ns);
 }
 
 int time_get(struct time_t *now_p)
 {
-    sys_lock();
-    /* ToDo: Add the time since latest system tick by reading the
-       system tick counter register. */
-    *now_p = state.now;
-    sys_unlock();
+    uint64_t ns;
+
+    ns = time_get_ns();
+    now_p->seconds = (ns / 1000000000ULL);
+    now_p->nanoseconds = (ns % 1000000000ULL);
 
     return (0);
 }
 
 int time_set(struct time_t *new_p)
 {
+    uint64_t ns;
+
+    ns = (1000000000ULL * new_p->seconds + new_p->nanoseconds);
+
     sys_lock();
-    state.tick = ((new_p->seconds * SYS_TICK_FREQUENCY) +
-                  DIV_CEIL((DIV_CEIL(new_p->nanoseconds, 1000)
-                            * SYS_TICK_FREQUENCY), 1000000));
-    tick_to_time(state.tick, &state.now);
+    state_write_begin();
+    state.offset_ns = (ns
+                       - state.tick_ns
+                       - time_port_get_ns_since_tick(state.tick_ns));
+    state_write_end();
     sys_unlock();
 
     return (0);
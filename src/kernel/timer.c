@@ -20,73 +20,129 @@
 
 #include "simba.h"
 
-struct timer_list_t {
-    struct timer_t tail_timer; /* Tail element og timer list.*/
-    struct timer_t *head_p;    /* List of timers sorted by expiry tick.*/
-};
+/* Number of slot index bits per wheel level. */
+#if !defined(TIMER_WHEEL_BITS)
+#    define TIMER_WHEEL_BITS 6
+#endif
+
+/* Number of wheel levels. */
+#if !defined(TIMER_WHEEL_LEVELS)
+#    define TIMER_WHEEL_LEVELS 4
+#endif
+
+#if (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS) > 31
+#    error "The timer wheel range must fit in 31 bits."
+#endif
+
+#define TIMER_WHEEL_SLOTS (1UL << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+/* Largest number of ticks until expiry that fits in the wheel. */
+#define TIMER_WHEEL_TICKS_MAX                                   \
+    ((1UL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
 
-static struct timer_list_t list = {
-    .tail_timer = {
-        .next_p = NULL,
-        .delta = SYS_TICK_MAX,
-        .callback = NULL,
-        .arg_p = NULL
-    },
-    .head_p = &list.tail_timer
+/**
+ * A hierarchical timing wheel. Level zero has one slot per tick,
+ * and each slot on level n covers all slots on level n - 1. A timer
+ * is inserted into the lowest level that covers its expiry tick and
+ * moved (cascaded) down one level each time the level below it wraps
+ * around. Setting and cancelling a timer are O(1) operations.
+ */
+struct timer_wheel_t {
+    uint32_t tick;          /* Next tick to process.*/
+    struct timer_t *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
 };
 
-static void timer_insert(struct timer_t *timer_p)
-{
-    struct timer_t *elem_p, *prev_p;
+static struct timer_wheel_t wheel;
 
-    /* Find element preceeding this timer.*/
-    elem_p = list.head_p;
-    prev_p = NULL;
+static void timer_link(struct timer_t **head_pp,
+                       struct timer_t *timer_p)
+{
+    timer_p->next_p = *head_pp;
 
-    while (elem_p->delta < timer_p->delta) {
-        timer_p->delta -= elem_p->delta;
-        prev_p = elem_p;
-        elem_p = elem_p->next_p;
+    if (timer_p->next_p != NULL) {
+        timer_p->next_p->pprev_p = &timer_p->next_p;
     }
 
-    /* Insert new timer into list.*/
-    if (elem_p != &list.tail_timer) {
-        elem_p->delta -= timer_p->delta;
+    timer_p->pprev_p = head_pp;
+    *head_pp = timer_p;
+}
+
+static void timer_unlink(struct timer_t *timer_p)
+{
+    *timer_p->pprev_p = timer_p->next_p;
+
+    if (timer_p->next_p != NULL) {
+        timer_p->next_p->pprev_p = timer_p->pprev_p;
     }
 
-    timer_p->next_p = elem_p;
+    timer_p->pprev_p = NULL;
+}
+
+/**
+ * Move all timers in given slot to given list head.
+ */
+static void timer_detach(struct timer_t **slot_pp,
+                         struct timer_t **head_pp)
+{
+    *head_pp = *slot_pp;
+    *slot_pp = NULL;
 
-    if (prev_p != NULL) {
-        prev_p->next_p = timer_p;
-    } else {
-        list.head_p = timer_p;
+    if (*head_pp != NULL) {
+        (*head_pp)->pprev_p = head_pp;
     }
 }
 
-static int timer_remove(struct timer_t *timer_p)
+static void timer_insert(struct timer_t *timer_p)
 {
-    struct timer_t *elem_p, *prev_p;
-
-    /* Find element preceeding this timer.*/
-    elem_p = list.head_p;
-    prev_p = NULL;
-
-    while (elem_p != NULL) {
-        if (elem_p == timer_p) {
-            if (prev_p != NULL) {
-                prev_p->next_p = elem_p->next_p;
-            } else {
-                list.head_p = elem_p->next_p;
-            }
+    uint32_t ticks;
+    int level;
+
+    ticks = (timer_p->expiry - wheel.tick);
+
+    if ((int32_t)ticks < 0) {
+        /* Already expired, fire in the next tick. */
+        ticks = 0;
+    } else if (ticks > TIMER_WHEEL_TICKS_MAX) {
+        /* Timers too far into the future are put in the last slot of
+           the highest level and re-inserted when cascaded. */
+        ticks = TIMER_WHEEL_TICKS_MAX;
+    }
 
-            return (0);
+    for (level = 0; level < TIMER_WHEEL_LEVELS - 1; level++) {
+        if (ticks < (1UL << (TIMER_WHEEL_BITS * (level + 1)))) {
+            break;
         }
+    }
+
+    timer_link(&wheel.slots[level][((wheel.tick + ticks)
+                                    >> (TIMER_WHEEL_BITS * level))
+                                   & TIMER_WHEEL_MASK],
+               timer_p);
+}
+
+/**
+ * Re-insert all timers in the current slot of given level into lower
+ * levels.
+ *
+ * @return Index of the cascaded slot.
+ */
+static int timer_cascade(int level)
+{
+    struct timer_t *head_p;
+    struct timer_t *timer_p;
+    int index;
+
+    index = ((wheel.tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+    timer_detach(&wheel.slots[level][index], &head_p);
 
-        prev_p = elem_p;
-        elem_p = elem_p->next_p;
+    while (head_p != NULL) {
+        timer_p = head_p;
+        timer_unlink(timer_p);
+        timer_insert(timer_p);
     }
 
-    return (-1);
+    return (index);
 }
 
 int timer_module_init(void)
@@ -94,36 +150,116 @@ int timer_module_init(void)
     return (0);
 }
 
-void timer_tick(void)
+/**
+ * Process one tick. Called with the system lock taken.
+ */
+void timer_tick_isr(void)
 {
+    struct timer_t *expired_p;
     struct timer_t *timer_p;
+    int index;
+    int level;
 
-    sys_lock_isr();
+    TRACE_EVENT(TRACE_EVENT_TIMER_TICK, NULL, 0);
+
+    /* Cascade timers from higher levels when the level below wraps
+       around. */
+    index = (wheel.tick & TIMER_WHEEL_MASK);
 
-    /* Return if no timers are active.*/
-    if (list.head_p == &list.tail_timer) {
-        goto out;
+    if (index == 0) {
+        for (level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if (timer_cascade(level) != 0) {
+                break;
+            }
+        }
     }
 
-    /* Fire all expired timers.*/
-    list.head_p->delta--;
+    wheel.tick++;
+
+    /* Fire all expired timers. A callback may cancel other expired
+       timers, so they are kept in a list that timer_unlink()
+       updates. */
+    timer_detach(&wheel.slots[0][index], &expired_p);
 
-    while (list.head_p->delta == 0) {
-        timer_p = list.head_p;
-        list.head_p = timer_p->next_p;
+    while (expired_p != NULL) {
+        timer_p = expired_p;
+        timer_unlink(timer_p);
         timer_p->callback(timer_p->arg_p);
 
         /* Re-set periodic timers. */
-        if (timer_p->flags & TIMER_PERIODIC) {
-            timer_p->delta = timer_p->timeout;
+        if ((timer_p->flags & TIMER_PERIODIC)
+            && (timer_p->pprev_p == NULL)) {
+            timer_p->expiry += timer_p->timeout;
             timer_insert(timer_p);
         }
     }
+}
 
- out:
+void timer_tick(void)
+{
+    sys_lock_isr();
+    timer_tick_isr();
     sys_unlock_isr();
 }
 
+/**
+ * Get the number of upcoming ticks in which nothing happens, that
+ * is, no timer expires and no non-empty slot is cascaded. Called
+ * with the system lock taken.
+ *
+ * @return Number of ticks, or 0xffffffff if no timer is set.
+ */
+uint32_t timer_idle_ticks_isr(void)
+{
+    uint32_t ticks;
+    uint32_t first;
+    uint32_t idle_ticks;
+    int level;
+    int i;
+
+    idle_ticks = 0xffffffffUL;
+
+    /* Expiring timers on the lowest level. */
+    for (ticks = 0; ticks < TIMER_WHEEL_SLOTS; ticks++) {
+        if (wheel.slots[0][(wheel.tick + ticks) & TIMER_WHEEL_MASK] != NULL) {
+            idle_ticks = ticks;
+            break;
+        }
+    }
+
+    /* Cascades of higher levels, which happen when all lower levels
+       wrap around. */
+    for (level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        first = ((wheel.tick + (1UL << (TIMER_WHEEL_BITS * level)) - 1)
+                 & ~((1UL << (TIMER_WHEEL_BITS * level)) - 1));
+
+        for (i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+            ticks = (first + ((uint32_t)i << (TIMER_WHEEL_BITS * level)));
+
+            if ((ticks - wheel.tick) >= idle_ticks) {
+                break;
+            }
+
+            if (wheel.slots[level][(ticks >> (TIMER_WHEEL_BITS * level))
+                                   & TIMER_WHEEL_MASK] != NULL) {
+                idle_ticks = (ticks - wheel.tick);
+                break;
+            }
+        }
+    }
+
+    return (idle_ticks);
+}
+
+/**
+ * Skip given number of ticks in which nothing happens, as returned
+ * by `timer_idle_ticks_isr()`. Called with the system lock taken.
+ */
+void timer_skip_isr(uint32_t ticks)
+{
+    wheel.tick += ticks;
+}
+
 int timer_set(struct timer_t *self_p,
               struct time_t *timeout_p,
               void (*callback)(void *arg_p),
@@ -154,25 +290,52 @@ int timer_set_isr(struct timer_t *self_p,
         self_p->timeout = 1;
     }
 
-    self_p->delta = self_p->timeout;
+    /* The wheel counts ticks in 32 bits, and expiries more than 2^31
+       ticks ahead are taken as already passed. */
+    if (self_p->timeout > 0x7fffffffUL) {
+        self_p->timeout = 0x7fffffffUL;
+    }
+
+#if defined(SYS_PORT_TICKLESS)
+    /* The expiry tick is relative to the current tick. */
+    sys_port_tickless_catch_up_isr();
+#endif
+
+    /* The tick being processed when this timer was set has already
+       passed. */
+    self_p->expiry = (wheel.tick + (uint32_t)self_p->timeout - 1);
     self_p->flags = flags;
     self_p->callback = callback;
     self_p->arg_p = arg_p;
 
     timer_insert(self_p);
 
+#if defined(SYS_PORT_TICKLESS)
+    sys_port_tickless_timer_set_isr(self_p->timeout);
+#endif
+
     return (0);
 }
 
 int timer_cancel(struct timer_t *self_p)
 {
-    int err = 0;
+    int err;
 
     sys_lock();
-
-    err = timer_remove(self_p);
-
+    err = timer_cancel_isr(self_p);
     sys_unlock();
 
     return (err);
 }
+
+int timer_cancel_isr(struct timer_t *self_p)
+{
+    /* The timer has already expired or been cancelled. */
+    if (self_p->pprev_p == NULL) {
+        return (-1);
+    }
+
+    timer_unlink(self_p);
+
+    return (0);
+}
@@ -0,0 +1,217 @@
+/**
+ * @file trace.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+#if defined(TRACE)
+
+FS_COMMAND_DEFINE("/kernel/trace/dump", trace_cmd_dump);
+
+static const char *event_fmt[] = {
+    "switch",
+    "suspend",
+    "resume",
+    "queue_read",
+    "queue_write",
+    "sem_get",
+    "sem_put",
+    "timer_tick",
+    "isr"
+};
+
+/* The ring buffer of a cpu. The lock is a leaf lock, never held when
+   another lock is taken, so it may be taken with the system lock or
+   an object lock held. */
+struct trace_ring_t {
+    struct sys_object_lock_t lock;
+    /* Total number of written records. */
+    uint32_t head;
+    struct trace_record_t records[TRACE_RING_LENGTH];
+};
+
+struct trace_t {
+    volatile int enabled;
+    struct trace_ring_t rings[THRD_NCPUS];
+};
+
+static struct trace_t trace;
+
+/**
+ * Print given thread and its children.
+ */
+static void dump_thrd(struct thrd_t *thrd_p, chan_t *chout_p)
+{
+    struct thrd_parent_t *child_p;
+    struct list_sl_iterator_t iter;
+
+    std_fprintf(chout_p,
+                FSTR("thrd 0x%lx %s\r\n"),
+                (unsigned long)(uintptr_t)thrd_p,
+                thrd_p->name_p);
+
+    LIST_SL_ITERATOR_INIT(&iter, &thrd_p->children);
+
+    while (1) {
+        LIST_SL_ITERATOR_NEXT(&iter, &child_p);
+
+        if (child_p == NULL) {
+            break;
+        }
+
+        dump_thrd(container_of(child_p, struct thrd_t, parent), chout_p);
+    }
+}
+
+/**
+ * Print the records in the ring of given cpu, oldest first.
+ */
+static void dump_ring(int cpu, chan_t *chout_p)
+{
+    struct trace_ring_t *ring_p;
+    struct trace_record_t record;
+    uint32_t head, i;
+
+    ring_p = &trace.rings[cpu];
+
+    sys_object_lock(&ring_p->lock);
+    head = ring_p->head;
+    sys_object_unlock(&ring_p->lock);
+
+    i = 0;
+
+    if (head > TRACE_RING_LENGTH) {
+        i = (head - TRACE_RING_LENGTH);
+    }
+
+    std_fprintf(chout_p,
+                FSTR("cpu %d overwritten %lu\r\n"),
+                cpu,
+                (unsigned long)i);
+
+    for (; i < head; i++) {
+        sys_object_lock(&ring_p->lock);
+        record = ring_p->records[i % TRACE_RING_LENGTH];
+        sys_object_unlock(&ring_p->lock);
+
+        std_fprintf(chout_p,
+                    FSTR("%d %lu %s 0x%lx %u\r\n"),
+                    cpu,
+                    (unsigned long)record.time,
+                    event_fmt[record.event],
+                    (unsigned long)record.object,
+                    (unsigned int)record.value);
+    }
+}
+
+int trace_cmd_dump(int argc,
+                   const char *argv[],
+                   chan_t *chout,
+                   chan_t *chin,
+                   char *name)
+{
+    return (trace_dump(chout));
+}
+
+int trace_module_init(void)
+{
+    int i;
+
+    for (i = 0; i < THRD_NCPUS; i++) {
+        sys_object_lock_init(&trace.rings[i].lock);
+        trace.rings[i].head = 0;
+    }
+
+    trace.enabled = 1;
+
+    return (0);
+}
+
+void trace_write(int event, uintptr_t object, uint16_t value)
+{
+    struct trace_ring_t *ring_p;
+    struct trace_record_t *record_p;
+    uint32_t time;
+
+    if (trace.enabled == 0) {
+        return;
+    }
+
+    time = (time_get_ns() / 1000);
+    ring_p = &trace.rings[thrd_get_cpu()];
+
+    sys_object_lock(&ring_p->lock);
+    record_p = &ring_p->records[ring_p->head % TRACE_RING_LENGTH];
+    record_p->time = time;
+    record_p->event = event;
+    record_p->value = value;
+    record_p->object = object;
+    ring_p->head++;
+    sys_object_unlock(&ring_p->lock);
+}
+
+int trace_dump(chan_t *chout_p)
+{
+    struct thrd_t *thrd_p;
+    int cpu;
+
+    /* Printing generates events itself. */
+    trace.enabled = 0;
+
+    std_fprintf(chout_p,
+                FSTR("trace cpus %d\r\n"),
+                THRD_NCPUS);
+
+    /* Thread names of all alive threads. */
+    thrd_p = thrd_self();
+
+    while (thrd_p->parent.thrd_p != NULL) {
+        thrd_p = thrd_p->parent.thrd_p;
+    }
+
+    dump_thrd(thrd_p, chout_p);
+
+    for (cpu = 0; cpu < THRD_NCPUS; cpu++) {
+        dump_ring(cpu, chout_p);
+    }
+
+    std_fprintf(chout_p, FSTR("end\r\n"));
+
+    trace.enabled = 1;
+
+    return (0);
+}
+
+#else
+
+int trace_module_init(void)
+{
+    return (0);
+}
+
+void trace_write(int event, uintptr_t object, uint16_t value)
+{
+}
+
+int trace_dump(chan_t *chout_p)
+{
+    return (-ENOSYS);
+}
+
+#endif
@@ -0,0 +1,381 @@
+/**
+ * @file workq.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+FS_COMMAND_DEFINE("/kernel/workq/list", workq_cmd_list);
+FS_COMMAND_DEFINE("/kernel/workq/reset", workq_cmd_reset);
+
+#define WORK_STATE_IDLE    0
+#define WORK_STATE_PENDING 1
+#define WORK_STATE_DELAYED 2
+
+/* An idle worker thread, kept on the stack of the worker. */
+struct workq_worker_t {
+    struct workq_worker_t *next_p;
+    struct thrd_t *thrd_p;
+};
+
+struct workq_module_t {
+    struct workq_t *head_p;
+};
+
+static struct workq_module_t module = {
+    .head_p = NULL
+};
+
+#if WORKQ_SYSTEM_WORKERS > 0
+static struct workq_t system_workq;
+static THRD_STACK(system_stacks[WORKQ_SYSTEM_WORKERS],
+                  WORKQ_SYSTEM_STACK_SIZE);
+#endif
+
+static void reset_stats_isr(struct workq_t *self_p)
+{
+    self_p->stats.depth_max = self_p->stats.depth;
+    self_p->stats.submitted = 0;
+    self_p->stats.executed = 0;
+    self_p->stats.cancelled = 0;
+    self_p->stats.busy_ns = 0;
+    self_p->stats.start_ns = time_get_ns();
+}
+
+/**
+ * Take the next pending work from given work queue, waiting for one
+ * to be submitted if there is none.
+ */
+static struct work_t *take_work(struct workq_t *self_p)
+{
+    struct work_t *work_p;
+    struct workq_worker_t worker;
+
+    worker.thrd_p = thrd_self();
+
+    sys_lock();
+
+    while (1) {
+        LIST_SL_REMOVE_HEAD(&self_p->pending, &work_p);
+
+        if (work_p != NULL) {
+            break;
+        }
+
+        /* The most recently idle worker is woken first as it is most
+           likely to be cache hot. */
+        worker.next_p = self_p->idle_p;
+        self_p->idle_p = &worker;
+        thrd_suspend_isr(NULL);
+    }
+
+    work_p->state = WORK_STATE_IDLE;
+    self_p->stats.depth--;
+
+    sys_unlock();
+
+    return (work_p);
+}
+
+static void *worker_thrd(void *arg_p)
+{
+    struct workq_t *self_p;
+    struct work_t *work_p;
+    uint64_t start;
+    uint64_t busy;
+
+    self_p = arg_p;
+    thrd_set_name(self_p->name_p);
+
+    while (1) {
+        work_p = take_work(self_p);
+
+        start = time_get_ns();
+        work_p->callback(work_p->arg_p);
+        busy = (time_get_ns() - start);
+
+        sys_lock();
+        self_p->stats.executed++;
+        self_p->stats.busy_ns += busy;
+        sys_unlock();
+    }
+
+    return (NULL);
+}
+
+/**
+ * Delayed work timer expiry callback.
+ */
+static void on_timeout(void *arg_p)
+{
+    struct work_t *self_p;
+
+    self_p = arg_p;
+    self_p->state = WORK_STATE_IDLE;
+    work_submit_isr(self_p);
+}
+
+int workq_cmd_list(int argc,
+                   const char *argv[],
+                   chan_t *chout_p,
+                   chan_t *chin_p)
+{
+    struct workq_t *workq_p;
+    uint64_t capacity;
+    unsigned long usage;
+
+    std_fprintf(chout_p,
+                FSTR("            NAME  WORKERS  PRIO  DEPTH  MAX-DEPTH"
+                     "  SUBMITTED   EXECUTED  CANCELLED  USAGE\r\n"));
+
+    for (workq_p = module.head_p; workq_p != NULL; workq_p = workq_p->next_p) {
+        /* Utilisation is the time spent in work functions relative to
+           the time all workers could have spent since the last
+           reset. */
+        capacity = ((time_get_ns() - workq_p->stats.start_ns)
+                    * workq_p->workers);
+        usage = 0;
+
+        if (capacity > 0) {
+            usage = (unsigned long)((100 * workq_p->stats.busy_ns) / capacity);
+        }
+
+        std_fprintf(chout_p,
+                    FSTR("%16s %8d %5d %6lu %10lu %10lu %10lu %10lu %5lu%%\r\n"),
+                    workq_p->name_p,
+                    workq_p->workers,
+                    workq_p->prio,
+                    workq_p->stats.depth,
+                    workq_p->stats.depth_max,
+                    workq_p->stats.submitted,
+                    workq_p->stats.executed,
+                    workq_p->stats.cancelled,
+                    usage);
+    }
+
+    return (0);
+}
+
+int workq_cmd_reset(int argc,
+                    const char *argv[],
+                    chan_t *chout_p,
+                    chan_t *chin_p)
+{
+    struct workq_t *workq_p;
+
+    sys_lock();
+
+    for (workq_p = module.head_p; workq_p != NULL; workq_p = workq_p->next_p) {
+        reset_stats_isr(workq_p);
+    }
+
+    sys_unlock();
+
+    return (0);
+}
+
+int workq_module_init(void)
+{
+#if WORKQ_SYSTEM_WORKERS > 0
+    return (workq_init(&system_workq,
+                       "workq",
+                       WORKQ_SYSTEM_PRIO,
+                       system_stacks,
+                       sizeof(system_stacks[0]),
+                       WORKQ_SYSTEM_WORKERS));
+#else
+    return (0);
+#endif
+}
+
+int workq_init(struct workq_t *self_p,
+               const char *name_p,
+               int prio,
+               void *stacks_p,
+               size_t stack_size,
+               int workers)
+{
+    int i;
+
+    if (workers < 1) {
+        return (-EINVAL);
+    }
+
+    self_p->name_p = name_p;
+    self_p->prio = prio;
+    self_p->workers = workers;
+    LIST_SL_INIT(&self_p->pending);
+    self_p->idle_p = NULL;
+    self_p->stats.depth = 0;
+    reset_stats_isr(self_p);
+
+    sys_lock();
+    self_p->next_p = module.head_p;
+    module.head_p = self_p;
+    sys_unlock();
+
+    for (i = 0; i < workers; i++) {
+        if (thrd_spawn(worker_thrd,
+                       self_p,
+                       prio,
+                       (char *)stacks_p + i * stack_size,
+                       stack_size) == NULL) {
+            return (-ENOMEM);
+        }
+    }
+
+    return (0);
+}
+
+int work_init(struct work_t *self_p,
+              struct workq_t *workq_p,
+              void (*callback)(void *arg_p),
+              void *arg_p)
+{
+    if (workq_p == NULL) {
+#if WORKQ_SYSTEM_WORKERS > 0
+        workq_p = &system_workq;
+#else
+        return (-EINVAL);
+#endif
+    }
+
+    self_p->next_p = NULL;
+    self_p->workq_p = workq_p;
+    self_p->callback = callback;
+    self_p->arg_p = arg_p;
+    self_p->state = WORK_STATE_IDLE;
+
+    return (0);
+}
+
+int work_submit(struct work_t *self_p)
+{
+    int res;
+
+    sys_lock();
+    res = work_submit_isr(self_p);
+    sys_unlock();
+
+    return (res);
+}
+
+int work_submit_delayed(struct work_t *self_p,
+                        struct time_t *timeout_p)
+{
+    int res;
+
+    sys_lock();
+    res = work_submit_delayed_isr(self_p, timeout_p);
+    sys_unlock();
+
+    return (res);
+}
+
+int work_cancel(struct work_t *self_p)
+{
+    int res;
+
+    sys_lock();
+    res = work_cancel_isr(self_p);
+    sys_unlock();
+
+    return (res);
+}
+
+int work_submit_isr(struct work_t *self_p)
+{
+    struct workq_t *workq_p;
+    struct workq_worker_t *worker_p;
+
+    if (self_p->state != WORK_STATE_IDLE) {
+        return (-EBUSY);
+    }
+
+    workq_p = self_p->workq_p;
+    self_p->state = WORK_STATE_PENDING;
+    LIST_SL_ADD_TAIL(&workq_p->pending, self_p);
+    workq_p->stats.submitted++;
+    workq_p->stats.depth++;
+
+    if (workq_p->stats.depth > workq_p->stats.depth_max) {
+        workq_p->stats.depth_max = workq_p->stats.depth;
+    }
+
+    /* Wake an idle worker, if any. */
+    worker_p = workq_p->idle_p;
+
+    if (worker_p != NULL) {
+        workq_p->idle_p = worker_p->next_p;
+        thrd_resume_isr(worker_p->thrd_p, 0);
+    }
+
+    return (0);
+}
+
+int work_submit_delayed_isr(struct work_t *self_p,
+                            struct time_t *timeout_p)
+{
+    int res;
+
+    if (self_p->state != WORK_STATE_IDLE) {
+        return (-EBUSY);
+    }
+
+    res = timer_set_isr(&self_p->timer, timeout_p, on_timeout, self_p, 0);
+
+    if (res == 0) {
+        self_p->state = WORK_STATE_DELAYED;
+    }
+
+    return (res);
+}
+
+int work_cancel_isr(struct work_t *self_p)
+{
+    struct workq_t *workq_p;
+    struct list_sl_iterator_t iterator;
+    struct work_t *iterator_work_p;
+    struct work_t *previous_work_p;
+
+    workq_p = self_p->workq_p;
+
+    switch (self_p->state) {
+
+    case WORK_STATE_PENDING:
+        LIST_SL_REMOVE_ELEM(&workq_p->pending,
+                            &iterator,
+                            self_p,
+                            iterator_work_p,
+                            previous_work_p);
+        workq_p->stats.depth--;
+        break;
+
+    case WORK_STATE_DELAYED:
+        timer_cancel_isr(&self_p->timer);
+        break;
+
+    default:
+        return (-ENOENT);
+    }
+
+    self_p->state = WORK_STATE_IDLE;
+    workq_p->stats.cancelled++;
+
+    return (0);
+}
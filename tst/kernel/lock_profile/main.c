@@ -0,0 +1,105 @@
+/**
+ * @file main.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+/* Command output is written to a queue, and read into a string. */
+static char capture_buf[4096];
+static QUEUE_INIT_DECL(capture, capture_buf, sizeof(capture_buf));
+static char output[sizeof(capture_buf)];
+
+/**
+ * Read everything written to the capture queue into `output`.
+ */
+static int read_output(void)
+{
+    ssize_t size;
+
+    size = queue_size(&capture);
+    BTASSERT(queue_read(&capture, output, size) == size);
+    output[size] = '\0';
+
+    return (0);
+}
+
+static int test_lock_stats(struct harness_t *harness_p)
+{
+    char buf[32];
+    char *line_p;
+    int line;
+    unsigned long count, contended, max_ns;
+    uint64_t end_ns;
+
+    BTASSERT(sys_lock_stats_reset() == 0);
+
+    /* Hold the lock for at least 2 ms. */
+    sys_lock(); line = __LINE__;
+    end_ns = (time_get_ns() + 2000000);
+
+    while (time_get_ns() < end_ns);
+
+    sys_unlock();
+
+    strcpy(buf, "/kernel/sys/lock_stats/list");
+    BTASSERT(fs_call(buf, NULL, &capture) == 0);
+    BTASSERT(read_output() == 0);
+    std_printf(FSTR("%s"), output);
+
+    /* The hold time is in the last bucket, 1 ms and above. */
+    std_sprintf(buf, FSTR("main.c:%d"), line);
+    line_p = strstr(output, buf);
+    BTASSERT(line_p != NULL);
+    BTASSERT(sscanf(&line_p[strlen(buf)],
+                    "%lu %lu %lu",
+                    &count,
+                    &contended,
+                    &max_ns) == 3);
+    BTASSERT(count == 1);
+    BTASSERT(max_ns >= 2000000);
+    BTASSERT(strstr(line_p, " 0 1\r\n") != NULL);
+
+    strcpy(buf, "/kernel/sys/lock_stats/reset");
+    BTASSERT(fs_call(buf, NULL, NULL) == 0);
+
+    strcpy(buf, "/kernel/sys/lock_stats/list");
+    BTASSERT(fs_call(buf, NULL, &capture) == 0);
+    BTASSERT(read_output() == 0);
+    std_sprintf(buf, FSTR("main.c:%d"), line);
+    BTASSERT(strstr(output, buf) == NULL);
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_t harness;
+    struct harness_testcase_t harness_testcases[] = {
+        { test_lock_stats, "test_lock_stats" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+    uart_module_init();
+
+    harness_init(&harness);
+    harness_run(&harness, harness_testcases);
+
+    return (0);
+}
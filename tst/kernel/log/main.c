@@ -20,6 +20,29 @@
 
 #include "simba.h"
 
+static THRD_STACK(logger_stack, 1024);
+
+/* Formatted entries are written to a queue, and read into a
+   string. */
+static char capture_buf[2048];
+static QUEUE_INIT_DECL(capture, capture_buf, sizeof(capture_buf));
+static char output[sizeof(capture_buf)];
+
+static void *logger_entry(void *arg_p)
+{
+    int i;
+
+    if (thrd_self()->prio < 0) {
+        LOG(NOTICE, "important");
+    } else {
+        for (i = 0; i < 20; i++) {
+            LOG(NOTICE, "chatty %d", i);
+        }
+    }
+
+    return (NULL);
+}
+
 int test_circular(struct harness_t *harness_p)
 {
     int i;
@@ -50,16 +73,21 @@ int test_circular(struct harness_t *harness_p)
 
     BTASSERT(log_set_mode(LOG_MODE_OFF) == LOG_MODE_CIRCULAR);
     number_of_entries = log_format(sys_get_stdout());
+
+    /* All entries are written to the ring of this thread, and the
+       oldest are evicted. */
+    BTASSERT(number_of_entries + log_get_dropped(LOG_RINGS - 1) == 15);
+    BTASSERT(log_get_dropped(0) == 0);
 #if defined(ARCH_LINUX)
     if (sizeof(void *) == 8) {
-        BTASSERT(number_of_entries == 4);
+        BTASSERT(number_of_entries == 3);
     } else {
-        BTASSERT(number_of_entries == 8);
+        BTASSERT(number_of_entries == 5);
     }
 #elif defined(ARCH_ARM)
-    BTASSERT(number_of_entries == 9);
-#else
-    BTASSERT(number_of_entries == 13);
+    BTASSERT(number_of_entries == 5);
+#elif defined(ARCH_AVR)
+    BTASSERT(number_of_entries == 8);
 #endif
 
     std_printf(FSTR("formatted\r\n"));
@@ -67,11 +95,71 @@ int test_circular(struct harness_t *harness_p)
     return (0);
 }
 
+int test_rings(struct harness_t *harness_p)
+{
+    struct thrd_t *thrd_p;
+    char buf[32];
+    char *line_p;
+    unsigned long number, previous;
+    int number_of_entries;
+    ssize_t size;
+
+    log_reset();
+    BTASSERT(log_get_dropped(LOG_RINGS) == -EINVAL);
+
+    /* A high priority thread logs once, then a low priority thread
+       fills its ring. */
+    thrd_p = thrd_spawn(logger_entry,
+                        NULL,
+                        -10,
+                        logger_stack,
+                        sizeof(logger_stack));
+    BTASSERT(thrd_wait(thrd_p, NULL) == 0);
+    thrd_p = thrd_spawn(logger_entry,
+                        NULL,
+                        10,
+                        logger_stack,
+                        sizeof(logger_stack));
+    BTASSERT(thrd_wait(thrd_p, NULL) == 0);
+
+    /* The entry of the high priority thread is kept. */
+    BTASSERT(log_get_dropped(0) == 0);
+    BTASSERT(log_get_dropped(LOG_RINGS - 1) > 0);
+
+    number_of_entries = log_format(&capture);
+    BTASSERT(number_of_entries > 1);
+    BTASSERT(number_of_entries + log_get_dropped(LOG_RINGS - 1) == 21);
+    size = queue_size(&capture);
+    BTASSERT(queue_read(&capture, output, size) == size);
+    output[size] = '\0';
+    std_printf(FSTR("%s"), output);
+    BTASSERT(strstr(output, ":notice: important\r\n") != NULL);
+    BTASSERT(strstr(output, ":notice: chatty 19\r\n") != NULL);
+
+    /* The entries are merged by number. */
+    line_p = strstr(output, "\r\n");
+    previous = 0;
+
+    while (line_p[2] != '\0') {
+        line_p += 2;
+        BTASSERT(sscanf(line_p, "%lu:", &number) == 1);
+        BTASSERT(number > previous || previous == 0);
+        previous = number;
+        line_p = strstr(line_p, "\r\n");
+    }
+
+    strcpy(buf, "/kernel/log/rings");
+    BTASSERT(fs_call(buf, NULL, sys_get_stdout()) == 0);
+
+    return (0);
+}
+
 int main()
 {
     struct harness_t harness;
     struct harness_testcase_t harness_testcases[] = {
         { test_circular, "test_circular" },
+        { test_rings, "test_rings" },
         { NULL, NULL }
     };
 
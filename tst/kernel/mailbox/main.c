@@ -0,0 +1,375 @@
+/**
+ * @file main.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+
+#include "simba.h"
+
+#define BENCHMARK_BATCH 8
+#define BENCHMARK_ROUNDS 20000
+
+struct message_t {
+    int id;
+    char data[12];
+};
+
+static MAILBOX_BUFFER(buf, sizeof(struct message_t), 4);
+static MAILBOX_BUFFER(large_buf, sizeof(struct message_t), BENCHMARK_BATCH);
+static char queue_buf[sizeof(struct message_t) * BENCHMARK_BATCH + 1];
+static void *ptr_buf[2];
+static POOL_BUFFER(pool_buf, sizeof(struct message_t), 2);
+
+static struct mailbox_t mailbox;
+static struct mailbox_t ptr_mailbox;
+static struct pool_t pool;
+static struct sem_t sem;
+
+static THRD_STACK(t0_stack, 1024);
+
+static void message_init(struct message_t *message_p, int id)
+{
+    message_p->id = id;
+    memset(&message_p->data[0], id, sizeof(message_p->data));
+}
+
+static int test_send_recv(struct harness_t *harness_p)
+{
+    struct message_t message, messages[8];
+    struct time_t timeout = {
+        .seconds = 0,
+        .nanoseconds = 0
+    };
+    int i;
+
+    BTASSERT(mailbox_init(&mailbox, buf, 0, 4) == -EINVAL);
+    BTASSERT(mailbox_init(&mailbox, buf, sizeof(message), 0) == -EINVAL);
+    BTASSERT(mailbox_init(&mailbox, buf, sizeof(message), 4) == 0);
+
+    /* Receive from an empty mailbox without waiting. */
+    BTASSERT(mailbox_recv(&mailbox, &message, &timeout) == -ETIMEDOUT);
+
+    for (i = 0; i < 3; i++) {
+        message_init(&message, i);
+        BTASSERT(mailbox_send(&mailbox, &message, NULL) == 0);
+    }
+
+    BTASSERT(mailbox_count(&mailbox) == 3);
+
+    /* One message. */
+    BTASSERT(mailbox_recv(&mailbox, &message, NULL) == 0);
+    BTASSERT(message.id == 0);
+    BTASSERT(message.data[11] == 0);
+
+    /* The remaining two messages in one call. */
+    BTASSERT(mailbox_recv_n(&mailbox, &messages[0], 8, NULL) == 2);
+    BTASSERT(messages[0].id == 1);
+    BTASSERT(messages[0].data[0] == 1);
+    BTASSERT(messages[1].id == 2);
+    BTASSERT(messages[1].data[11] == 2);
+
+    /* Fill the mailbox, wrapping around the end of the buffer. */
+    for (i = 3; i < 7; i++) {
+        message_init(&message, i);
+        BTASSERT(mailbox_send(&mailbox, &message, &timeout) == 0);
+    }
+
+    BTASSERT(mailbox_send(&mailbox, &message, &timeout) == -ETIMEDOUT);
+    BTASSERT(mailbox_count(&mailbox) == 4);
+
+    BTASSERT(mailbox_recv_n(&mailbox, &messages[0], 3, NULL) == 3);
+    BTASSERT(mailbox_recv_n(&mailbox, &messages[3], 8, NULL) == 1);
+
+    for (i = 0; i < 4; i++) {
+        BTASSERT(messages[i].id == i + 3);
+        BTASSERT(messages[i].data[5] == i + 3);
+    }
+
+    BTASSERT(mailbox_recv_n(&mailbox, &messages[0], 0, NULL) == 0);
+
+    return (0);
+}
+
+static void *reader_entry(void *arg_p)
+{
+    struct message_t messages[2];
+    ssize_t res;
+
+    thrd_set_name("reader");
+
+    /* Suspended until the main thread sends a message. */
+    res = mailbox_recv_n(&mailbox, &messages[0], 2, NULL);
+    BTASSERT(res == 1);
+    BTASSERT(messages[0].id == 10);
+    sem_put(&sem, 1);
+
+    return (NULL);
+}
+
+static void *writer_entry(void *arg_p)
+{
+    struct message_t message;
+
+    thrd_set_name("writer");
+
+    /* Suspended until the main thread receives a message. */
+    message_init(&message, 11);
+    BTASSERT(mailbox_send(&mailbox, &message, NULL) == 0);
+    sem_put(&sem, 1);
+
+    return (NULL);
+}
+
+static int test_blocking(struct harness_t *harness_p)
+{
+    struct message_t message;
+    struct time_t timeout = {
+        .seconds = 0,
+        .nanoseconds = 10000000
+    };
+    int i;
+
+    BTASSERT(mailbox_init(&mailbox, buf, sizeof(message), 4) == 0);
+    BTASSERT(sem_init(&sem, 0) == 0);
+
+    /* Timeout waiting for a message. */
+    BTASSERT(mailbox_recv(&mailbox, &message, &timeout) == -ETIMEDOUT);
+
+    /* A higher priority reader waits for a message. */
+    BTASSERT(thrd_spawn(reader_entry,
+                        NULL,
+                        -10,
+                        t0_stack,
+                        sizeof(t0_stack)) != NULL);
+    thrd_usleep(1000);
+    BTASSERT(mailbox.readers_p != NULL);
+
+    message_init(&message, 10);
+    BTASSERT(mailbox_send(&mailbox, &message, NULL) == 0);
+    BTASSERT(sem_get(&sem, NULL) == 0);
+    BTASSERT(mailbox_count(&mailbox) == 0);
+
+    /* Timeout waiting for room in a full mailbox. */
+    for (i = 0; i < 4; i++) {
+        message_init(&message, i);
+        BTASSERT(mailbox_send(&mailbox, &message, NULL) == 0);
+    }
+
+    BTASSERT(mailbox_send(&mailbox, &message, &timeout) == -ETIMEDOUT);
+    BTASSERT(mailbox.writers_p == NULL);
+
+    /* A higher priority writer waits for room in the mailbox. */
+    BTASSERT(thrd_spawn(writer_entry,
+                        NULL,
+                        -10,
+                        t0_stack,
+                        sizeof(t0_stack)) != NULL);
+    thrd_usleep(1000);
+    BTASSERT(mailbox.writers_p != NULL);
+
+    BTASSERT(mailbox_recv(&mailbox, &message, NULL) == 0);
+    BTASSERT(message.id == 0);
+    BTASSERT(sem_get(&sem, NULL) == 0);
+
+    for (i = 1; i < 4; i++) {
+        BTASSERT(mailbox_recv(&mailbox, &message, NULL) == 0);
+        BTASSERT(message.id == i);
+    }
+
+    BTASSERT(mailbox_recv(&mailbox, &message, NULL) == 0);
+    BTASSERT(message.id == 11);
+
+    return (0);
+}
+
+static int test_ptr(struct harness_t *harness_p)
+{
+    struct message_t *message_p;
+    void *ptr_p;
+
+    BTASSERT(pool_init(&pool, pool_buf, sizeof(pool_buf), sizeof(*message_p)) == 0);
+    BTASSERT(mailbox_init_ptr(&ptr_mailbox, ptr_buf, membersof(ptr_buf)) == 0);
+
+    /* Pass a pool block without copying it. */
+    message_p = pool_alloc(&pool);
+    BTASSERT(message_p != NULL);
+    message_init(message_p, 5);
+    BTASSERT(mailbox_send_ptr(&ptr_mailbox, message_p, NULL) == 0);
+
+    BTASSERT(mailbox_recv_ptr(&ptr_mailbox, &ptr_p, NULL) == 0);
+    BTASSERT(ptr_p == message_p);
+    BTASSERT(((struct message_t *)ptr_p)->id == 5);
+    BTASSERT(pool_free(&pool, ptr_p) == 0);
+
+    return (0);
+}
+
+static int test_isr(struct harness_t *harness_p)
+{
+    struct message_t message;
+    int i;
+
+    BTASSERT(mailbox_init(&mailbox, buf, sizeof(message), 4) == 0);
+
+    sys_lock();
+
+    for (i = 0; i < 4; i++) {
+        message_init(&message, i);
+        BTASSERT(mailbox_send_isr(&mailbox, &message) == 0);
+    }
+
+    BTASSERT(mailbox_send_isr(&mailbox, &message) == -ENOSPC);
+
+    sys_unlock();
+
+    for (i = 0; i < 4; i++) {
+        BTASSERT(mailbox_recv(&mailbox, &message, NULL) == 0);
+        BTASSERT(message.id == i);
+    }
+
+    return (0);
+}
+
+static void *poll_writer_entry(void *arg_p)
+{
+    struct message_t message;
+
+    thrd_set_name("poll_writer");
+
+    message_init(&message, 3);
+    BTASSERT(chan_write(&mailbox, &message, sizeof(message))
+             == sizeof(message));
+
+    return (NULL);
+}
+
+static int test_chan(struct harness_t *harness_p)
+{
+    struct message_t messages[2];
+    struct chan_list_t list;
+    char workspace[16];
+
+    BTASSERT(mailbox_init(&mailbox, buf, sizeof(messages[0]), 4) == 0);
+
+    /* Only whole messages can be read and written. */
+    BTASSERT(chan_write(&mailbox, &messages[0], 3) == -EINVAL);
+    BTASSERT(chan_read(&mailbox, &messages[0], 3) == -EINVAL);
+
+    message_init(&messages[0], 1);
+    message_init(&messages[1], 2);
+    BTASSERT(chan_write(&mailbox, &messages[0], sizeof(messages))
+             == sizeof(messages));
+    BTASSERT(chan_size(&mailbox) == 2);
+    memset(&messages[0], 0, sizeof(messages));
+    BTASSERT(chan_read(&mailbox, &messages[0], sizeof(messages))
+             == sizeof(messages));
+    BTASSERT(messages[0].id == 1);
+    BTASSERT(messages[1].id == 2);
+
+    /* Poll until a lower priority thread writes a message. */
+    BTASSERT(chan_list_init(&list, workspace, sizeof(workspace)) == 0);
+    BTASSERT(chan_list_add(&list, &mailbox) == 0);
+    BTASSERT(thrd_spawn(poll_writer_entry,
+                        NULL,
+                        10,
+                        t0_stack,
+                        sizeof(t0_stack)) != NULL);
+    BTASSERT(chan_list_poll(&list, NULL) == &mailbox);
+    BTASSERT(chan_read(&mailbox, &messages[0], sizeof(messages[0]))
+             == sizeof(messages[0]));
+    BTASSERT(messages[0].id == 3);
+    BTASSERT(chan_list_destroy(&list) == 0);
+
+    return (0);
+}
+
+static int test_benchmark(struct harness_t *harness_p)
+{
+    struct message_t messages[BENCHMARK_BATCH];
+    struct queue_t queue;
+    uint64_t start, mailbox_elapsed, queue_elapsed;
+    int i;
+    int j;
+
+    BTASSERT(mailbox_init(&mailbox,
+                          large_buf,
+                          sizeof(messages[0]),
+                          BENCHMARK_BATCH) == 0);
+    BTASSERT(queue_init(&queue, queue_buf, sizeof(queue_buf)) == 0);
+
+    for (i = 0; i < BENCHMARK_BATCH; i++) {
+        message_init(&messages[i], i);
+    }
+
+    /* Messages sent one by one and received in batches. */
+    start = time_get_ns();
+
+    for (i = 0; i < BENCHMARK_ROUNDS; i++) {
+        for (j = 0; j < BENCHMARK_BATCH; j++) {
+            mailbox_send(&mailbox, &messages[j], NULL);
+        }
+
+        mailbox_recv_n(&mailbox, &messages[0], BENCHMARK_BATCH, NULL);
+    }
+
+    mailbox_elapsed = (time_get_ns() - start);
+
+    /* The same with a byte queue, one message at a time. */
+    start = time_get_ns();
+
+    for (i = 0; i < BENCHMARK_ROUNDS; i++) {
+        for (j = 0; j < BENCHMARK_BATCH; j++) {
+            queue_write(&queue, &messages[j], sizeof(messages[j]));
+        }
+
+        for (j = 0; j < BENCHMARK_BATCH; j++) {
+            queue_read(&queue, &messages[j], sizeof(messages[j]));
+        }
+    }
+
+    queue_elapsed = (time_get_ns() - start);
+
+    std_printf(FSTR("%d messages: mailbox %lu us, queue %lu us\r\n"),
+               BENCHMARK_BATCH * BENCHMARK_ROUNDS,
+               (unsigned long)(mailbox_elapsed / 1000),
+               (unsigned long)(queue_elapsed / 1000));
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_t harness;
+    struct harness_testcase_t harness_testcases[] = {
+        { test_send_recv, "test_send_recv" },
+        { test_blocking, "test_blocking" },
+        { test_ptr, "test_ptr" },
+        { test_isr, "test_isr" },
+        { test_chan, "test_chan" },
+        { test_benchmark, "test_benchmark" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+    uart_module_init();
+
+    harness_init(&harness);
+    harness_run(&harness, harness_testcases);
+
+    return (0);
+}
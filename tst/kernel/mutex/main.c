@@ -0,0 +1,339 @@
+/**
+ * @file main.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+/* Time the low priority thread holds the resource, and the time the
+   medium priority thread keeps the cpu busy, in milliseconds. */
+#define INVERSION_HOLD_MS 50
+#define INVERSION_BUSY_MS 200
+
+static struct mutex_t mutex;
+static struct mutex_t mutex2;
+static struct sem_t sem;
+
+static THRD_STACK(low_stack, 256);
+static THRD_STACK(medium_stack, 256);
+static THRD_STACK(high_stack, 256);
+
+/* Lock and unlock functions of the resource in the inversion test. */
+static void (*resource_lock)(void);
+static void (*resource_unlock)(void);
+static long high_wait_ms;
+
+static void *holder_entry(void *arg_p)
+{
+    thrd_set_name("holder");
+
+    mutex_lock(arg_p, NULL);
+    thrd_suspend(NULL);
+    mutex_unlock(arg_p);
+
+    return (NULL);
+}
+
+static void *chain_entry(void *arg_p)
+{
+    thrd_set_name("chain");
+
+    mutex_lock(&mutex2, NULL);
+    mutex_lock(&mutex, NULL);
+    mutex_unlock(&mutex);
+    mutex_unlock(&mutex2);
+
+    return (NULL);
+}
+
+static void *waiter_entry(void *arg_p)
+{
+    thrd_set_name("waiter");
+
+    if (mutex_lock(arg_p, NULL) == 0) {
+        mutex_unlock(arg_p);
+    }
+
+    return (NULL);
+}
+
+static int test_lock_unlock(struct harness_t *harness_p)
+{
+    BTASSERT(mutex_init(&mutex) == 0);
+
+    BTASSERT(mutex_lock(&mutex, NULL) == 0);
+    BTASSERT(mutex.owner_p == thrd_self());
+
+    /* Recursive locking is detected. */
+    BTASSERT(mutex_lock(&mutex, NULL) == -EDEADLK);
+
+    BTASSERT(mutex_unlock(&mutex) == 0);
+    BTASSERT(mutex.owner_p == NULL);
+
+    /* Only the owner may unlock the mutex. */
+    BTASSERT(mutex_unlock(&mutex) == -EPERM);
+
+    return (0);
+}
+
+static int test_timeout(struct harness_t *harness_p)
+{
+    struct thrd_t *holder_p;
+    struct time_t timeout;
+
+    BTASSERT(mutex_init(&mutex) == 0);
+
+    holder_p = thrd_spawn(holder_entry,
+                          &mutex,
+                          10,
+                          low_stack,
+                          sizeof(low_stack));
+    BTASSERT(holder_p != NULL);
+    thrd_usleep(10000);
+    BTASSERT(mutex.owner_p == holder_p);
+
+    timeout.seconds = 0;
+    timeout.nanoseconds = 0;
+    BTASSERT(mutex_lock(&mutex, &timeout) == -ETIMEDOUT);
+
+    /* The holder inherits the priority of this thread while it
+       waits, and drops it on timeout. */
+    timeout.nanoseconds = 20000000;
+    BTASSERT(mutex_lock(&mutex, &timeout) == -ETIMEDOUT);
+    BTASSERT(holder_p->prio == 10, "prio = %d", holder_p->prio);
+
+    /* The ownership is passed to this thread on unlock. */
+    thrd_resume(holder_p, 0);
+    BTASSERT(mutex_lock(&mutex, NULL) == 0);
+    BTASSERT(mutex.owner_p == thrd_self());
+    BTASSERT(mutex_unlock(&mutex) == 0);
+    BTASSERT(thrd_wait(holder_p, NULL) == 0);
+
+    return (0);
+}
+
+static int test_priority_inheritance(struct harness_t *harness_p)
+{
+    struct thrd_t *holder_p, *chain_p, *waiter_p;
+
+    BTASSERT(mutex_init(&mutex) == 0);
+    BTASSERT(mutex_init(&mutex2) == 0);
+
+    /* A low priority thread owns the first mutex. */
+    holder_p = thrd_spawn(holder_entry,
+                          &mutex,
+                          10,
+                          low_stack,
+                          sizeof(low_stack));
+    BTASSERT(holder_p != NULL);
+    thrd_usleep(10000);
+
+    /* A medium priority thread owns the second mutex and waits for
+       the first. */
+    chain_p = thrd_spawn(chain_entry,
+                         NULL,
+                         5,
+                         medium_stack,
+                         sizeof(medium_stack));
+    BTASSERT(chain_p != NULL);
+    thrd_usleep(10000);
+    BTASSERT(mutex2.owner_p == chain_p);
+    BTASSERT(holder_p->prio == 5, "prio = %d", holder_p->prio);
+
+    /* Inheritance is transitive. A high priority thread waiting for
+       the second mutex raises the priority of both owners. */
+    waiter_p = thrd_spawn(waiter_entry,
+                          &mutex2,
+                          -10,
+                          high_stack,
+                          sizeof(high_stack));
+    BTASSERT(waiter_p != NULL);
+    thrd_usleep(10000);
+    BTASSERT(chain_p->prio == -10, "prio = %d", chain_p->prio);
+    BTASSERT(holder_p->prio == -10, "prio = %d", holder_p->prio);
+
+    /* Unlocking the mutexes restores the priorities. */
+    thrd_resume(holder_p, 0);
+    BTASSERT(thrd_wait(waiter_p, NULL) == 0);
+    BTASSERT(thrd_wait(chain_p, NULL) == 0);
+    BTASSERT(thrd_wait(holder_p, NULL) == 0);
+    BTASSERT(holder_p->prio == 10, "prio = %d", holder_p->prio);
+    BTASSERT(chain_p->prio == 5, "prio = %d", chain_p->prio);
+    BTASSERT(mutex.owner_p == NULL);
+    BTASSERT(mutex2.owner_p == NULL);
+
+    return (0);
+}
+
+static void sem_resource_lock(void)
+{
+    sem_get(&sem, NULL);
+}
+
+static void sem_resource_unlock(void)
+{
+    sem_put(&sem, 1);
+}
+
+static void mutex_resource_lock(void)
+{
+    mutex_lock(&mutex, NULL);
+}
+
+static void mutex_resource_unlock(void)
+{
+    mutex_unlock(&mutex);
+}
+
+static void *low_entry(void *arg_p)
+{
+    thrd_set_name("low");
+#if THRD_NCPUS > 1
+    /* The inversion only happens if all threads share one cpu. */
+    thrd_set_cpu(thrd_self(), 0);
+#endif
+
+    /* Hold the resource for a short while. */
+    resource_lock();
+    thrd_usleep(1000L * INVERSION_HOLD_MS);
+    resource_unlock();
+
+    return (NULL);
+}
+
+static void *medium_entry(void *arg_p)
+{
+    uint64_t start;
+
+    thrd_set_name("medium");
+#if THRD_NCPUS > 1
+    thrd_set_cpu(thrd_self(), 0);
+#endif
+
+    /* Keep the cpu busy, but let more important threads run once
+       every millisecond. */
+    start = time_get_ns();
+
+    while ((time_get_ns() - start) < 1000000ULL * INVERSION_BUSY_MS) {
+        thrd_yield();
+    }
+
+    return (NULL);
+}
+
+static void *high_entry(void *arg_p)
+{
+    uint64_t start;
+
+    thrd_set_name("high");
+#if THRD_NCPUS > 1
+    thrd_set_cpu(thrd_self(), 0);
+#endif
+
+    start = time_get_ns();
+    resource_lock();
+    high_wait_ms = (long)((time_get_ns() - start) / 1000000ULL);
+    resource_unlock();
+
+    return (NULL);
+}
+
+/**
+ * A low priority thread holds a resource needed by a high priority
+ * thread, while a medium priority thread keeps the cpu busy. Return
+ * the time the high priority thread waited for the resource.
+ */
+static long inversion(void (*lock)(void), void (*unlock)(void))
+{
+    struct thrd_t *low_p, *medium_p, *high_p;
+
+    resource_lock = lock;
+    resource_unlock = unlock;
+
+    /* Let the low priority thread take the resource. */
+    low_p = thrd_spawn(low_entry,
+                       NULL,
+                       10,
+                       low_stack,
+                       sizeof(low_stack));
+    thrd_usleep(1000);
+
+    high_p = thrd_spawn(high_entry,
+                        NULL,
+                        -10,
+                        high_stack,
+                        sizeof(high_stack));
+    medium_p = thrd_spawn(medium_entry,
+                          NULL,
+                          5,
+                          medium_stack,
+                          sizeof(medium_stack));
+
+    thrd_wait(high_p, NULL);
+    thrd_wait(medium_p, NULL);
+    thrd_wait(low_p, NULL);
+
+    return (high_wait_ms);
+}
+
+static int test_priority_inversion(struct harness_t *harness_p)
+{
+    long sem_wait_ms, mutex_wait_ms;
+
+    BTASSERT(sem_init(&sem, 1) == 0);
+    BTASSERT(mutex_init(&mutex) == 0);
+
+    /* The semaphore has no owner. The medium priority thread delays
+       the low priority thread, and thereby the high priority thread,
+       for as long as it is busy. */
+    sem_wait_ms = inversion(sem_resource_lock, sem_resource_unlock);
+
+    /* The mutex owner inherits the priority of the high priority
+       thread and finishes before the medium priority thread. */
+    mutex_wait_ms = inversion(mutex_resource_lock, mutex_resource_unlock);
+
+    std_printf(FSTR("high priority thread waited %ld ms with sem_t "
+                    "and %ld ms with mutex_t\r\n"),
+               sem_wait_ms,
+               mutex_wait_ms);
+
+    BTASSERT(sem_wait_ms >= INVERSION_BUSY_MS, "%ld", sem_wait_ms);
+    BTASSERT(mutex_wait_ms < INVERSION_BUSY_MS / 2, "%ld", mutex_wait_ms);
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_t harness;
+    struct harness_testcase_t harness_testcases[] = {
+        { test_lock_unlock, "test_lock_unlock" },
+        { test_timeout, "test_timeout" },
+        { test_priority_inheritance, "test_priority_inheritance" },
+        { test_priority_inversion, "test_priority_inversion" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+    uart_module_init();
+
+    harness_init(&harness);
+    harness_run(&harness, harness_testcases);
+
+    return (0);
+}
@@ -0,0 +1,175 @@
+/**
+ * @file main.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+#define BENCHMARK_BLOCKS 256
+#define BENCHMARK_ROUNDS 100000
+
+COUNTER_DEFINE("/test/pool/high_water", test_high_water);
+COUNTER_DEFINE("/test/pool/failures", test_failures);
+
+static POOL_BUFFER(small_buf, 10, 4);
+static POOL_BUFFER(large_buf, 32, BENCHMARK_BLOCKS);
+static struct pool_t pool;
+
+static int test_alloc_free(struct harness_t *harness_p)
+{
+    void *blocks[4];
+    int i;
+    int j;
+
+    BTASSERT(pool_init(&pool, small_buf, 4, 10) == -EINVAL);
+    BTASSERT(pool_init(&pool, small_buf, sizeof(small_buf), 10) == 0);
+    BTASSERT(pool.block_size == 16);
+
+    for (i = 0; i < 4; i++) {
+        blocks[i] = pool_alloc(&pool);
+        BTASSERT(blocks[i] != NULL);
+
+        for (j = 0; j < i; j++) {
+            BTASSERT(blocks[i] != blocks[j]);
+        }
+    }
+
+    /* The pool is empty. */
+    BTASSERT(pool_alloc(&pool) == NULL);
+    BTASSERT(pool.counters.failures == 1);
+    BTASSERT(pool.counters.high_water == 4);
+
+    /* Only blocks of the pool may be freed. */
+    BTASSERT(pool_free(&pool, (char *)blocks[0] + 1) == -EINVAL);
+    BTASSERT(pool_free(&pool, large_buf) == -EINVAL);
+
+    for (i = 0; i < 4; i++) {
+        BTASSERT(pool_free(&pool, blocks[i]) == 0);
+    }
+
+    BTASSERT(pool.used == 0);
+
+    /* The last freed block is allocated first. */
+    BTASSERT(pool_alloc(&pool) == blocks[3]);
+    BTASSERT(pool_free(&pool, blocks[3]) == 0);
+    BTASSERT(pool.counters.high_water == 4);
+
+    return (0);
+}
+
+static int test_isr(struct harness_t *harness_p)
+{
+    void *block_p;
+
+    BTASSERT(pool_init(&pool, small_buf, sizeof(small_buf), 16) == 0);
+
+    sys_lock();
+    block_p = pool_alloc_isr(&pool);
+    sys_unlock();
+    BTASSERT(block_p != NULL);
+    BTASSERT(pool.used == 1);
+
+    sys_lock();
+    BTASSERT(pool_free_isr(&pool, block_p) == 0);
+    sys_unlock();
+    BTASSERT(pool.used == 0);
+
+    return (0);
+}
+
+static int test_counters(struct harness_t *harness_p)
+{
+    char buf[64];
+    void *blocks[4];
+    int i;
+
+    BTASSERT(pool_init(&pool, small_buf, sizeof(small_buf), 16) == 0);
+    BTASSERT(pool_set_counters(&pool,
+                               &COUNTER(test_high_water),
+                               &COUNTER(test_failures)) == 0);
+
+    for (i = 0; i < 4; i++) {
+        blocks[i] = pool_alloc(&pool);
+    }
+
+    BTASSERT(pool_alloc(&pool) == NULL);
+    BTASSERT(COUNTER(test_high_water) == 4);
+    BTASSERT(COUNTER(test_failures) == 1);
+
+    for (i = 0; i < 4; i++) {
+        BTASSERT(pool_free(&pool, blocks[i]) == 0);
+    }
+
+    strcpy(buf, "/test/pool/high_water");
+    BTASSERT(fs_call(buf, NULL, sys_get_stdout()) == 0);
+    strcpy(buf, "/kernel/pool/alloc_failures");
+    BTASSERT(fs_call(buf, NULL, sys_get_stdout()) == 0);
+
+    return (0);
+}
+
+static int test_benchmark(struct harness_t *harness_p)
+{
+    void *blocks[4];
+    int i;
+    int j;
+    uint64_t start, elapsed;
+
+    BTASSERT(pool_init(&pool, large_buf, sizeof(large_buf), 32) == 0);
+
+    start = time_get_ns();
+
+    for (i = 0; i < BENCHMARK_ROUNDS; i++) {
+        for (j = 0; j < 4; j++) {
+            blocks[j] = pool_alloc(&pool);
+        }
+
+        for (j = 0; j < 4; j++) {
+            pool_free(&pool, blocks[j]);
+        }
+    }
+
+    elapsed = (time_get_ns() - start);
+
+    std_printf(FSTR("%d allocs and frees in %lu us, %lu ns per pair\r\n"),
+               4 * BENCHMARK_ROUNDS,
+               (unsigned long)(elapsed / 1000),
+               (unsigned long)(elapsed / (4 * BENCHMARK_ROUNDS)));
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_t harness;
+    struct harness_testcase_t harness_testcases[] = {
+        { test_alloc_free, "test_alloc_free" },
+        { test_isr, "test_isr" },
+        { test_counters, "test_counters" },
+        { test_benchmark, "test_benchmark" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+    uart_module_init();
+
+    harness_init(&harness);
+    harness_run(&harness, harness_testcases);
+
+    return (0);
+}
@@ -150,6 +150,433 @@ static int test_poll(struct harness_t *harness_p)
     return (0);
 }
 
+static struct queue_spsc_t spsc;
+static char spsc_buf[8];
+
+static THRD_STACK(t1_stack, 1024);
+static void *t1_entry(void *arg_p)
+{
+    struct queue_spsc_t *queue_p = arg_p;
+    unsigned char buf[13];
+    int i, j, k;
+
+    thrd_set_name("t1");
+
+    /* Write an incrementing byte sequence in chunks of various
+       sizes. */
+    k = 0;
+
+    for (i = 0; i < 40; i++) {
+        for (j = 0; j < (i % 13) + 1; j++) {
+            buf[j] = k++;
+        }
+
+        BTASSERT(chan_write(queue_p, buf, j) == j);
+    }
+
+    /* Wake the poller. */
+    thrd_usleep(50000);
+    buf[0] = 0xaa;
+    BTASSERT(chan_write(queue_p, buf, 1) == 1);
+
+    thrd_suspend(NULL);
+
+    return (0);
+}
+
+static int test_spsc_init(struct harness_t *harness_p)
+{
+    BTASSERT(queue_spsc_init(&spsc, spsc_buf, 0) == -EINVAL);
+    BTASSERT(queue_spsc_init(&spsc, spsc_buf, 3) == -EINVAL);
+    BTASSERT(queue_spsc_init(&spsc, spsc_buf, 6) == -EINVAL);
+    BTASSERT(queue_spsc_init(&spsc, spsc_buf, sizeof(spsc_buf)) == 0);
+    BTASSERT(queue_spsc_size(&spsc) == 0);
+
+    return (0);
+}
+
+static int test_spsc_write_isr(struct harness_t *harness_p)
+{
+    char buf[10];
+    int i;
+
+    for (i = 0; i < membersof(buf); i++) {
+        buf[i] = i;
+    }
+
+    /* Only the first eight bytes fits. */
+    sys_lock();
+    BTASSERT(queue_spsc_write_isr(&spsc, buf, 10) == 8);
+    BTASSERT(queue_spsc_write_isr(&spsc, buf, 1) == 0);
+    sys_unlock();
+
+    BTASSERT(queue_spsc_size(&spsc) == 8);
+    memset(buf, -1, sizeof(buf));
+    BTASSERT(queue_spsc_read(&spsc, buf, 5) == 5);
+    BTASSERT(queue_spsc_size(&spsc) == 3);
+
+    /* Wrap around the end of the ring. */
+    sys_lock();
+    BTASSERT(queue_spsc_write_isr(&spsc, &buf[0], 5) == 5);
+    sys_unlock();
+
+    BTASSERT(queue_spsc_read(&spsc, &buf[5], 5) == 5);
+    BTASSERT(memcmp(buf, "\x00\x01\x02\x03\x04\x05\x06\x07\x00\x01", 10) == 0);
+    BTASSERT(queue_spsc_read(&spsc, buf, 3) == 3);
+    BTASSERT(memcmp(buf, "\x02\x03\x04", 3) == 0);
+    BTASSERT(queue_spsc_size(&spsc) == 0);
+
+    return (0);
+}
+
+static int test_spsc_read_write(struct harness_t *harness_p)
+{
+    unsigned char buf[17];
+    int i, j, k, n, total;
+
+    BTASSERT(thrd_spawn(t1_entry,
+                        &spsc,
+                        1,
+                        t1_stack,
+                        sizeof(t1_stack)) != NULL);
+
+    /* Read the sequence in chunks of other sizes than written,
+       including chunks larger than the ring. */
+    total = 0;
+
+    for (i = 0; i < 40; i++) {
+        total += (i % 13) + 1;
+    }
+
+    k = 0;
+    i = 0;
+
+    while (k < total) {
+        j = (i++ % 17) + 1;
+
+        if (j > total - k) {
+            j = total - k;
+        }
+
+        BTASSERT(chan_read(&spsc, buf, j) == j);
+
+        for (n = 0; n < j; n++) {
+            BTASSERT(buf[n] == (unsigned char)k);
+            k++;
+        }
+    }
+
+    BTASSERT(queue_spsc_size(&spsc) == 0);
+
+    return (0);
+}
+
+static int test_spsc_poll(struct harness_t *harness_p)
+{
+    unsigned char b;
+    struct chan_list_t list;
+    char workspace[64];
+
+    BTASSERT(chan_list_init(&list, workspace, sizeof(workspace)) == 0);
+    BTASSERT(chan_list_add(&list, &spsc) == 0);
+
+    BTASSERT(chan_list_poll(&list, NULL) == &spsc);
+    BTASSERT(chan_size(&spsc) == 1);
+    BTASSERT(chan_read(&spsc, &b, sizeof(b)) == sizeof(b));
+    BTASSERT(b == 0xaa);
+
+    BTASSERT(chan_list_destroy(&list) == 0);
+
+    return (0);
+}
+
+static struct queue_t zc_queue;
+static char zc_buf[8];
+
+static THRD_STACK(t2_stack, 1024);
+static void *t2_entry(void *arg_p)
+{
+    struct queue_span_t spans[2];
+
+    thrd_set_name("t2");
+
+    /* Larger than the queue buffer, so the writer is suspended until
+       the reader consumes. */
+    BTASSERT(queue_write(&zc_queue, "hello\nworld\n", 12) == 12);
+
+    /* Commit to a suspended reader. */
+    thrd_usleep(50000);
+    BTASSERT(queue_write_reserve(&zc_queue, spans, 4) == 4);
+    memcpy(spans[0].buf_p, "abcd", spans[0].size);
+    memcpy(spans[1].buf_p, &"abcd"[spans[0].size], spans[1].size);
+    BTASSERT(queue_write_commit(&zc_queue, 4) == 4);
+
+    thrd_suspend(NULL);
+
+    return (0);
+}
+
+static int test_reserve_commit(struct harness_t *harness_p)
+{
+    struct queue_t queue;
+    struct queue_span_t spans[2];
+    char buf[16];
+
+    /* Not supported without a buffer. */
+    BTASSERT(queue_init(&queue, NULL, 0) == 0);
+    BTASSERT(queue_write_reserve(&queue, spans, 1) == -EINVAL);
+    BTASSERT(queue_write_commit(&queue, 1) == -EINVAL);
+    BTASSERT(queue_read_peek(&queue, spans) == -EINVAL);
+    BTASSERT(queue_read_consume(&queue, 1) == -EINVAL);
+
+    /* Seven of the eight bytes in the buffer can be used. */
+    BTASSERT(queue_init(&zc_queue, zc_buf, sizeof(zc_buf)) == 0);
+    BTASSERT(queue_write_reserve(&zc_queue, spans, 10) == 7);
+    BTASSERT(spans[0].buf_p == &zc_buf[0]);
+    BTASSERT(spans[0].size == 7);
+    BTASSERT(spans[1].size == 0);
+    memcpy(spans[0].buf_p, "abcde", 5);
+    BTASSERT(queue_write_commit(&zc_queue, 5) == 5);
+    BTASSERT(queue_write_commit(&zc_queue, 3) == -EINVAL);
+    BTASSERT(queue_size(&zc_queue) == 5);
+
+    BTASSERT(queue_read_peek(&zc_queue, spans) == 5);
+    BTASSERT(spans[0].buf_p == &zc_buf[0]);
+    BTASSERT(spans[0].size == 5);
+    BTASSERT(spans[1].size == 0);
+    BTASSERT(memcmp(spans[0].buf_p, "abcde", 5) == 0);
+    BTASSERT(queue_read_consume(&zc_queue, 4) == 4);
+
+    /* Reserved space wraps around the end of the buffer. */
+    BTASSERT(queue_write_reserve(&zc_queue, spans, 10) == 6);
+    BTASSERT(spans[0].buf_p == &zc_buf[5]);
+    BTASSERT(spans[0].size == 3);
+    BTASSERT(spans[1].buf_p == &zc_buf[0]);
+    BTASSERT(spans[1].size == 3);
+    memcpy(spans[0].buf_p, "123", 3);
+    memcpy(spans[1].buf_p, "456", 3);
+    BTASSERT(queue_write_commit(&zc_queue, 6) == 6);
+
+    /* Data wraps around the end of the buffer. */
+    BTASSERT(queue_read_peek(&zc_queue, spans) == 7);
+    BTASSERT(spans[0].buf_p == &zc_buf[4]);
+    BTASSERT(spans[0].size == 4);
+    BTASSERT(memcmp(spans[0].buf_p, "e123", 4) == 0);
+    BTASSERT(spans[1].buf_p == &zc_buf[0]);
+    BTASSERT(spans[1].size == 3);
+    BTASSERT(memcmp(spans[1].buf_p, "456", 3) == 0);
+    BTASSERT(queue_read_consume(&zc_queue, 8) == -EINVAL);
+
+    /* Read until a delimiter in the second span. */
+    BTASSERT(queue_read_until(&zc_queue, buf, sizeof(buf), '4') == 5);
+    BTASSERT(memcmp(buf, "e1234", 5) == 0);
+
+    /* Read until the buffer is full. */
+    BTASSERT(queue_read_until(&zc_queue, buf, 1, '6') == 1);
+    BTASSERT(buf[0] == '5');
+    BTASSERT(queue_read(&zc_queue, buf, 1) == 1);
+    BTASSERT(buf[0] == '6');
+    BTASSERT(queue_size(&zc_queue) == 0);
+
+    return (0);
+}
+
+static int test_read_until(struct harness_t *harness_p)
+{
+    char buf[16];
+
+    BTASSERT(thrd_spawn(t2_entry,
+                        NULL,
+                        1,
+                        t2_stack,
+                        sizeof(t2_stack)) != NULL);
+
+    /* Peek waits for the writer, and consume moves the rest of the
+       suspended writer's data to the queue buffer. */
+    BTASSERT(queue_read_until(&zc_queue, buf, sizeof(buf), '\n') == 6);
+    BTASSERT(memcmp(buf, "hello\n", 6) == 0);
+    BTASSERT(queue_read_until(&zc_queue, buf, sizeof(buf), '\n') == 6);
+    BTASSERT(memcmp(buf, "world\n", 6) == 0);
+
+    /* Committed data is copied to the suspended reader. */
+    BTASSERT(queue_read(&zc_queue, buf, 4) == 4);
+    BTASSERT(memcmp(buf, "abcd", 4) == 0);
+    BTASSERT(queue_size(&zc_queue) == 0);
+
+    return (0);
+}
+
+static struct queue_t iov_queue;
+static char iov_buf[8];
+
+static THRD_STACK(t3_stack, 1024);
+static void *t3_entry(void *arg_p)
+{
+    struct iov_t iov[3];
+
+    thrd_set_name("t3");
+
+    /* Larger than the queue buffer. */
+    iov[0].buf_p = "ab";
+    iov[0].size = 2;
+    iov[1].buf_p = NULL;
+    iov[1].size = 0;
+    iov[2].buf_p = "cdefghijk";
+    iov[2].size = 9;
+    BTASSERT(chan_writev(&iov_queue, iov, 3) == 11);
+
+    /* Channel without native gather write. */
+    BTASSERT(chan_writev(&spsc, iov, 3) == 11);
+
+    thrd_suspend(NULL);
+
+    return (0);
+}
+
+static int test_readv_writev(struct harness_t *harness_p)
+{
+    struct iov_t iov[3];
+    char buf0[3], buf1[8];
+
+    BTASSERT(queue_init(&iov_queue, iov_buf, sizeof(iov_buf)) == 0);
+    BTASSERT(queue_spsc_init(&spsc, spsc_buf, sizeof(spsc_buf)) == 0);
+
+    BTASSERT(thrd_spawn(t3_entry,
+                        NULL,
+                        1,
+                        t3_stack,
+                        sizeof(t3_stack)) != NULL);
+
+    iov[0].buf_p = buf0;
+    iov[0].size = sizeof(buf0);
+    iov[1].buf_p = NULL;
+    iov[1].size = 0;
+    iov[2].buf_p = buf1;
+    iov[2].size = sizeof(buf1);
+
+    BTASSERT(chan_readv(&iov_queue, iov, 3) == 11);
+    BTASSERT(memcmp(buf0, "abc", 3) == 0);
+    BTASSERT(memcmp(buf1, "defghijk", 8) == 0);
+    BTASSERT(queue_size(&iov_queue) == 0);
+
+    /* Channel without native scatter read. */
+    memset(buf0, 0, sizeof(buf0));
+    memset(buf1, 0, sizeof(buf1));
+    BTASSERT(chan_readv(&spsc, iov, 3) == 11);
+    BTASSERT(memcmp(buf0, "abc", 3) == 0);
+    BTASSERT(memcmp(buf1, "defghijk", 8) == 0);
+
+    return (0);
+}
+
+#define BENCHMARK_BYTES 1000000
+
+struct benchmark_t {
+    chan_t *chan_p;
+    ssize_t (*write_isr)(void *self_p, const void *buf_p, size_t size);
+    size_t chunk_size;
+};
+
+static void *producer_entry(void *arg_p)
+{
+    struct benchmark_t *benchmark_p = arg_p;
+    char buf[64];
+    size_t left, n;
+
+    memset(buf, 0, sizeof(buf));
+    left = BENCHMARK_BYTES;
+
+    while (left > 0) {
+        n = MIN(left, benchmark_p->chunk_size);
+
+        if (benchmark_p->write_isr != NULL) {
+            /* Like an interrupt service routine. */
+            sys_lock();
+            n = benchmark_p->write_isr(benchmark_p->chan_p, buf, n);
+            sys_unlock();
+
+            if (n == 0) {
+                thrd_yield();
+            }
+        } else {
+            chan_write(benchmark_p->chan_p, buf, n);
+        }
+
+        left -= n;
+    }
+
+    return (NULL);
+}
+
+static int benchmark(const char *name_p,
+                     struct benchmark_t *benchmark_p)
+{
+    char buf[64];
+    size_t left;
+    uint64_t start, elapsed;
+
+    start = time_get_ns();
+
+    BTASSERT(thrd_spawn_dynamic(producer_entry,
+                                benchmark_p,
+                                1,
+                                1024) != NULL);
+
+    left = BENCHMARK_BYTES;
+
+    while (left > 0) {
+        left -= chan_read(benchmark_p->chan_p,
+                          buf,
+                          MIN(left, benchmark_p->chunk_size));
+    }
+
+    elapsed = (time_get_ns() - start);
+
+    std_printf(FSTR("%s: %2u byte chunks: %lu kB/s\r\n"),
+               name_p,
+               (unsigned int)benchmark_p->chunk_size,
+               (unsigned long)((1000000ULL * BENCHMARK_BYTES) / elapsed));
+
+    return (0);
+}
+
+static int test_benchmark(struct harness_t *harness_p)
+{
+    static char buf[64];
+    struct queue_t queue;
+    struct benchmark_t benchmark_args;
+    size_t chunk_sizes[] = { 1, 16 };
+    int i;
+
+    for (i = 0; i < membersof(chunk_sizes); i++) {
+        benchmark_args.chunk_size = chunk_sizes[i];
+
+        BTASSERT(queue_init(&queue, buf, sizeof(buf)) == 0);
+        benchmark_args.chan_p = &queue;
+        benchmark_args.write_isr =
+            (ssize_t (*)(void *, const void *, size_t))queue_write_isr;
+        BTASSERT(benchmark("queue_write_isr", &benchmark_args) == 0);
+
+        BTASSERT(queue_spsc_init(&spsc, buf, sizeof(buf)) == 0);
+        benchmark_args.chan_p = &spsc;
+        benchmark_args.write_isr =
+            (ssize_t (*)(void *, const void *, size_t))queue_spsc_write_isr;
+        BTASSERT(benchmark("queue_spsc_write_isr", &benchmark_args) == 0);
+
+        BTASSERT(queue_init(&queue, buf, sizeof(buf)) == 0);
+        benchmark_args.chan_p = &queue;
+        benchmark_args.write_isr = NULL;
+        BTASSERT(benchmark("queue_write", &benchmark_args) == 0);
+
+        BTASSERT(queue_spsc_init(&spsc, buf, sizeof(buf)) == 0);
+        benchmark_args.chan_p = &spsc;
+        benchmark_args.write_isr = NULL;
+        BTASSERT(benchmark("queue_spsc_write", &benchmark_args) == 0);
+    }
+
+    return (0);
+}
+
 int main()
 {
     struct harness_t harness;
@@ -157,6 +584,14 @@ int main()
         { test_init, "test_init" },
         { test_read_write, "test_read_write" },
         { test_poll, "test_poll" },
+        { test_spsc_init, "test_spsc_init" },
+        { test_spsc_write_isr, "test_spsc_write_isr" },
+        { test_spsc_read_write, "test_spsc_read_write" },
+        { test_spsc_poll, "test_spsc_poll" },
+        { test_reserve_commit, "test_reserve_commit" },
+        { test_read_until, "test_read_until" },
+        { test_readv_writev, "test_readv_writev" },
+        { test_benchmark, "test_benchmark" },
         { NULL, NULL }
     };
 
@@ -0,0 +1,140 @@
+/**
+ * @file main.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+/* The ready queue with THRD_READY_QUEUE_SHIFT set to 2, four
+   priorities per level. */
+
+#define ORDER_THRDS_MAX 8
+
+static THRD_STACK(order_stacks[ORDER_THRDS_MAX], 512);
+static volatile int order[ORDER_THRDS_MAX];
+static volatile int order_length;
+
+static void *order_entry(void *arg_p)
+{
+    thrd_set_name("order");
+    thrd_suspend(NULL);
+    order[order_length++] = (int)(uintptr_t)arg_p;
+
+    return (NULL);
+}
+
+/**
+ * Spawn one thread per given priority and resume them all at once,
+ * the last one first. Then check that they run in expected order.
+ */
+static int run_in_order(struct harness_t *harness_p,
+                        const int *prios_p,
+                        const int *expected_p,
+                        int length)
+{
+    struct thrd_t *thrds[ORDER_THRDS_MAX];
+    int i;
+
+    for (i = 0; i < length; i++) {
+        thrds[i] = thrd_spawn(order_entry,
+                              (void *)(uintptr_t)i,
+                              prios_p[i],
+                              order_stacks[i],
+                              sizeof(order_stacks[i]));
+        BTASSERT(thrds[i] != NULL);
+#if THRD_NCPUS > 1
+        /* Only the order on one cpu is defined. */
+        BTASSERT(thrd_set_cpu(thrds[i], 0) == 0);
+#endif
+    }
+
+    /* Let the threads suspend themselves. */
+    thrd_usleep(20000);
+
+    order_length = 0;
+
+    sys_lock();
+
+    for (i = length - 1; i >= 0; i--) {
+        thrd_resume_isr(thrds[i], 0);
+    }
+
+    sys_unlock();
+
+    for (i = 0; i < length; i++) {
+        BTASSERT(thrd_wait(thrds[i], NULL) == 0);
+    }
+
+    BTASSERT(order_length == length);
+
+    for (i = 0; i < length; i++) {
+        BTASSERT(order[i] == expected_p[i],
+                 "%d: %d != %d",
+                 i,
+                 order[i],
+                 expected_p[i]);
+    }
+
+    return (0);
+}
+
+static int test_fifo(struct harness_t *harness_p)
+{
+    static const int prios[] = { 41, 41, 41, 41 };
+    static const int expected[] = { 3, 2, 1, 0 };
+
+    return (run_in_order(harness_p, prios, expected, membersof(prios)));
+}
+
+static int test_levels(struct harness_t *harness_p)
+{
+    /* Levels in both bitmap words. */
+    static const int prios[] = { 1, 126, -33, 31, 96, -96, 64, 32 };
+    static const int expected[] = { 5, 2, 0, 3, 7, 6, 4, 1 };
+
+    return (run_in_order(harness_p, prios, expected, membersof(prios)));
+}
+
+static int test_shared_level(struct harness_t *harness_p)
+{
+    /* Priorities 40 to 43 share a level, and are kept in priority
+       order within it. */
+    static const int prios[] = { 43, 40, 42, 41, 41 };
+    static const int expected[] = { 1, 4, 3, 2, 0 };
+
+    return (run_in_order(harness_p, prios, expected, membersof(prios)));
+}
+
+int main()
+{
+    struct harness_t harness;
+    struct harness_testcase_t harness_testcases[] = {
+        { test_fifo, "test_fifo" },
+        { test_levels, "test_levels" },
+        { test_shared_level, "test_shared_level" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+    uart_module_init();
+
+    harness_init(&harness);
+    harness_run(&harness, harness_testcases);
+
+    return (0);
+}
@@ -20,11 +20,31 @@
 
 #include "simba.h"
 
+#if defined(ARCH_LINUX)
+#    define CONTENTION_ROUNDS 256
+#else
+#    define CONTENTION_ROUNDS 16
+#endif
+
+#define WAITERS_MAX 4
+
 static struct sem_t sem;
 static struct sem_t sem2;
+static struct sem_t sem3;
 
 static THRD_STACK(t0_stack, 224);
 static THRD_STACK(t1_stack, 224);
+static THRD_STACK(waiter_stacks[WAITERS_MAX], 256);
+
+/* Ids of the waiting threads in the order they got the semaphore. */
+static int order[WAITERS_MAX];
+static int order_length;
+
+/* Contention statistics. */
+static uint32_t wait_ns[WAITERS_MAX * CONTENTION_ROUNDS];
+static int wait_length;
+static int grants;
+static int overtaken_max;
 static void *entry(void *arg_p)
 {
     sem_put(&sem2, 1);
@@ -74,11 +94,182 @@ static int test_all(struct harness_t *harness_p)
     return (0);
 }
 
+static void *order_entry(void *arg_p)
+{
+    thrd_set_name("order");
+
+    sem_get(&sem3, NULL);
+    order[order_length++] = (int)(uintptr_t)arg_p;
+
+    return (NULL);
+}
+
+/**
+ * Spawn one waiter per priority in given list, one at a time so they
+ * start waiting in list order. Then put the semaphore once per waiter.
+ */
+static int wait_in_order(const int *prios_p, int length)
+{
+    int i;
+    struct thrd_t *thrds[WAITERS_MAX];
+
+    order_length = 0;
+
+    for (i = 0; i < length; i++) {
+        thrds[i] = thrd_spawn(order_entry,
+                              (void *)(uintptr_t)i,
+                              prios_p[i],
+                              waiter_stacks[i],
+                              sizeof(waiter_stacks[i]));
+        thrd_usleep(1000);
+    }
+
+    for (i = 0; i < length; i++) {
+        sem_put(&sem3, 1);
+        thrd_usleep(1000);
+    }
+
+    for (i = 0; i < length; i++) {
+        thrd_wait(thrds[i], NULL);
+    }
+
+    return (order_length);
+}
+
+static int test_fifo_order(struct harness_t *harness_p)
+{
+    int i;
+    static const int prios[WAITERS_MAX] = { -10, -20, -10, -30 };
+
+    BTASSERT(sem_init(&sem3, 0) == 0);
+
+    /* Waiters are served first in, first out regardless of their
+       priorities. */
+    BTASSERT(wait_in_order(prios, WAITERS_MAX) == WAITERS_MAX);
+
+    for (i = 0; i < WAITERS_MAX; i++) {
+        BTASSERT(order[i] == i, "order[%d] = %d", i, order[i]);
+    }
+
+    return (0);
+}
+
+static int test_prio_order(struct harness_t *harness_p)
+{
+    static const int prios[WAITERS_MAX] = { -10, -20, -10, -30 };
+
+    BTASSERT(sem_init(&sem3, 0) == 0);
+    BTASSERT(sem_set_order(&sem3, SEM_ORDER_PRIO) == 0);
+
+    /* Highest priority first, and first in, first out among waiters
+       with equal priority. */
+    BTASSERT(wait_in_order(prios, WAITERS_MAX) == WAITERS_MAX);
+    BTASSERT(order[0] == 3);
+    BTASSERT(order[1] == 1);
+    BTASSERT(order[2] == 0);
+    BTASSERT(order[3] == 2);
+
+    return (0);
+}
+
+static void *contention_entry(void *arg_p)
+{
+    int i, requested;
+    uint64_t start;
+
+    thrd_set_name("contention");
+
+    for (i = 0; i < CONTENTION_ROUNDS; i++) {
+        requested = grants;
+        start = time_get_ns();
+        sem_get(&sem3, NULL);
+        wait_ns[wait_length++] = (uint32_t)(time_get_ns() - start);
+
+        /* Number of other threads that got the semaphore while this
+           thread was waiting for it. */
+        if (grants - requested > overtaken_max) {
+            overtaken_max = (grants - requested);
+        }
+
+        grants++;
+
+        /* Let the other threads queue up before putting the
+           semaphore. */
+        thrd_yield();
+        sem_put(&sem3, 1);
+    }
+
+    return (NULL);
+}
+
+static uint32_t percentile(int percent)
+{
+    return (wait_ns[((wait_length - 1) * percent) / 100]);
+}
+
+static int test_wake_latency(struct harness_t *harness_p)
+{
+    int i, j;
+    uint32_t value;
+    struct thrd_t *thrds[WAITERS_MAX];
+
+    BTASSERT(sem_init(&sem3, 1) == 0);
+    wait_length = 0;
+    grants = 0;
+    overtaken_max = 0;
+
+    for (i = 0; i < WAITERS_MAX; i++) {
+        thrds[i] = thrd_spawn(contention_entry,
+                              NULL,
+                              10,
+                              waiter_stacks[i],
+                              sizeof(waiter_stacks[i]));
+    }
+
+    for (i = 0; i < WAITERS_MAX; i++) {
+        thrd_wait(thrds[i], NULL);
+    }
+
+    /* Insertion sort of the wait times. */
+    for (i = 1; i < wait_length; i++) {
+        value = wait_ns[i];
+
+        for (j = i; (j > 0) && (wait_ns[j - 1] > value); j--) {
+            wait_ns[j] = wait_ns[j - 1];
+        }
+
+        wait_ns[j] = value;
+    }
+
+    std_printf(FSTR("%d threads, %d gets: wait time p50 %lu ns, "
+                    "p90 %lu ns, p99 %lu ns, max %lu ns, "
+                    "max overtaken %d\r\n"),
+               WAITERS_MAX,
+               wait_length,
+               (unsigned long)percentile(50),
+               (unsigned long)percentile(90),
+               (unsigned long)percentile(99),
+               (unsigned long)wait_ns[wait_length - 1],
+               overtaken_max);
+
+    /* A waiter is never overtaken by a thread that started waiting
+       after it. */
+    BTASSERT(wait_length == WAITERS_MAX * CONTENTION_ROUNDS);
+    BTASSERT(overtaken_max <= WAITERS_MAX - 1,
+             "overtaken_max = %d",
+             overtaken_max);
+
+    return (0);
+}
+
 int main()
 {
     struct harness_t harness;
     struct harness_testcase_t harness_testcases[] = {
         { test_all, "test_all" },
+        { test_fifo_order, "test_fifo_order" },
+        { test_prio_order, "test_prio_order" },
+        { test_wake_latency, "test_wake_latency" },
         { NULL, NULL }
     };
 
@@ -76,7 +76,7 @@ static struct shell_args_t shell_args = {
     .password_p = "pannkaka"
 };
 
-#define BUFFER_SIZE 512
+#define BUFFER_SIZE 1024
 
 static int chout_read_until(char *buf_p,
                             const char *pattern)
@@ -247,7 +247,7 @@ static int test_all(struct harness_t *harness_p)
                              "00000000004efee6b839\r\n"
                              "/fie                                                 "
                              "00000000000000000001\r\n"
-                             "/kernel/log/discarded                                "
+                             "/kernel/pool/alloc_failures                          "
                              "00000000000000000000\r\n"
                              "$ ")) == 0, "%s", buf);
 #endif
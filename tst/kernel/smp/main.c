@@ -0,0 +1,349 @@
+/**
+ * @file main.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+/* Number of busy threads in the work stealing test. */
+#define STEAL_THREADS 4
+
+/* Number of stages and items in the pipeline benchmark, and the busy
+   work each stage does per item, in nanoseconds. */
+#define PIPELINE_STAGES 4
+#define PIPELINE_ITEMS 2000
+#define PIPELINE_WORK_NS 20000
+
+/* Number of independent producer/consumer pairs in the contention
+   benchmark, and the number of bytes each pair transfers in
+   chunks. */
+#define PAIRS 4
+#define PAIR_BYTES 400000
+#define PAIR_CHUNK_SIZE 16
+
+static THRD_STACK(pinned_stack, 256);
+static THRD_STACK(pair_stacks[2 * PAIRS], 512);
+static THRD_STACK(stage_stacks[PIPELINE_STAGES], 256);
+
+static int pinned_cpu;
+
+static struct queue_t pipeline_queues[PIPELINE_STAGES];
+static uint32_t pipeline_bufs[PIPELINE_STAGES][8];
+static volatile int pipeline_out_of_order;
+
+static struct queue_t pair_queues[PAIRS];
+static char pair_bufs[PAIRS][256];
+
+static void busy_wait_ns(uint64_t ns)
+{
+    uint64_t start;
+
+    start = time_get_ns();
+
+    while ((time_get_ns() - start) < ns);
+}
+
+static void *pinned_entry(void *arg_p)
+{
+    /* Move to the last cpu. */
+    if (thrd_set_cpu(thrd_self(), THRD_NCPUS - 1) == 0) {
+        pinned_cpu = thrd_get_cpu();
+    }
+
+    return (NULL);
+}
+
+/**
+ * Read an item from the previous stage, work on it and pass it on to
+ * the next stage. The last stage writes to the test thread.
+ */
+static void *stage_entry(void *arg_p)
+{
+    int index = (int)(uintptr_t)arg_p;
+    uint32_t item;
+    uint32_t expected = 0;
+
+    do {
+        queue_read(&pipeline_queues[index], &item, sizeof(item));
+
+        if (item != expected) {
+            pipeline_out_of_order++;
+        }
+
+        expected++;
+        busy_wait_ns(PIPELINE_WORK_NS);
+
+        if (index < PIPELINE_STAGES - 1) {
+            queue_write(&pipeline_queues[index + 1], &item, sizeof(item));
+        }
+    } while (item != PIPELINE_ITEMS - 1);
+
+    return (NULL);
+}
+
+static int test_set_cpu(struct harness_t *harness_p)
+{
+    struct thrd_t *thrd_p;
+    int cpu;
+
+    BTASSERT(thrd_set_cpu(thrd_self(), -2) == -EINVAL);
+    BTASSERT(thrd_set_cpu(thrd_self(), THRD_NCPUS) == -EINVAL);
+
+    /* Spawn a thread that pins itself to the last cpu. */
+    pinned_cpu = -1;
+    thrd_p = thrd_spawn(pinned_entry,
+                        NULL,
+                        0,
+                        pinned_stack,
+                        sizeof(pinned_stack));
+    BTASSERT(thrd_p != NULL);
+    BTASSERT(thrd_wait(thrd_p, NULL) == 0);
+    BTASSERT(pinned_cpu == THRD_NCPUS - 1);
+
+    /* Migrate the test thread itself between the cpus. */
+    for (cpu = THRD_NCPUS - 1; cpu >= 0; cpu--) {
+        BTASSERT(thrd_set_cpu(thrd_self(), cpu) == 0);
+        BTASSERT(thrd_get_cpu() == cpu);
+    }
+
+    BTASSERT(thrd_set_cpu(thrd_self(), THRD_CPU_ANY) == 0);
+
+    return (0);
+}
+
+/* The busy threads never yield, so they can only run in parallel
+   with the test thread if there are other cpus. */
+#if THRD_NCPUS > 1
+
+static THRD_STACK(steal_stacks[STEAL_THREADS], 256);
+static int steal_cpus[STEAL_THREADS];
+static volatile int steal_done;
+
+static void *steal_entry(void *arg_p)
+{
+    int index = (int)(uintptr_t)arg_p;
+
+    /* Keep a cpu busy without giving it away so that the other
+       threads have to be stolen by idle cpus. */
+    while (steal_done == 0) {
+        steal_cpus[index] = thrd_get_cpu();
+    }
+
+    return (NULL);
+}
+
+static int test_work_stealing(struct harness_t *harness_p)
+{
+    int i;
+    int j;
+    int distinct;
+    struct thrd_t *thrds[STEAL_THREADS];
+
+    steal_done = 0;
+
+    /* All threads are spawned on the current cpu and have to be
+       stolen by the other cpus to run at the same time. */
+    for (i = 0; i < STEAL_THREADS; i++) {
+        steal_cpus[i] = -1;
+        thrds[i] = thrd_spawn(steal_entry,
+                              (void *)(uintptr_t)i,
+                              10,
+                              steal_stacks[i],
+                              sizeof(steal_stacks[i]));
+        BTASSERT(thrds[i] != NULL);
+    }
+
+    thrd_usleep(100000);
+    steal_done = 1;
+
+    for (i = 0; i < STEAL_THREADS; i++) {
+        BTASSERT(thrd_wait(thrds[i], NULL) == 0);
+    }
+
+    distinct = 0;
+
+    for (i = 0; i < STEAL_THREADS; i++) {
+        for (j = 0; j < i; j++) {
+            if (steal_cpus[j] == steal_cpus[i]) {
+                break;
+            }
+        }
+
+        if (j == i) {
+            distinct++;
+        }
+    }
+
+    std_printf(FSTR("busy threads ran on %d distinct cpu(s)\r\n"), distinct);
+
+    BTASSERT(distinct >= 2);
+
+    return (0);
+}
+
+#endif
+
+static void *producer_entry(void *arg_p)
+{
+    struct queue_t *queue_p = arg_p;
+    char buf[PAIR_CHUNK_SIZE];
+    size_t left;
+
+    memset(buf, 0, sizeof(buf));
+
+    for (left = PAIR_BYTES; left > 0; left -= sizeof(buf)) {
+        queue_write(queue_p, buf, sizeof(buf));
+    }
+
+    return (NULL);
+}
+
+static void *consumer_entry(void *arg_p)
+{
+    struct queue_t *queue_p = arg_p;
+    char buf[PAIR_CHUNK_SIZE];
+    size_t left;
+
+    for (left = PAIR_BYTES; left > 0; left -= sizeof(buf)) {
+        queue_read(queue_p, buf, sizeof(buf));
+    }
+
+    return (NULL);
+}
+
+/**
+ * Independent producer/consumer pairs, each with its own queue, that
+ * only contend for the scheduler.
+ */
+static int test_benchmark_contention(struct harness_t *harness_p)
+{
+    int i;
+    uint64_t start, elapsed;
+    struct thrd_t *thrds[2 * PAIRS];
+
+    for (i = 0; i < PAIRS; i++) {
+        BTASSERT(queue_init(&pair_queues[i],
+                            &pair_bufs[i][0],
+                            sizeof(pair_bufs[i])) == 0);
+    }
+
+    start = time_get_ns();
+
+    for (i = 0; i < PAIRS; i++) {
+        thrds[2 * i] = thrd_spawn(producer_entry,
+                                  &pair_queues[i],
+                                  10,
+                                  pair_stacks[2 * i],
+                                  sizeof(pair_stacks[2 * i]));
+        BTASSERT(thrds[2 * i] != NULL);
+        thrds[2 * i + 1] = thrd_spawn(consumer_entry,
+                                      &pair_queues[i],
+                                      10,
+                                      pair_stacks[2 * i + 1],
+                                      sizeof(pair_stacks[2 * i + 1]));
+        BTASSERT(thrds[2 * i + 1] != NULL);
+    }
+
+    for (i = 0; i < 2 * PAIRS; i++) {
+        BTASSERT(thrd_wait(thrds[i], NULL) == 0);
+    }
+
+    elapsed = (time_get_ns() - start);
+
+    std_printf(FSTR("%d cpu(s): %d pairs moved %d bytes each in %lu us, "
+                    "%lu kB/s\r\n"),
+               THRD_NCPUS,
+               PAIRS,
+               PAIR_BYTES,
+               (unsigned long)(elapsed / 1000),
+               (unsigned long)((1000000ULL * PAIRS * PAIR_BYTES) / elapsed));
+
+    return (0);
+}
+
+static int test_benchmark_pipeline(struct harness_t *harness_p)
+{
+    int i;
+    uint32_t item;
+    uint64_t start, elapsed;
+    struct thrd_t *thrds[PIPELINE_STAGES];
+
+    pipeline_out_of_order = 0;
+
+    for (i = 0; i < PIPELINE_STAGES; i++) {
+        BTASSERT(queue_init(&pipeline_queues[i],
+                            &pipeline_bufs[i][0],
+                            sizeof(pipeline_bufs[i])) == 0);
+    }
+
+    for (i = 0; i < PIPELINE_STAGES; i++) {
+        thrds[i] = thrd_spawn(stage_entry,
+                              (void *)(uintptr_t)i,
+                              10,
+                              stage_stacks[i],
+                              sizeof(stage_stacks[i]));
+        BTASSERT(thrds[i] != NULL);
+    }
+
+    start = time_get_ns();
+
+    for (item = 0; item < PIPELINE_ITEMS; item++) {
+        BTASSERT(queue_write(&pipeline_queues[0],
+                             &item,
+                             sizeof(item)) == sizeof(item));
+    }
+
+    for (i = 0; i < PIPELINE_STAGES; i++) {
+        BTASSERT(thrd_wait(thrds[i], NULL) == 0);
+    }
+
+    elapsed = (time_get_ns() - start);
+    BTASSERT(pipeline_out_of_order == 0);
+
+    std_printf(FSTR("%d cpu(s): %d items through %d stages in %lu us, "
+                    "%lu items/s\r\n"),
+               THRD_NCPUS,
+               PIPELINE_ITEMS,
+               PIPELINE_STAGES,
+               (unsigned long)(elapsed / 1000),
+               (unsigned long)((1000000000ULL * PIPELINE_ITEMS) / elapsed));
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_t harness;
+    struct harness_testcase_t harness_testcases[] = {
+        { test_set_cpu, "test_set_cpu" },
+#if THRD_NCPUS > 1
+        { test_work_stealing, "test_work_stealing" },
+#endif
+        { test_benchmark_pipeline, "test_benchmark_pipeline" },
+        { test_benchmark_contention, "test_benchmark_contention" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+    uart_module_init();
+
+    harness_init(&harness);
+    harness_run(&harness, harness_testcases);
+
+    return (0);
+}
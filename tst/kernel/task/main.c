@@ -0,0 +1,357 @@
+/**
+ * @file main.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+
+#include "simba.h"
+
+#define COUNTERS_MAX 100
+#define ROUNDS 3
+
+/* A task that counts a number of rounds. */
+struct counter_t {
+    struct task_t task;
+    int round;
+};
+
+static struct task_executor_t executor;
+static chan_t *executor_workspace[4];
+static THRD_STACK(executor_stack, 1024);
+
+static struct counter_t counters[COUNTERS_MAX];
+static int count;
+
+static struct task_t tasks[2];
+static struct sem_t done;
+static struct queue_t queue_in;
+static struct queue_t queue_out;
+static char queue_in_buf[8];
+static char queue_out_buf[8];
+static struct event_t event;
+static struct sem_t sem;
+static int order[2];
+static int order_length;
+static uint64_t sleep_start;
+static uint64_t sleep_end;
+
+static int counter_fn(struct task_t *self_p)
+{
+    struct counter_t *counter_p;
+
+    counter_p = self_p->arg_p;
+
+    TASK_BEGIN(self_p);
+
+    for (counter_p->round = 0;
+         counter_p->round < ROUNDS;
+         counter_p->round++) {
+        count++;
+        TASK_YIELD(self_p);
+    }
+
+    sem_put(&done, 1);
+
+    TASK_END(self_p);
+}
+
+static int spawner_fn(struct task_t *self_p)
+{
+    int i;
+
+    TASK_BEGIN(self_p);
+
+    /* Spawn the counters from a task. */
+    for (i = 0; i < COUNTERS_MAX; i++) {
+        task_init(&counters[i].task, counter_fn, &counters[i]);
+        task_spawn(&counters[i].task, &executor);
+    }
+
+    TASK_END(self_p);
+}
+
+static int test_start(struct harness_t *harness_p)
+{
+    BTASSERT(sem_init(&done, 0) == 0);
+    BTASSERT(task_executor_init(&executor,
+                                executor_workspace,
+                                sizeof(executor_workspace)) == 0);
+    BTASSERT(task_executor_start(&executor,
+                                 10,
+                                 executor_stack,
+                                 sizeof(executor_stack)) != NULL);
+
+    return (0);
+}
+
+static int test_yield(struct harness_t *harness_p)
+{
+    int i;
+
+    count = 0;
+
+    BTASSERT(task_init(&tasks[0], spawner_fn, NULL) == 0);
+    BTASSERT(task_spawn(&tasks[0], &executor) == 0);
+
+    for (i = 0; i < COUNTERS_MAX; i++) {
+        BTASSERT(sem_get(&done, NULL) == 0);
+    }
+
+    BTASSERT(count == COUNTERS_MAX * ROUNDS);
+
+    std_printf(FSTR("%d tasks use %d bytes\r\n"),
+               COUNTERS_MAX,
+               (int)sizeof(counters));
+
+    return (0);
+}
+
+static int echo_fn(struct task_t *self_p)
+{
+    char buf[4];
+    ssize_t size;
+
+    TASK_BEGIN(self_p);
+
+    while (1) {
+        TASK_AWAIT_CHAN(self_p, &queue_in);
+
+        size = MIN(chan_size(&queue_in), sizeof(buf));
+        chan_read(&queue_in, buf, size);
+
+        if (buf[0] == '\0') {
+            break;
+        }
+
+        chan_write(&queue_out, buf, size);
+    }
+
+    TASK_END(self_p);
+}
+
+static int test_queue(struct harness_t *harness_p)
+{
+    char buf[6];
+
+    BTASSERT(queue_init(&queue_in, queue_in_buf, sizeof(queue_in_buf)) == 0);
+    BTASSERT(queue_init(&queue_out, queue_out_buf, sizeof(queue_out_buf)) == 0);
+    BTASSERT(task_init(&tasks[0], echo_fn, NULL) == 0);
+    BTASSERT(task_spawn(&tasks[0], &executor) == 0);
+
+    /* Echoed by the task. */
+    BTASSERT(chan_write(&queue_in, "hello", 5) == 5);
+    BTASSERT(chan_read(&queue_out, buf, 5) == 5);
+    buf[5] = '\0';
+    BTASSERT(strcmp(buf, "hello") == 0);
+
+    BTASSERT(chan_write(&queue_in, "fie", 3) == 3);
+    BTASSERT(chan_read(&queue_out, buf, 3) == 3);
+    buf[3] = '\0';
+    BTASSERT(strcmp(buf, "fie") == 0);
+
+    /* Stop the task. */
+    BTASSERT(chan_write(&queue_in, "", 1) == 1);
+    thrd_usleep(1000);
+    BTASSERT(tasks[0].executor_p == NULL);
+
+    return (0);
+}
+
+static int event_fn(struct task_t *self_p)
+{
+    uint32_t mask;
+
+    TASK_BEGIN(self_p);
+
+    TASK_AWAIT_EVENT(self_p, &event, 0x2);
+
+    mask = 0x2;
+    event_read(&event, &mask, sizeof(mask));
+    order[order_length++] = mask;
+    sem_put(&done, 1);
+
+    TASK_END(self_p);
+}
+
+static int test_event(struct harness_t *harness_p)
+{
+    uint32_t mask;
+
+    order_length = 0;
+
+    BTASSERT(event_init(&event) == 0);
+    BTASSERT(task_init(&tasks[0], event_fn, NULL) == 0);
+    BTASSERT(task_spawn(&tasks[0], &executor) == 0);
+    thrd_usleep(1000);
+
+    /* Not the awaited event. */
+    mask = 0x1;
+    BTASSERT(chan_write(&event, &mask, sizeof(mask)) == sizeof(mask));
+    thrd_usleep(1000);
+    BTASSERT(order_length == 0);
+
+    mask = 0x2;
+    BTASSERT(chan_write(&event, &mask, sizeof(mask)) == sizeof(mask));
+    BTASSERT(sem_get(&done, NULL) == 0);
+    BTASSERT(order_length == 1);
+    BTASSERT(order[0] == 0x2);
+    BTASSERT(event.mask == 0x1);
+
+    return (0);
+}
+
+static int sem_fn(struct task_t *self_p)
+{
+    TASK_BEGIN(self_p);
+
+    TASK_AWAIT_SEM(self_p, &sem);
+
+    order[order_length++] = (int)(uintptr_t)self_p->arg_p;
+    sem_put(&done, 1);
+
+    TASK_END(self_p);
+}
+
+static int test_sem(struct harness_t *harness_p)
+{
+    order_length = 0;
+
+    BTASSERT(sem_init(&sem, 0) == 0);
+    BTASSERT(task_init(&tasks[0], sem_fn, (void *)1) == 0);
+    BTASSERT(task_init(&tasks[1], sem_fn, (void *)2) == 0);
+    BTASSERT(task_spawn(&tasks[0], &executor) == 0);
+    thrd_usleep(1000);
+    BTASSERT(task_spawn(&tasks[1], &executor) == 0);
+    thrd_usleep(1000);
+    BTASSERT(order_length == 0);
+
+    /* The tasks get the semaphore in the order they waited. */
+    BTASSERT(sem_put(&sem, 1) == 0);
+    BTASSERT(sem_get(&done, NULL) == 0);
+    BTASSERT(order_length == 1);
+    BTASSERT(order[0] == 1);
+
+    BTASSERT(sem_put(&sem, 1) == 0);
+    BTASSERT(sem_get(&done, NULL) == 0);
+    BTASSERT(order_length == 2);
+    BTASSERT(order[1] == 2);
+    BTASSERT(sem.count == 0);
+
+    return (0);
+}
+
+static int sleep_fn(struct task_t *self_p)
+{
+    struct time_t timeout;
+
+    TASK_BEGIN(self_p);
+
+    timeout.seconds = 0;
+    timeout.nanoseconds = 50000000;
+    sleep_start = time_get_ns();
+    TASK_SLEEP(self_p, &timeout);
+    sleep_end = time_get_ns();
+    sem_put(&done, 1);
+
+    TASK_END(self_p);
+}
+
+static int test_sleep(struct harness_t *harness_p)
+{
+    BTASSERT(task_init(&tasks[0], sleep_fn, NULL) == 0);
+    BTASSERT(task_spawn(&tasks[0], &executor) == 0);
+    BTASSERT(sem_get(&done, NULL) == 0);
+    BTASSERT(sleep_end - sleep_start >= 40000000,
+             "%lu", (unsigned long)(sleep_end - sleep_start));
+
+    return (0);
+}
+
+static int busy_fn(struct task_t *self_p)
+{
+    uint64_t start;
+
+    TASK_BEGIN(self_p);
+
+    while (sleep_start == 0) {
+        TASK_YIELD(self_p);
+    }
+
+    /* Keep the executor running while the other task sleeps. */
+    start = time_get_ns();
+
+    while (time_get_ns() - start < 300000000) {
+    }
+
+    TASK_END(self_p);
+}
+
+static int sleep_long_fn(struct task_t *self_p)
+{
+    struct time_t timeout;
+
+    TASK_BEGIN(self_p);
+
+    timeout.seconds = 0;
+    timeout.nanoseconds = 100000000;
+    sleep_start = time_get_ns();
+    TASK_SLEEP(self_p, &timeout);
+    sleep_end = time_get_ns();
+    sem_put(&done, 1);
+
+    TASK_END(self_p);
+}
+
+static int test_sleep_busy(struct harness_t *harness_p)
+{
+    sleep_start = 0;
+    BTASSERT(task_init(&tasks[0], sleep_long_fn, NULL) == 0);
+    BTASSERT(task_init(&tasks[1], busy_fn, NULL) == 0);
+    BTASSERT(task_spawn(&tasks[0], &executor) == 0);
+    BTASSERT(task_spawn(&tasks[1], &executor) == 0);
+    BTASSERT(sem_get(&done, NULL) == 0);
+
+    /* The sleeping task is ready as soon as the busy task returns. */
+    BTASSERT(sleep_end - sleep_start < 380000000,
+             "%lu", (unsigned long)(sleep_end - sleep_start));
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_t harness;
+    struct harness_testcase_t harness_testcases[] = {
+        { test_start, "test_start" },
+        { test_yield, "test_yield" },
+        { test_queue, "test_queue" },
+        { test_event, "test_event" },
+        { test_sem, "test_sem" },
+        { test_sleep, "test_sleep" },
+        { test_sleep_busy, "test_sleep_busy" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+    uart_module_init();
+
+    harness_init(&harness);
+    harness_run(&harness, harness_testcases);
+
+    return (0);
+}
@@ -20,7 +20,49 @@
 
 #include "simba.h"
 
+#if defined(ARCH_LINUX)
+#    include <signal.h>
+#    include <unistd.h>
+#    include <sys/wait.h>
+#endif
+
+#if defined(ARCH_LINUX)
+#    define BENCHMARK_THRDS_MAX 256
+#else
+#    define BENCHMARK_THRDS_MAX 16
+#endif
+
+/* Number of resumes per measurement. */
+#define BENCHMARK_RESUMES 4096
+
+/* Number of ping-pong rounds, two context switches each. */
+#define BENCHMARK_PING_PONG_ROUNDS 10000
+
+/* Number of threads spawned and joined. */
+#define BENCHMARK_SPAWN_JOINS 1000
+
+/* Stack size in the static versus dynamic spawn benchmark. */
+#define BENCHMARK_LARGE_STACK 65536
+
+/* Number of threads in the ready queue order tests. */
+#define ORDER_THRDS_MAX 8
+
 static THRD_STACK(thrd_stack, 256);
+static THRD_STACK(pong_stack, 256);
+static THRD_STACK(joiner_stacks[2], 256);
+static THRD_STACK(benchmark_stacks[BENCHMARK_THRDS_MAX], 256);
+static THRD_STACK(large_stack, BENCHMARK_LARGE_STACK);
+static THRD_STACK(edf_stacks[2], 512);
+static THRD_STACK(order_stacks[ORDER_THRDS_MAX], 512);
+static struct thrd_t *benchmark_thrds[BENCHMARK_THRDS_MAX];
+static struct thrd_t *benchmark_main_thrd_p;
+static volatile int joiners_done;
+static volatile int benchmark_pending;
+static volatile int edf_order[2];
+static volatile int edf_order_length;
+static volatile int order[ORDER_THRDS_MAX];
+static volatile int order_length;
+
 static void *thrd(void *arg_p)
 {
     thrd_set_name("resumer");
@@ -30,6 +72,96 @@ static void *thrd(void *arg_p)
     return (NULL);
 }
 
+static void *order_entry(void *arg_p)
+{
+    thrd_set_name("order");
+    thrd_suspend(NULL);
+    order[order_length++] = (int)(uintptr_t)arg_p;
+
+    return (NULL);
+}
+
+/**
+ * Spawn one thread per given priority and resume them all at once,
+ * the last one first. Then check that they run in expected order.
+ */
+static int run_in_order(struct harness_t *harness_p,
+                        const int *prios_p,
+                        const int *expected_p,
+                        int length)
+{
+    struct thrd_t *thrds[ORDER_THRDS_MAX];
+    int i;
+
+    for (i = 0; i < length; i++) {
+        thrds[i] = thrd_spawn(order_entry,
+                              (void *)(uintptr_t)i,
+                              prios_p[i],
+                              order_stacks[i],
+                              sizeof(order_stacks[i]));
+        BTASSERT(thrds[i] != NULL);
+#if THRD_NCPUS > 1
+        /* Only the order on one cpu is defined. */
+        BTASSERT(thrd_set_cpu(thrds[i], 0) == 0);
+#endif
+    }
+
+    /* Let the threads suspend themselves. */
+    thrd_usleep(20000);
+
+    order_length = 0;
+
+    sys_lock();
+
+    for (i = length - 1; i >= 0; i--) {
+        thrd_resume_isr(thrds[i], 0);
+    }
+
+    sys_unlock();
+
+    for (i = 0; i < length; i++) {
+        BTASSERT(thrd_wait(thrds[i], NULL) == 0);
+    }
+
+    BTASSERT(order_length == length);
+
+    for (i = 0; i < length; i++) {
+        BTASSERT(order[i] == expected_p[i],
+                 "%d: %d != %d",
+                 i,
+                 order[i],
+                 expected_p[i]);
+    }
+
+    return (0);
+}
+
+static int test_ready_fifo(struct harness_t *harness_p)
+{
+    static const int prios[] = { 30, 30, 30, 30 };
+    static const int expected[] = { 3, 2, 1, 0 };
+
+    return (run_in_order(harness_p, prios, expected, membersof(prios)));
+}
+
+static int test_ready_priority(struct harness_t *harness_p)
+{
+    /* Levels in six of the eight bitmap words. */
+    static const int prios[] = { 1, 126, -33, 31, 96, -96, 64, 32 };
+    static const int expected[] = { 5, 2, 0, 3, 7, 6, 4, 1 };
+
+    return (run_in_order(harness_p, prios, expected, membersof(prios)));
+}
+
+static int test_ready_shared_level(struct harness_t *harness_p)
+{
+    /* All in one level if THRD_READY_QUEUE_SHIFT is 2. */
+    static const int prios[] = { 43, 40, 42, 41, 41 };
+    static const int expected[] = { 1, 4, 3, 2, 0 };
+
+    return (run_in_order(harness_p, prios, expected, membersof(prios)));
+}
+
 static int test_suspend_resume(struct harness_t *harness_p)
 {
     int err;
@@ -45,16 +177,801 @@ static int test_suspend_resume(struct harness_t *harness_p)
     BTASSERT(err == 3, "err = %d", err);
 
     /* Wait for the spawned thread to terminate. */
-    BTASSERT(thrd_wait(thrd_p) == 0);
+    BTASSERT(thrd_wait(thrd_p, NULL) == 0);
+
+    return (0);
+}
+
+static void *suspender_entry(void *arg_p)
+{
+    thrd_set_name("suspender");
+
+    thrd_suspend(NULL);
+
+    return (NULL);
+}
+
+static void *joiner_entry(void *arg_p)
+{
+    thrd_set_name("joiner");
+
+    if (thrd_wait(arg_p, NULL) == 0) {
+        joiners_done++;
+    }
+
+    return (NULL);
+}
+
+static int test_wait_timeout(struct harness_t *harness_p)
+{
+    struct thrd_t *thrd_p;
+    struct time_t timeout;
+
+    thrd_p = thrd_spawn(suspender_entry,
+                        NULL,
+                        10,
+                        thrd_stack,
+                        sizeof(thrd_stack));
+    BTASSERT(thrd_p != NULL);
+
+    /* The thread does not terminate until resumed. */
+    timeout.seconds = 0;
+    timeout.nanoseconds = 0;
+    BTASSERT(thrd_wait(thrd_p, &timeout) == -ETIMEDOUT);
+
+    timeout.nanoseconds = 20000000;
+    BTASSERT(thrd_wait(thrd_p, &timeout) == -ETIMEDOUT);
+
+    /* Terminate the thread and wait for it. */
+    BTASSERT(thrd_resume(thrd_p, 0) == 0);
+    BTASSERT(thrd_wait(thrd_p, &timeout) == 0);
+
+    /* Waiting for a terminated thread returns immediately. */
+    timeout.nanoseconds = 0;
+    BTASSERT(thrd_wait(thrd_p, &timeout) == 0);
+
+    return (0);
+}
+
+static int test_wait_multiple_joiners(struct harness_t *harness_p)
+{
+    int i;
+    struct thrd_t *thrd_p;
+
+    thrd_p = thrd_spawn(suspender_entry,
+                        NULL,
+                        10,
+                        thrd_stack,
+                        sizeof(thrd_stack));
+    BTASSERT(thrd_p != NULL);
+
+    joiners_done = 0;
+
+    for (i = 0; i < membersof(joiner_stacks); i++) {
+        BTASSERT(thrd_spawn(joiner_entry,
+                            thrd_p,
+                            5,
+                            joiner_stacks[i],
+                            sizeof(joiner_stacks[i])) != NULL);
+    }
+
+    /* Let the threads start waiting. */
+    thrd_usleep(20000);
+    BTASSERT(joiners_done == 0);
+
+    /* All joiners are woken when the thread terminates. */
+    BTASSERT(thrd_resume(thrd_p, 0) == 0);
+    BTASSERT(thrd_wait(thrd_p, NULL) == 0);
+    thrd_usleep(20000);
+    BTASSERT(joiners_done == membersof(joiner_stacks),
+             "joiners_done = %d",
+             joiners_done);
+
+    return (0);
+}
+
+/**
+ * Monotonic time in nanoseconds.
+ */
+static long long benchmark_time_ns(void)
+{
+#if defined(ARCH_LINUX)
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (1000000000LL * now.tv_sec + now.tv_nsec);
+#else
+    struct time_t now;
+
+    time_get(&now);
+
+    return (1000000000LL * now.seconds + now.nanoseconds);
+#endif
+}
+
+static void *benchmark_entry(void *arg_p)
+{
+    thrd_set_name("benchmark");
+
+    while (1) {
+        thrd_suspend(NULL);
+
+        /* The last resumed thread resumes the main thread. */
+        benchmark_pending--;
+
+        if (benchmark_pending == 0) {
+            thrd_resume(benchmark_main_thrd_p, 0);
+        }
+    }
+
+    return (NULL);
+}
+
+static int test_benchmark_resume(struct harness_t *harness_p)
+{
+    int i, n, round, rounds;
+    long long start, elapsed;
+
+    benchmark_main_thrd_p = thrd_self();
+
+    /* All benchmark threads have the same priority, lower than the
+       main thread. */
+    for (i = 0; i < BENCHMARK_THRDS_MAX; i++) {
+        benchmark_thrds[i] = thrd_spawn(benchmark_entry,
+                                        NULL,
+                                        20,
+                                        benchmark_stacks[i],
+                                        sizeof(benchmark_stacks[i]));
+        BTASSERT(benchmark_thrds[i] != NULL);
+    }
+
+    /* Let all benchmark threads run and suspend themselves. */
+    thrd_usleep(50000);
+
+    /* Resume 1..BENCHMARK_THRDS_MAX threads with the system lock
+       taken, as a timer callback or an isr would. The cost per resume
+       should not depend on the number of ready threads. */
+    for (n = 1; n <= BENCHMARK_THRDS_MAX; n *= 2) {
+        rounds = (BENCHMARK_RESUMES / n);
+        elapsed = 0;
+
+        for (round = 0; round < rounds; round++) {
+            benchmark_pending = n;
+
+            sys_lock();
+            start = benchmark_time_ns();
+
+            for (i = 0; i < n; i++) {
+                thrd_resume_isr(benchmark_thrds[i], 0);
+            }
+
+            elapsed += (benchmark_time_ns() - start);
+            sys_unlock();
+
+            /* Wait for the resumed threads to suspend again. */
+            BTASSERT(thrd_suspend(NULL) == 0);
+        }
+
+        std_printf(FSTR("%3d ready threads: %5lu ns per resume\r\n"),
+                   n,
+                   (unsigned long)(elapsed / (n * rounds)));
+    }
+
+    return (0);
+}
+
+static void *pong_entry(void *arg_p)
+{
+    thrd_set_name("pong");
+
+    while (1) {
+        thrd_suspend(NULL);
+        thrd_resume(arg_p, 0);
+    }
+
+    return (NULL);
+}
+
+static int test_benchmark_ping_pong(struct harness_t *harness_p)
+{
+    int i;
+    struct thrd_t *pong_p;
+    long long start, elapsed;
+
+    pong_p = thrd_spawn(pong_entry,
+                        thrd_self(),
+                        0,
+                        pong_stack,
+                        sizeof(pong_stack));
+    BTASSERT(pong_p != NULL);
+
+    /* Let the pong thread suspend itself. */
+    thrd_usleep(50000);
+
+    start = benchmark_time_ns();
+
+    for (i = 0; i < BENCHMARK_PING_PONG_ROUNDS; i++) {
+        thrd_resume(pong_p, 0);
+        BTASSERT(thrd_suspend(NULL) == 0);
+    }
+
+    elapsed = (benchmark_time_ns() - start);
+
+    std_printf(FSTR("thread port: "
+#if defined(ARCH_LINUX)
+#    if defined(THRD_PORT_PTHREAD)
+                    "pthread"
+#    else
+                    "ucontext"
+#    endif
+#elif defined(ARCH_ARM)
+                    "arm"
+#elif defined(ARCH_AVR)
+                    "avr"
+#else
+                    "unknown"
+#endif
+                    "\r\n"
+                    "%d context switches in %lu us, %lu ns per switch\r\n"),
+               2 * BENCHMARK_PING_PONG_ROUNDS,
+               (unsigned long)(elapsed / 1000),
+               (unsigned long)(elapsed / (2 * BENCHMARK_PING_PONG_ROUNDS)));
+
+    return (0);
+}
+
+static void *spawn_join_entry(void *arg_p)
+{
+    return (NULL);
+}
+
+static int test_benchmark_spawn_join(struct harness_t *harness_p)
+{
+    int i;
+    struct thrd_t *thrd_p;
+    long long start, elapsed;
+
+    start = benchmark_time_ns();
+
+    /* Spawn short lived threads on the same stack, one at a time. */
+    for (i = 0; i < BENCHMARK_SPAWN_JOINS; i++) {
+        thrd_p = thrd_spawn(spawn_join_entry,
+                            NULL,
+                            10,
+                            thrd_stack,
+                            sizeof(thrd_stack));
+        BTASSERT(thrd_p != NULL);
+        BTASSERT(thrd_wait(thrd_p, NULL) == 0);
+    }
+
+    elapsed = (benchmark_time_ns() - start);
+
+    std_printf(FSTR("%d spawns and joins in %lu us, %lu ns per thread\r\n"),
+               BENCHMARK_SPAWN_JOINS,
+               (unsigned long)(elapsed / 1000),
+               (unsigned long)(elapsed / BENCHMARK_SPAWN_JOINS));
+
+    return (0);
+}
+
+static void *dynamic_entry(void *arg_p)
+{
+    volatile char buf[128];
+
+    memset((char *)buf, 1, sizeof(buf));
+    *(int *)arg_p = buf[0];
+
+    return (NULL);
+}
+
+static int test_spawn_dynamic(struct harness_t *harness_p)
+{
+    struct thrd_t *thrd_p;
+    struct thrd_t *thrd2_p;
+    int value;
+
+    value = 0;
+    thrd_p = thrd_spawn_dynamic(dynamic_entry, &value, 10, 1000);
+    BTASSERT(thrd_p != NULL);
+    BTASSERT(thrd_wait(thrd_p, NULL) == 0);
+    BTASSERT(value == 1);
+
+    /* The stack of the terminated thread is recycled. */
+    value = 0;
+    thrd2_p = thrd_spawn_dynamic(dynamic_entry, &value, 10, 1000);
+    BTASSERT(thrd2_p == thrd_p);
+    BTASSERT(thrd_wait(thrd2_p, NULL) == 0);
+    BTASSERT(value == 1);
+
+    /* Too big stack. */
+    BTASSERT(thrd_spawn_dynamic(dynamic_entry, &value, 10, 1L << 20) == NULL);
 
     return (0);
 }
 
+#if defined(ARCH_LINUX) && !defined(THRD_PORT_PTHREAD)
+
+static int recurse(int depth)
+{
+    volatile char buf[256];
+
+    buf[0] = depth;
+
+    if (depth == 0) {
+        return (buf[0]);
+    }
+
+    return (recurse(depth - 1) + buf[0]);
+}
+
+static void *overflow_entry(void *arg_p)
+{
+    recurse(1 << 20);
+
+    return (NULL);
+}
+
+static int test_stack_overflow(struct harness_t *harness_p)
+{
+    pid_t pid;
+    int status;
+
+    /* Overflow a dynamic stack in a child process, which is killed
+       when it hits the guard page. */
+    pid = fork();
+    BTASSERT(pid >= 0);
+
+    if (pid == 0) {
+        thrd_wait(thrd_spawn_dynamic(overflow_entry, NULL, 10, 1000), NULL);
+        _exit(0);
+    }
+
+    BTASSERT(waitpid(pid, &status, 0) == pid);
+    BTASSERT(WIFSIGNALED(status));
+    BTASSERT(WTERMSIG(status) == SIGSEGV);
+
+    return (0);
+}
+
+#endif
+
+static int test_benchmark_spawn_dynamic(struct harness_t *harness_p)
+{
+    int i;
+    struct thrd_t *thrd_p;
+    long long start, static_elapsed, dynamic_elapsed;
+
+    /* A static stack is filled with a pattern on each spawn. */
+    start = benchmark_time_ns();
+
+    for (i = 0; i < BENCHMARK_SPAWN_JOINS; i++) {
+        thrd_p = thrd_spawn(spawn_join_entry,
+                            NULL,
+                            10,
+                            large_stack,
+                            sizeof(large_stack));
+        BTASSERT(thrd_p != NULL);
+        BTASSERT(thrd_wait(thrd_p, NULL) == 0);
+    }
+
+    static_elapsed = (benchmark_time_ns() - start);
+
+    start = benchmark_time_ns();
+
+    for (i = 0; i < BENCHMARK_SPAWN_JOINS; i++) {
+        thrd_p = thrd_spawn_dynamic(spawn_join_entry,
+                                    NULL,
+                                    10,
+                                    BENCHMARK_LARGE_STACK);
+        BTASSERT(thrd_p != NULL);
+        BTASSERT(thrd_wait(thrd_p, NULL) == 0);
+    }
+
+    dynamic_elapsed = (benchmark_time_ns() - start);
+
+    std_printf(FSTR("%d byte stack: static spawn and join %lu ns, "
+                    "dynamic %lu ns per thread\r\n"),
+               BENCHMARK_LARGE_STACK,
+               (unsigned long)(static_elapsed / BENCHMARK_SPAWN_JOINS),
+               (unsigned long)(dynamic_elapsed / BENCHMARK_SPAWN_JOINS));
+
+    return (0);
+}
+
+static int test_cpu_usage(struct harness_t *harness_p)
+{
+    int i;
+    char buf[64];
+    long long start;
+
+    /* Update the cpu usage often. */
+    strcpy(buf, "/kernel/thrd/monitor/set_period_ms 50");
+    BTASSERT(fs_call(buf, NULL, sys_get_stdout()) == 0);
+
+    /* Keep the cpu busy until the monitor thread has measured it. The
+       monitor thread adopts the new period when its current period
+       ends. */
+    for (i = 0; i < 50; i++) {
+        start = benchmark_time_ns();
+
+        while ((benchmark_time_ns() - start) < 100000000LL);
+
+        thrd_usleep(10000);
+
+        if (thrd_self()->cpu.usage > 50.0f) {
+            break;
+        }
+    }
+
+    std_printf(FSTR("main thread cpu usage: %d%%\r\n"),
+               (int)thrd_self()->cpu.usage);
+
+#if defined(ARCH_LINUX) || defined(ARCH_ARM)
+    BTASSERT(thrd_self()->cpu.usage > 50.0f);
+#endif
+
+    strcpy(buf, "/kernel/thrd/monitor/set_period_ms 2000");
+    BTASSERT(fs_call(buf, NULL, sys_get_stdout()) == 0);
+
+    return (0);
+}
+
+static void time_set_ms(struct time_t *time_p, int ms)
+{
+    time_p->seconds = (ms / 1000);
+    time_p->nanoseconds = (1000000L * (ms % 1000));
+}
+
+static void *edf_admission_entry(void *arg_p)
+{
+    struct thrd_edf_t edf;
+    struct time_t period, wcet;
+    int *res_p;
+
+    thrd_set_name("edf_admission");
+    res_p = arg_p;
+
+    /* Run on the same cpu as the main thread. */
+    thrd_set_cpu(thrd_self(), res_p[0]);
+    time_set_ms(&period, 10);
+
+    /* 60% + 50% is too much. */
+    time_set_ms(&wcet, 5);
+    res_p[0] = thrd_edf_start(&edf, &period, &period, &wcet);
+
+    /* 60% + 40% is ok. */
+    time_set_ms(&wcet, 4);
+    res_p[1] = thrd_edf_start(&edf, &period, &period, &wcet);
+
+    if (res_p[1] == 0) {
+        thrd_edf_stop();
+    }
+
+    return (NULL);
+}
+
+static int test_edf_admission(struct harness_t *harness_p)
+{
+    struct thrd_edf_t edf;
+    struct time_t period, wcet;
+    struct thrd_t *thrd_p;
+    int res[2];
+
+    time_set_ms(&period, 10);
+    time_set_ms(&wcet, 6);
+    BTASSERT(thrd_edf_start(&edf, &period, &period, &wcet) == 0);
+    BTASSERT(edf.utilization == (6 * 65536 / 10));
+
+    /* Already an EDF thread. */
+    BTASSERT(thrd_edf_start(&edf, &period, &period, &wcet) == -EBUSY);
+
+#if THRD_NCPUS > 1
+    /* Bound to its cpu. */
+    BTASSERT(thrd_set_cpu(thrd_self(), THRD_CPU_ANY) == -EBUSY);
+#endif
+
+    res[0] = edf.cpu;
+    thrd_p = thrd_spawn(edf_admission_entry,
+                        res,
+                        10,
+                        edf_stacks[0],
+                        sizeof(edf_stacks[0]));
+    BTASSERT(thrd_p != NULL);
+    BTASSERT(thrd_wait(thrd_p, NULL) == 0);
+    BTASSERT(res[0] == -EBUSY, "res[0] = %d", res[0]);
+    BTASSERT(res[1] == 0, "res[1] = %d", res[1]);
+
+    BTASSERT(thrd_edf_stop() == 0);
+    BTASSERT(thrd_edf_stop() == -EINVAL);
+    BTASSERT(thrd_edf_wait() == -EINVAL);
+
+    /* All utilization is released. */
+    time_set_ms(&wcet, 10);
+    BTASSERT(thrd_edf_start(&edf, &period, &period, &wcet) == 0);
+    BTASSERT(thrd_edf_stop() == 0);
+
+    return (0);
+}
+
+static void *edf_order_entry(void *arg_p)
+{
+    struct thrd_edf_t edf;
+    struct time_t period, deadline, wcet;
+    int ms;
+
+    thrd_set_name("edf_order");
+    ms = (int)(uintptr_t)arg_p;
+
+    thrd_set_cpu(thrd_self(), 0);
+    time_set_ms(&period, 1000);
+    time_set_ms(&deadline, ms);
+    time_set_ms(&wcet, 1);
+    thrd_edf_start(&edf, &period, &deadline, &wcet);
+
+    /* Wait for the main thread to resume both threads. */
+    thrd_suspend(NULL);
+    edf_order[edf_order_length++] = ms;
+    thrd_edf_stop();
+
+    return (NULL);
+}
+
+static int test_edf_order(struct harness_t *harness_p)
+{
+    struct thrd_t *late_p, *early_p;
+
+    edf_order_length = 0;
+    late_p = thrd_spawn(edf_order_entry,
+                        (void *)(uintptr_t)500,
+                        10,
+                        edf_stacks[0],
+                        sizeof(edf_stacks[0]));
+    early_p = thrd_spawn(edf_order_entry,
+                         (void *)(uintptr_t)200,
+                         10,
+                         edf_stacks[1],
+                         sizeof(edf_stacks[1]));
+    BTASSERT(late_p != NULL);
+    BTASSERT(early_p != NULL);
+    thrd_usleep(50000);
+
+    /* The thread with the earliest deadline runs first, even if
+       resumed last. */
+    sys_lock();
+    thrd_resume_isr(late_p, 0);
+    thrd_resume_isr(early_p, 0);
+    sys_unlock();
+
+    BTASSERT(thrd_wait(late_p, NULL) == 0);
+    BTASSERT(thrd_wait(early_p, NULL) == 0);
+    BTASSERT(edf_order_length == 2);
+    BTASSERT(edf_order[0] == 200, "%d", edf_order[0]);
+    BTASSERT(edf_order[1] == 500, "%d", edf_order[1]);
+
+    return (0);
+}
+
+static int test_edf_deadline_miss(struct harness_t *harness_p)
+{
+    struct thrd_edf_t edf;
+    struct time_t period, wcet;
+    char buf[32];
+
+    time_set_ms(&period, 100);
+    time_set_ms(&wcet, 10);
+    BTASSERT(thrd_edf_start(&edf, &period, &period, &wcet) == 0);
+
+    /* The first job takes longer than its deadline. */
+    thrd_usleep(150000);
+    BTASSERT(thrd_edf_wait() == -ETIMEDOUT);
+
+    /* The second job was released during the first job, and makes
+       its deadline. */
+    BTASSERT(thrd_edf_wait() == 0);
+    BTASSERT(edf.jobs == 2);
+    BTASSERT(edf.misses == 1);
+
+    strcpy(buf, "/kernel/thrd/edf/list");
+    BTASSERT(fs_call(buf, NULL, sys_get_stdout()) == 0);
+
+    BTASSERT(thrd_edf_stop() == 0);
+
+    return (0);
+}
+
+/**
+ * Run for given number of microseconds without suspending.
+ */
+static void busy_wait_us(long useconds)
+{
+    long long start;
+
+    start = benchmark_time_ns();
+
+    while ((benchmark_time_ns() - start) < 1000LL * useconds);
+}
+
+static int test_edf_deadline_miss_busy(struct harness_t *harness_p)
+{
+    struct thrd_edf_t edf;
+    struct time_t period, wcet;
+
+    time_set_ms(&period, 100);
+    time_set_ms(&wcet, 10);
+    BTASSERT(thrd_edf_start(&edf, &period, &period, &wcet) == 0);
+
+    /* The first job keeps the cpu past its deadline. */
+    busy_wait_us(150000);
+    BTASSERT(thrd_edf_wait() == -ETIMEDOUT);
+    BTASSERT(thrd_edf_wait() == 0);
+    BTASSERT(edf.jobs == 2);
+    BTASSERT(edf.misses == 1);
+
+    BTASSERT(thrd_edf_stop() == 0);
+
+    return (0);
+}
+
+static int test_periodic(struct harness_t *harness_p)
+{
+    struct thrd_periodic_t periodic;
+    struct time_t period;
+    sys_tick_t start;
+    char buf[32];
+    int i;
+
+    BTASSERT(thrd_periodic_wait() == -EINVAL);
+
+    time_set_ms(&period, 0);
+    BTASSERT(thrd_periodic_start(&periodic, &period) == -EINVAL);
+
+    time_set_ms(&period, 50);
+    start = sys.tick;
+    BTASSERT(thrd_periodic_start(&periodic, &period) == 0);
+
+    /* The job execution time does not add to the period. */
+    for (i = 0; i < 10; i++) {
+        thrd_usleep(5000);
+        BTASSERT(thrd_periodic_wait() == 0);
+    }
+
+    BTASSERT(sys.tick - start >= 50, "%d", (int)(sys.tick - start));
+    BTASSERT(sys.tick - start <= 52, "%d", (int)(sys.tick - start));
+    BTASSERT(periodic.jobs == 10);
+    BTASSERT(periodic.overruns == 0);
+    BTASSERT(periodic.exec_min_ns > 0);
+    BTASSERT(periodic.exec_max_ns < 50000000);
+
+    /* A job longer than the period. */
+    thrd_usleep(80000);
+    BTASSERT(thrd_periodic_wait() == -ETIMEDOUT);
+    BTASSERT(thrd_periodic_wait() == 0);
+    BTASSERT(periodic.jobs == 12);
+    BTASSERT(periodic.overruns == 1);
+    BTASSERT(periodic.exec_max_ns >= 50000000);
+
+    strcpy(buf, "/kernel/thrd/list");
+    BTASSERT(fs_call(buf, NULL, sys_get_stdout()) == 0);
+
+    BTASSERT(thrd_periodic_stop() == 0);
+    BTASSERT(thrd_periodic_stop() == -EINVAL);
+
+    return (0);
+}
+
+static int test_periodic_busy(struct harness_t *harness_p)
+{
+    struct thrd_periodic_t periodic;
+    struct time_t period;
+
+    time_set_ms(&period, 50);
+    BTASSERT(thrd_periodic_start(&periodic, &period) == 0);
+
+    /* A job keeping the cpu longer than the period. */
+    busy_wait_us(80000);
+    BTASSERT(thrd_periodic_wait() == -ETIMEDOUT);
+    BTASSERT(thrd_periodic_wait() == 0);
+    BTASSERT(periodic.jobs == 2);
+    BTASSERT(periodic.overruns == 1);
+    BTASSERT(periodic.exec_max_ns >= 80000000);
+
+    BTASSERT(thrd_periodic_stop() == 0);
+
+    return (0);
+}
+
+#if !defined(NTHRDSTATS)
+
+static void *stats_entry(void *arg_p)
+{
+    thrd_set_name("stats");
+    sem_get(arg_p, NULL);
+
+    return (NULL);
+}
+
+static int test_stats(struct harness_t *harness_p)
+{
+    struct thrd_t *thrd_p;
+    struct thrd_stats_t *stats_p;
+    struct sem_t sem;
+    uint32_t switches, latencies;
+    char buf[32];
+    int i;
+
+    sem_init(&sem, 0);
+    thrd_p = thrd_spawn(stats_entry,
+                        &sem,
+                        -1,
+                        thrd_stack,
+                        sizeof(thrd_stack));
+    BTASSERT(thrd_p != NULL);
+    stats_p = &thrd_p->stats;
+
+    /* Let the thread block on the semaphore. */
+    switches = thrd_self()->stats.switches_voluntary;
+    thrd_usleep(20000);
+    BTASSERT(thrd_self()->stats.switches_voluntary > switches);
+    BTASSERT(thrd_self()->stats.blocked_ns[THRD_WAIT_SLEEP] >= 10000000);
+    BTASSERT(stats_p->switches_voluntary == 1);
+
+    /* The thread has higher priority and runs when the semaphore is
+       put. A sleep may be up to one tick shorter than requested. */
+    thrd_usleep(20000);
+    BTASSERT(sem_put(&sem, 1) == 0);
+    BTASSERT(thrd_wait(thrd_p, NULL) == 0);
+
+    BTASSERT(stats_p->blocked_ns[THRD_WAIT_SEM] >= 20000000,
+             "%lu",
+             (unsigned long)stats_p->blocked_ns[THRD_WAIT_SEM]);
+    BTASSERT(stats_p->blocked_ns[THRD_WAIT_QUEUE] == 0);
+    BTASSERT(stats_p->blocked_ns[THRD_WAIT_EVENT] == 0);
+
+    latencies = 0;
+
+    for (i = 0; i < THRD_STATS_LATENCY_BUCKETS; i++) {
+        latencies += stats_p->latency[i];
+    }
+
+    BTASSERT(latencies == 1);
+
+    strcpy(buf, "/kernel/thrd/stats");
+    BTASSERT(fs_call(buf, NULL, sys_get_stdout()) == 0);
+
+    return (0);
+}
+
+#endif
+
 int main()
 {
     struct harness_t harness;
     struct harness_testcase_t harness_testcases[] = {
         { test_suspend_resume, "test_suspend_resume" },
+        { test_ready_fifo, "test_ready_fifo" },
+        { test_ready_priority, "test_ready_priority" },
+        { test_ready_shared_level, "test_ready_shared_level" },
+        { test_wait_timeout, "test_wait_timeout" },
+        { test_wait_multiple_joiners, "test_wait_multiple_joiners" },
+        { test_benchmark_resume, "test_benchmark_resume" },
+        { test_benchmark_ping_pong, "test_benchmark_ping_pong" },
+        { test_benchmark_spawn_join, "test_benchmark_spawn_join" },
+        { test_spawn_dynamic, "test_spawn_dynamic" },
+#if defined(ARCH_LINUX) && !defined(THRD_PORT_PTHREAD)
+        { test_stack_overflow, "test_stack_overflow" },
+#endif
+        { test_benchmark_spawn_dynamic, "test_benchmark_spawn_dynamic" },
+        { test_cpu_usage, "test_cpu_usage" },
+        { test_edf_admission, "test_edf_admission" },
+        { test_edf_order, "test_edf_order" },
+        { test_edf_deadline_miss, "test_edf_deadline_miss" },
+        { test_edf_deadline_miss_busy, "test_edf_deadline_miss_busy" },
+        { test_periodic, "test_periodic" },
+        { test_periodic_busy, "test_periodic_busy" },
+#if !defined(NTHRDSTATS)
+        { test_stats, "test_stats" },
+#endif
         { NULL, NULL }
     };
 
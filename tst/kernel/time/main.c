@@ -113,12 +113,49 @@ static int test_date(struct harness_t *harness)
     return (0);
 }
 
+static int test_get_ns(struct harness_t *harness)
+{
+    int i;
+    uint64_t ns1, ns2, ns, resolution;
+    struct time_t time;
+
+    /* The time never goes backwards and changes within a system
+       tick. */
+    resolution = 1000000000ULL;
+    ns1 = time_get_ns();
+
+    for (i = 0; i < 100000; i++) {
+        ns2 = time_get_ns();
+        BTASSERT(ns2 >= ns1);
+
+        if ((ns2 > ns1) && (ns2 - ns1 < resolution)) {
+            resolution = (ns2 - ns1);
+        }
+
+        ns1 = ns2;
+    }
+
+    std_printf(FSTR("resolution: %lu ns\r\n"), (unsigned long)resolution);
+
+    BTASSERT(resolution < 1000000000ULL / SYS_TICK_FREQUENCY);
+
+    /* time_get() is based on time_get_ns(). */
+    ns1 = time_get_ns();
+    BTASSERT(time_get(&time) == 0);
+    ns2 = time_get_ns();
+    ns = (1000000000ULL * time.seconds + time.nanoseconds);
+    BTASSERT((ns >= ns1) && (ns <= ns2));
+
+    return (0);
+}
+
 int main()
 {
     struct harness_t harness;
     struct harness_testcase_t harness_testcases[] = {
         { test_get_set, "test_get_set" },
         { test_date, "test_date" },
+        { test_get_ns, "test_get_ns" },
         { NULL, NULL }
     };
 
@@ -20,8 +20,24 @@
 
 #include "simba.h"
 
+#if defined(ARCH_LINUX)
+#    include <time.h>
+#    define BENCHMARK_TIMERS_MAX 10000
+#else
+#    define BENCHMARK_TIMERS_MAX 32
+#endif
+
 #define EVENT_MASK 0x1
 
+/* Timeouts in ticks on both sides of the first wheel level
+   boundaries. */
+static const int wheel_timeouts[] = {
+    1, 2, 63, 64, 65, 127, 128, 129
+};
+
+static sys_tick_t wheel_expiry_ticks[membersof(wheel_timeouts)];
+static struct timer_t benchmark_timers[BENCHMARK_TIMERS_MAX];
+
 static struct thrd_t *thrd_p;
 struct event_t event;
 
@@ -69,11 +85,221 @@ int test_timer(struct harness_t *harness_p)
     return (0);
 }
 
+static long long benchmark_time_ns(void)
+{
+#if defined(ARCH_LINUX)
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (1000000000LL * now.tv_sec + now.tv_nsec);
+#else
+    struct time_t now;
+
+    time_get(&now);
+
+    return (1000000000LL * now.seconds + now.nanoseconds);
+#endif
+}
+
+static void wheel_callback(void *arg_p)
+{
+    *(sys_tick_t *)arg_p = sys.tick;
+}
+
+static void benchmark_callback(void *arg_p)
+{
+}
+
+static struct timer_t rearm_timer;
+static volatile int rearm_count;
+static volatile int periodic_count;
+
+static void rearm_callback(void *arg_p)
+{
+    struct time_t timeout;
+
+    /* Re-arm once. */
+    if (rearm_count++ == 0) {
+        st2t(1, &timeout);
+        timer_set_isr(&rearm_timer, &timeout, rearm_callback, NULL, 0);
+    }
+}
+
+static void periodic_callback(void *arg_p)
+{
+    periodic_count++;
+}
+
+int test_wheel(struct harness_t *harness_p)
+{
+    int i;
+    sys_tick_t start[membersof(wheel_timeouts)];
+    struct timer_t timers[membersof(wheel_timeouts)];
+    struct time_t timeout;
+
+    sys_lock();
+
+    for (i = 0; i < membersof(wheel_timeouts); i++) {
+        st2t(wheel_timeouts[i], &timeout);
+        wheel_expiry_ticks[i] = 0;
+        BTASSERT(timer_set_isr(&timers[i],
+                               &timeout,
+                               wheel_callback,
+                               &wheel_expiry_ticks[i],
+                               0) == 0);
+        start[i] = sys.tick;
+    }
+
+    sys_unlock();
+
+    /* Wait for the last timer to expire. */
+    st2t(wheel_timeouts[membersof(wheel_timeouts) - 1] + 2, &timeout);
+    thrd_usleep(1000000L * timeout.seconds + timeout.nanoseconds / 1000);
+
+    /* All timers expire exactly on their tick. */
+    for (i = 0; i < membersof(wheel_timeouts); i++) {
+        BTASSERT(wheel_expiry_ticks[i] - start[i] == wheel_timeouts[i],
+                 "%d", i);
+        BTASSERT(timer_cancel(&timers[i]) == -1);
+    }
+
+    return (0);
+}
+
+int test_rearm_in_callback(struct harness_t *harness_p)
+{
+    struct timer_t timer;
+    struct time_t timeout;
+    uint64_t end_ns;
+
+    rearm_count = 0;
+    periodic_count = 0;
+    st2t(1, &timeout);
+
+    sys_lock();
+
+    /* Both timers expire in the same tick, the one-shot timer
+       first. */
+    BTASSERT(timer_set_isr(&timer,
+                           &timeout,
+                           periodic_callback,
+                           NULL,
+                           TIMER_PERIODIC) == 0);
+    BTASSERT(timer_set_isr(&rearm_timer,
+                           &timeout,
+                           rearm_callback,
+                           NULL,
+                           0) == 0);
+
+    /* Let several ticks pass before the timers are processed, so the
+       tick has to catch up when the one-shot timer is re-armed in its
+       callback. */
+    end_ns = (time_get_ns() + 5000000000ULL / SYS_TICK_FREQUENCY);
+
+    while (time_get_ns() < end_ns);
+
+    sys_unlock();
+
+    thrd_usleep(100000);
+
+    BTASSERT(rearm_count == 2);
+
+    /* The periodic timer must not be delayed. */
+    BTASSERT(periodic_count >= 5, "%d", periodic_count);
+    BTASSERT(timer_cancel(&timer) == 0);
+
+    return (0);
+}
+
+int test_benchmark_set_cancel(struct harness_t *harness_p)
+{
+    int i;
+    long long start, set_elapsed, cancel_elapsed;
+    struct time_t timeout;
+
+    sys_lock();
+
+    start = benchmark_time_ns();
+
+    for (i = 0; i < BENCHMARK_TIMERS_MAX; i++) {
+        /* Spread the timeouts over several wheel levels. No timer
+           may expire during the benchmark. */
+        st2t(SYS_TICK_FREQUENCY + ((7919L * i) % 100000), &timeout);
+        timer_set_isr(&benchmark_timers[i],
+                      &timeout,
+                      benchmark_callback,
+                      NULL,
+                      0);
+    }
+
+    set_elapsed = (benchmark_time_ns() - start);
+    start = benchmark_time_ns();
+
+    for (i = BENCHMARK_TIMERS_MAX - 1; i >= 0; i--) {
+        BTASSERT(timer_cancel_isr(&benchmark_timers[i]) == 0);
+    }
+
+    cancel_elapsed = (benchmark_time_ns() - start);
+
+    sys_unlock();
+
+    std_printf(FSTR("set %d timers in %lu us, %lu ns per timer\r\n"
+                    "cancelled %d timers in %lu us, %lu ns per timer\r\n"),
+               BENCHMARK_TIMERS_MAX,
+               (unsigned long)(set_elapsed / 1000),
+               (unsigned long)(set_elapsed / BENCHMARK_TIMERS_MAX),
+               BENCHMARK_TIMERS_MAX,
+               (unsigned long)(cancel_elapsed / 1000),
+               (unsigned long)(cancel_elapsed / BENCHMARK_TIMERS_MAX));
+
+    return (0);
+}
+
+#if defined(ARCH_LINUX)
+
+int test_tick_drift(struct harness_t *harness_p)
+{
+    int i;
+    long long start_ns, elapsed_ns, elapsed_time_ns;
+    struct time_t start, now;
+
+    time_get(&start);
+    start_ns = benchmark_time_ns();
+
+    for (i = 0; i < 10; i++) {
+        thrd_usleep(50000);
+    }
+
+    time_get(&now);
+    elapsed_ns = (benchmark_time_ns() - start_ns);
+    elapsed_time_ns = (1000000000LL * ((long long)now.seconds - start.seconds)
+                       + ((long long)now.nanoseconds - start.nanoseconds));
+
+    std_printf(FSTR("time_get() %lu us, monotonic clock %lu us\r\n"),
+               (unsigned long)(elapsed_time_ns / 1000),
+               (unsigned long)(elapsed_ns / 1000));
+
+    /* The system time follows the monotonic clock within one tick. */
+    BTASSERT(elapsed_time_ns < elapsed_ns + 1000000000LL / SYS_TICK_FREQUENCY);
+    BTASSERT(elapsed_time_ns > elapsed_ns - 1000000000LL / SYS_TICK_FREQUENCY);
+
+    return (0);
+}
+
+#endif
+
 int main()
 {
     struct harness_t harness;
     struct harness_testcase_t harness_testcases[] = {
         { test_timer, "test_timer" },
+        { test_wheel, "test_wheel" },
+        { test_rearm_in_callback, "test_rearm_in_callback" },
+        { test_benchmark_set_cancel, "test_benchmark_set_cancel" },
+#if defined(ARCH_LINUX)
+        { test_tick_drift, "test_tick_drift" },
+#endif
         { NULL, NULL }
     };
 
@@ -0,0 +1,156 @@
+/**
+ * @file main.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+static THRD_STACK(suspender_stack, 512);
+static struct sem_t sem;
+static struct queue_t queue;
+static char queue_buf[16];
+
+/* Trace dumps are written to a queue, and read into a string. */
+static char capture_buf[65536];
+static QUEUE_INIT_DECL(capture, capture_buf, sizeof(capture_buf));
+static char output[sizeof(capture_buf)];
+
+/**
+ * Read everything written to the capture queue into `output`.
+ */
+static int read_output(void)
+{
+    ssize_t size;
+
+    size = queue_size(&capture);
+    BTASSERT(queue_read(&capture, output, size) == size);
+    output[size] = '\0';
+
+    return (0);
+}
+
+static void *suspender_entry(void *arg_p)
+{
+    thrd_set_name("suspender");
+    thrd_suspend(NULL);
+
+    return (NULL);
+}
+
+static int test_events(struct harness_t *harness_p)
+{
+    struct thrd_t *thrd_p;
+    char line[64];
+    char c;
+
+    /* Kernel objects. */
+    sem_init(&sem, 1);
+    BTASSERT(sem_get(&sem, NULL) == 0);
+    BTASSERT(sem_put(&sem, 1) == 0);
+
+    queue_init(&queue, queue_buf, sizeof(queue_buf));
+    c = 'a';
+    BTASSERT(queue_write(&queue, &c, 1) == 1);
+    BTASSERT(queue_read(&queue, &c, 1) == 1);
+
+    /* Scheduling. */
+    thrd_p = thrd_spawn(suspender_entry,
+                        NULL,
+                        0,
+                        suspender_stack,
+                        sizeof(suspender_stack));
+    BTASSERT(thrd_p != NULL);
+    thrd_usleep(20000);
+    BTASSERT(thrd_resume(thrd_p, 0) == 0);
+    BTASSERT(thrd_wait(thrd_p, NULL) == 0);
+
+    BTASSERT(trace_dump(&capture) == 0);
+    BTASSERT(read_output() == 0);
+
+    BTASSERT(strstr(output, "trace cpus ") != NULL);
+    BTASSERT(strstr(output, " main\r\n") != NULL);
+    BTASSERT(strstr(output, "end\r\n") != NULL);
+
+    std_sprintf(line, FSTR(" sem_get 0x%lx 0\r\n"), (unsigned long)&sem);
+    BTASSERT(strstr(output, line) != NULL, "%s", line);
+    std_sprintf(line, FSTR(" sem_put 0x%lx 1\r\n"), (unsigned long)&sem);
+    BTASSERT(strstr(output, line) != NULL, "%s", line);
+    std_sprintf(line, FSTR(" queue_write 0x%lx 1\r\n"), (unsigned long)&queue);
+    BTASSERT(strstr(output, line) != NULL, "%s", line);
+    std_sprintf(line, FSTR(" queue_read 0x%lx 1\r\n"), (unsigned long)&queue);
+    BTASSERT(strstr(output, line) != NULL, "%s", line);
+    std_sprintf(line, FSTR(" switch 0x%lx "), (unsigned long)thrd_p);
+    BTASSERT(strstr(output, line) != NULL, "%s", line);
+    std_sprintf(line, FSTR(" suspend 0x%lx 0\r\n"), (unsigned long)thrd_p);
+    BTASSERT(strstr(output, line) != NULL, "%s", line);
+    std_sprintf(line, FSTR(" resume 0x%lx "), (unsigned long)thrd_p);
+    BTASSERT(strstr(output, line) != NULL, "%s", line);
+    BTASSERT(strstr(output, " timer_tick 0x0 0\r\n") != NULL);
+
+    return (0);
+}
+
+static int test_overwrite(struct harness_t *harness_p)
+{
+    int i;
+    char line[32];
+
+    for (i = 0; i < TRACE_RING_LENGTH; i++) {
+        sem_put(&sem, 1);
+    }
+
+    BTASSERT(trace_dump(&capture) == 0);
+    BTASSERT(read_output() == 0);
+
+    /* Only the newest records are kept. */
+    std_sprintf(line, FSTR("cpu %d overwritten 0\r\n"), thrd_get_cpu());
+    BTASSERT(strstr(output, line) == NULL);
+
+    return (0);
+}
+
+static int test_cmd_dump(struct harness_t *harness_p)
+{
+    char buf[32];
+
+    strcpy(buf, "/kernel/trace/dump");
+    BTASSERT(fs_call(buf, NULL, &capture) == 0);
+    BTASSERT(read_output() == 0);
+    BTASSERT(strstr(output, "end\r\n") != NULL);
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_t harness;
+    struct harness_testcase_t harness_testcases[] = {
+        { test_events, "test_events" },
+        { test_overwrite, "test_overwrite" },
+        { test_cmd_dump, "test_cmd_dump" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+    uart_module_init();
+
+    harness_init(&harness);
+    harness_run(&harness, harness_testcases);
+
+    return (0);
+}
@@ -0,0 +1,245 @@
+/**
+ * @file main.c
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2014-2015, Erik Moqvist
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Simba project.
+ */
+
+#include "simba.h"
+
+/* Number of times the resubmitting work runs. */
+#define RESUBMITS 3
+
+static struct workq_t workq;
+static THRD_STACK(workq_stacks[2], 1024);
+
+static struct sem_t sem;
+static struct sem_t blocker_sem;
+static int executed;
+static int resubmit_count;
+static struct work_t resubmit_work;
+
+static void count_cb(void *arg_p)
+{
+    executed++;
+    sem_put(&sem, 1);
+}
+
+static void resubmit_cb(void *arg_p)
+{
+    resubmit_count++;
+
+    if (resubmit_count < RESUBMITS) {
+        work_submit(&resubmit_work);
+    } else {
+        sem_put(&sem, 1);
+    }
+}
+
+static void blocking_cb(void *arg_p)
+{
+    sem_get(&blocker_sem, NULL);
+    sem_put(&sem, 1);
+}
+
+static void unblocking_cb(void *arg_p)
+{
+    sem_put(&blocker_sem, 1);
+}
+
+static int test_submit(struct harness_t *harness_p)
+{
+    struct work_t work;
+    int res[2];
+
+    BTASSERT(sem_init(&sem, 0) == 0);
+    executed = 0;
+
+    /* The system work queue. */
+    BTASSERT(work_init(&work, NULL, count_cb, NULL) == 0);
+    BTASSERT(work_submit(&work) == 0);
+    BTASSERT(sem_get(&sem, NULL) == 0);
+    BTASSERT(executed == 1);
+
+    /* Submit with the system lock taken, as from an interrupt
+       handler. A pending work is not submitted again. The lock
+       keeps a worker on another cpu from taking the work in
+       between. */
+    sys_lock();
+    res[0] = work_submit_isr(&work);
+    res[1] = work_submit_isr(&work);
+    sys_unlock();
+    BTASSERT(res[0] == 0);
+    BTASSERT(res[1] == -EBUSY);
+    BTASSERT(sem_get(&sem, NULL) == 0);
+    BTASSERT(executed == 2);
+
+    /* A work may submit itself from its work function. */
+    resubmit_count = 0;
+    BTASSERT(work_init(&resubmit_work, NULL, resubmit_cb, NULL) == 0);
+    BTASSERT(work_submit(&resubmit_work) == 0);
+    BTASSERT(sem_get(&sem, NULL) == 0);
+    BTASSERT(resubmit_count == RESUBMITS);
+
+    return (0);
+}
+
+static int test_delayed(struct harness_t *harness_p)
+{
+    struct work_t work;
+    struct time_t timeout;
+    struct time_t start, stop;
+
+    BTASSERT(sem_init(&sem, 0) == 0);
+    executed = 0;
+
+    BTASSERT(work_init(&work, NULL, count_cb, NULL) == 0);
+
+    timeout.seconds = 0;
+    timeout.nanoseconds = 50000000;
+    time_get(&start);
+    BTASSERT(work_submit_delayed(&work, &timeout) == 0);
+    BTASSERT(work_submit(&work) == -EBUSY);
+    BTASSERT(sem_get(&sem, NULL) == 0);
+    time_get(&stop);
+    BTASSERT(executed == 1);
+    BTASSERT(((stop.seconds - start.seconds) * 1000000000L
+              + (stop.nanoseconds - start.nanoseconds)) >= 40000000L);
+
+    /* A cancelled delayed work is never executed. */
+    BTASSERT(work_submit_delayed(&work, &timeout) == 0);
+    BTASSERT(work_cancel(&work) == 0);
+    thrd_usleep(100000);
+    BTASSERT(executed == 1);
+    BTASSERT(work_cancel(&work) == -ENOENT);
+
+    return (0);
+}
+
+static int test_cancel_pending(struct harness_t *harness_p)
+{
+    struct work_t works[3];
+    unsigned long depth[2];
+    int res[7];
+    int i;
+
+    BTASSERT(sem_init(&sem, 0) == 0);
+    executed = 0;
+
+    for (i = 0; i < 3; i++) {
+        BTASSERT(work_init(&works[i], &workq, count_cb, NULL) == 0);
+    }
+
+    /* The worker threads cannot take any work while this thread
+       holds the system lock, so the work stays pending. */
+    sys_lock();
+
+    for (i = 0; i < 3; i++) {
+        res[i] = work_submit_isr(&works[i]);
+    }
+
+    depth[0] = workq.stats.depth;
+    res[3] = work_cancel_isr(&works[1]);
+    res[4] = work_cancel_isr(&works[2]);
+    res[5] = work_cancel_isr(&works[2]);
+    depth[1] = workq.stats.depth;
+
+    /* The tail of the pending list is valid after a cancel. */
+    res[6] = work_submit_isr(&works[2]);
+
+    sys_unlock();
+
+    for (i = 0; i < 3; i++) {
+        BTASSERT(res[i] == 0);
+    }
+
+    BTASSERT(depth[0] == 3);
+    BTASSERT(res[3] == 0);
+    BTASSERT(res[4] == 0);
+    BTASSERT(res[5] == -ENOENT);
+    BTASSERT(depth[1] == 1);
+    BTASSERT(res[6] == 0);
+
+    BTASSERT(sem_get(&sem, NULL) == 0);
+    BTASSERT(sem_get(&sem, NULL) == 0);
+    thrd_usleep(50000);
+    BTASSERT(executed == 2);
+    BTASSERT(workq.stats.depth == 0);
+
+    return (0);
+}
+
+static int test_pool(struct harness_t *harness_p)
+{
+    struct work_t blocking_work;
+    struct work_t unblocking_work;
+
+    BTASSERT(sem_init(&sem, 0) == 0);
+    BTASSERT(sem_init(&blocker_sem, 0) == 0);
+
+    /* The first work blocks its worker until the second work has
+       executed, which requires the second worker. */
+    BTASSERT(work_init(&blocking_work, &workq, blocking_cb, NULL) == 0);
+    BTASSERT(work_init(&unblocking_work, &workq, unblocking_cb, NULL) == 0);
+    BTASSERT(work_submit(&blocking_work) == 0);
+    BTASSERT(work_submit(&unblocking_work) == 0);
+    BTASSERT(sem_get(&sem, NULL) == 0);
+
+    return (0);
+}
+
+static int test_fs(struct harness_t *harness_p)
+{
+    char buf[64];
+
+    strcpy(buf, "/kernel/workq/list");
+    BTASSERT(fs_call(buf, NULL, sys_get_stdout()) == 0);
+
+    strcpy(buf, "/kernel/workq/reset");
+    BTASSERT(fs_call(buf, NULL, sys_get_stdout()) == 0);
+    BTASSERT(workq.stats.submitted == 0);
+    BTASSERT(workq.stats.executed == 0);
+
+    return (0);
+}
+
+int main()
+{
+    struct harness_t harness;
+    struct harness_testcase_t harness_testcases[] = {
+        { test_submit, "test_submit" },
+        { test_delayed, "test_delayed" },
+        { test_cancel_pending, "test_cancel_pending" },
+        { test_pool, "test_pool" },
+        { test_fs, "test_fs" },
+        { NULL, NULL }
+    };
+
+    sys_start();
+    uart_module_init();
+
+    BTASSERT(workq_init(&workq,
+                        "test",
+                        10,
+                        workq_stacks,
+                        sizeof(workq_stacks[0]),
+                        2) == 0);
+
+    harness_init(&harness);
+    harness_run(&harness, harness_testcases);
+
+    return (0);
+}